@@ -0,0 +1,616 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_log.h"
+#include "tree_load_infix.h"
+#include "tree_plot.h"
+#include "node_arena.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+// Benchmark of stages: TreeLoadInfixFromFile(), NodeDiff(), TreeSimplify(),
+// NodeCalculateAt() and plot data generation (TreeGeneratePlots()).
+// Every stage is repeated until it took at least --min-time, one JSON line
+// per stage and case is printed to stdout, so results of two versions can be
+// compared line by line.
+// Allocations are calls of malloc(), calloc() and realloc() made by
+// differentiator code, they are counted by linker's --wrap (see make bench).
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+const size_t kBenchMinRuns          = 3;
+const uint64_t kBenchMinTimeNs      = 200 * 1000 * 1000;
+const size_t kBenchCalculatePoints  = 1000;
+const double kBenchPoint            = 0.7; // value of variables for taylor
+const size_t kBenchVariablesCapacity = 4;
+const size_t kBenchOrdersMax        = 16;
+
+struct benchStage_t
+{
+    const char *name        = NULL;
+    size_t order            = 0;
+
+    size_t runs             = 0;
+    uint64_t ns             = 0;            // of all runs
+    uint64_t nsMin          = UINT64_MAX;
+    size_t allocations      = 0;            // of all runs
+
+    size_t nodes            = 0;            // processed by one run
+    size_t nodeVisits       = 0;            // by one run, 0 - ns_per_node is not printed
+    size_t points           = 0;            // evaluated by one run, 0 - not evaluating stage
+};
+
+struct benchCase_t
+{
+    const char *fileName    = NULL;
+    size_t orders[kBenchOrdersMax] = {};
+    size_t ordersCnt        = 0;
+};
+
+struct bench_t
+{
+    uint64_t minTimeNs      = kBenchMinTimeNs;
+
+    nodeArena_t arena       = {};
+    threadPool_t pool       = {};
+};
+
+static size_t allocationsCnt = 0;
+static volatile double calculateSink = 0; // results of NodeCalculateAt(), so they are not optimized out
+
+extern "C" void *__real_malloc  (size_t size);
+extern "C" void *__real_calloc  (size_t cnt, size_t size);
+extern "C" void *__real_realloc (void *ptr, size_t size);
+extern "C" void *__wrap_malloc  (size_t size);
+extern "C" void *__wrap_calloc  (size_t cnt, size_t size);
+extern "C" void *__wrap_realloc (void *ptr, size_t size);
+
+static int  BenchRunCase        (bench_t *bench, benchCase_t *benchCase);
+static int  BenchParse          (bench_t *bench, benchCase_t *benchCase);
+static int  BenchDerivatives    (bench_t *bench, benchCase_t *benchCase, size_t order);
+static int  BenchDiffChain      (differentiator_t *diff, size_t order,
+                                 benchStage_t *diffStage, benchStage_t *simplifyStage);
+static void BenchCalculate      (bench_t *bench, benchCase_t *benchCase, differentiator_t *diff,
+                                 tree_t *tree, const char *name, size_t order);
+static int  BenchPlot           (bench_t *bench, benchCase_t *benchCase, differentiator_t *diff,
+                                 size_t order);
+static int  BenchLoad           (benchCase_t *benchCase, differentiator_t *diff);
+static bool BenchNeedRun        (bench_t *bench, benchStage_t *stage);
+static void BenchStageAdd       (benchStage_t *stage, uint64_t ns, size_t allocations);
+static void BenchStagePrint     (benchCase_t *benchCase, benchStage_t *stage);
+static uint64_t BenchNow        ();
+static size_t BenchAllocations  ();
+static int  BenchParseCases     (char *buffer, benchCase_t **cases, size_t *casesCnt);
+static int  BenchParseOptions   (int argc, char *argv[], bench_t *bench, const char **casesFileName);
+
+int main (int argc, char *argv[])
+{
+    bench_t bench = {};
+    const char *casesFileName = NULL;
+
+    if (BenchParseOptions (argc, argv, &bench, &casesFileName) != TREE_OK)
+    {
+        fprintf (stderr, "Usage: %s [--min-time <ms>] <cases file>\n", argv[0]);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_WRONG_USER_INPUT;
+    }
+
+    size_t bufferLen = 0;
+    char *buffer = ReadFile (casesFileName, &bufferLen);
+    if (buffer == NULL)
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_READING_FILE;
+
+    benchCase_t *cases = NULL;
+    size_t casesCnt = 0;
+
+    int status = BenchParseCases (buffer, &cases, &casesCnt);
+
+    if (status == TREE_OK)
+        status = NodeArenaCtor (&bench.arena);
+
+    if (status == TREE_OK)
+    {
+        status = ThreadPoolCtor (&bench.pool, 0);
+        if (status != COMMON_ERROR_OK)
+            status = TREE_ERROR_COMMON | status;
+    }
+
+    for (size_t i = 0; i < casesCnt && status == TREE_OK; i++)
+    {
+        status = BenchRunCase (&bench, &cases[i]);
+    }
+
+    ThreadPoolDtor (&bench.pool);
+    NodeArenaDtor  (&bench.arena);
+
+    free (cases);
+    free (buffer);
+
+    return status;
+}
+
+int BenchRunCase (bench_t *bench, benchCase_t *benchCase)
+{
+    assert (bench);
+    assert (benchCase);
+
+    TREE_DO_AND_RETURN (BenchParse (bench, benchCase));
+
+    for (size_t i = 0; i < benchCase->ordersCnt; i++)
+    {
+        TREE_DO_AND_RETURN (BenchDerivatives (bench, benchCase, benchCase->orders[i]));
+    }
+
+    return TREE_OK;
+}
+
+// every run gets new differentiator, because variables point into its buffer
+int BenchParse (bench_t *bench, benchCase_t *benchCase)
+{
+    assert (bench);
+    assert (benchCase);
+
+    benchStage_t stage = {};
+    stage.name = "parse";
+
+    int status = TREE_OK;
+
+    while (status == TREE_OK && BenchNeedRun (bench, &stage))
+    {
+        differentiator_t diff = {};
+        diff.arena = &bench->arena;
+
+        status = DifferentiatorCtorEmpty (&diff, kBenchVariablesCapacity);
+
+        size_t bufferLen   = 0;
+        size_t allocations = BenchAllocations ();
+        uint64_t start     = BenchNow ();
+
+        if (status == TREE_OK)
+            status = TreeLoadInfixFromFile (&diff, &diff.expression, benchCase->fileName,
+                                            &diff.buffer, &bufferLen);
+
+        BenchStageAdd (&stage, BenchNow () - start, BenchAllocations () - allocations);
+
+        stage.nodes      = diff.expression.size;
+        stage.nodeVisits = diff.expression.size;
+
+        DifferentiatorDtor (&diff);
+    }
+
+    if (status == TREE_OK)
+        BenchStagePrint (benchCase, &stage);
+
+    return status;
+}
+
+// derivatives are kept after the last run of chain for evaluation and plots
+int BenchDerivatives (bench_t *bench, benchCase_t *benchCase, size_t order)
+{
+    assert (bench);
+    assert (benchCase);
+
+    differentiator_t diff = {};
+    diff.arena     = &bench->arena;
+    diff.pool      = &bench->pool;
+    diff.workerIdx = ThreadPoolExternalIdx (&bench->pool);
+
+    int status = BenchLoad (benchCase, &diff);
+    if (status != TREE_OK || diff.varToDiff == NULL)
+    {
+        DifferentiatorDtor (&diff);
+
+        return status;
+    }
+
+    benchStage_t diffStage     = {};
+    benchStage_t simplifyStage = {};
+
+    diffStage.name      = "diff";
+    diffStage.order     = order;
+    simplifyStage.name  = "simplify";
+    simplifyStage.order = order;
+
+    while (status == TREE_OK && BenchNeedRun (bench, &diffStage))
+    {
+        status = BenchDiffChain (&diff, order, &diffStage, &simplifyStage);
+    }
+
+    if (status == TREE_OK)
+    {
+        BenchStagePrint (benchCase, &diffStage);
+        BenchStagePrint (benchCase, &simplifyStage);
+
+        BenchCalculate (bench, benchCase, &diff, &diff.expression, "calculate", order);
+        BenchCalculate (bench, benchCase, &diff, &diff.diffTrees[order - 1],
+                        "calculate_derivative", order);
+
+        status = BenchPlot (bench, benchCase, &diff, order);
+    }
+
+    DifferentiatorDtor (&diff);
+
+    return status;
+}
+
+// the same as TreesDiffByVariable() without latex, but stages are timed separately
+int BenchDiffChain (differentiator_t *diff, size_t order,
+                    benchStage_t *diffStage, benchStage_t *simplifyStage)
+{
+    assert (diff);
+    assert (diffStage);
+    assert (simplifyStage);
+
+    if (diff->diffTrees != NULL)
+    {
+        for (size_t i = 0; i < diff->diffTreesCnt; i++)
+        {
+            TreeDtor (&diff->diffTrees[i]);
+        }
+    }
+    else
+    {
+        diff->diffTrees = (tree_t *) calloc (order, sizeof (tree_t));
+        if (diff->diffTrees == NULL)
+        {
+            ERROR_LOG ("Error allocating memory for diff->diffTrees - %s", strerror (errno));
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_ALLOCATING_MEMORY;
+        }
+
+        diff->diffTreesCnt = order;
+    }
+
+    uint64_t diffNs         = 0;
+    uint64_t simplifyNs     = 0;
+    size_t diffAllocs       = 0;
+    size_t simplifyAllocs   = 0;
+
+    diffStage->nodes     = 0;
+    simplifyStage->nodes = 0;
+
+    for (size_t i = 0; i < order; i++)
+    {
+        tree_t *tree = &diff->diffTrees[i];
+
+        TREE_DO_AND_RETURN (TREE_CTOR (tree, &diff->log));
+        tree->arena = diff->arena;
+
+        node_t *source = (i == 0) ? diff->expression.root : diff->diffTrees[i - 1].root;
+
+        size_t allocations = BenchAllocations ();
+        uint64_t start     = BenchNow ();
+
+        tree->root = NodeDiff (diff, source, tree, diff->varToDiff);
+
+        uint64_t middle          = BenchNow ();
+        size_t middleAllocations = BenchAllocations ();
+
+        if (tree->root == NULL)
+            return TREE_ERROR_NULL_ROOT;
+
+        // simplification gets the whole derivative
+        simplifyStage->nodes += tree->size;
+
+        TreeSimplify (diff, tree);
+
+        diffNs         += middle - start;
+        simplifyNs     += BenchNow () - middle;
+        diffAllocs     += middleAllocations - allocations;
+        simplifyAllocs += BenchAllocations () - middleAllocations;
+
+        diffStage->nodes += tree->size;
+    }
+
+    diffStage->nodeVisits     = diffStage->nodes;
+    simplifyStage->nodeVisits = simplifyStage->nodes;
+
+    BenchStageAdd (diffStage,     diffNs,     diffAllocs);
+    BenchStageAdd (simplifyStage, simplifyNs, simplifyAllocs);
+
+    return TREE_OK;
+}
+
+void BenchCalculate (bench_t *bench, benchCase_t *benchCase, differentiator_t *diff,
+                     tree_t *tree, const char *name, size_t order)
+{
+    assert (bench);
+    assert (benchCase);
+    assert (diff);
+    assert (tree);
+    assert (name);
+
+    benchStage_t stage = {};
+    stage.name   = name;
+    stage.order  = order;
+    stage.nodes      = tree->size;
+    stage.nodeVisits = tree->size * kBenchCalculatePoints;
+    stage.points     = kBenchCalculatePoints;
+
+    size_t varIdx = diff->varToDiff->idx;
+    double step   = (double) (kRightRange - kLeftRange) / (double) kBenchCalculatePoints;
+
+    while (BenchNeedRun (bench, &stage))
+    {
+        double sum = 0;
+
+        size_t allocations = BenchAllocations ();
+        uint64_t start     = BenchNow ();
+
+        for (size_t i = 0; i < kBenchCalculatePoints; i++)
+        {
+            sum += NodeCalculateAt (diff, tree->root, varIdx, kLeftRange + (double) i * step);
+        }
+
+        BenchStageAdd (&stage, BenchNow () - start, BenchAllocations () - allocations);
+
+        calculateSink += sum;
+    }
+
+    BenchStagePrint (benchCase, &stage);
+}
+
+int BenchPlot (bench_t *bench, benchCase_t *benchCase, differentiator_t *diff, size_t order)
+{
+    assert (bench);
+    assert (benchCase);
+    assert (diff);
+
+    TREE_DO_AND_RETURN (DumpLatexTaylor (diff));
+
+    benchStage_t stage = {};
+    stage.name  = "plot";
+    stage.order = order;
+    // curves are evaluated at different points, so nodeVisits is unknown
+    stage.nodes = diff->expression.size + diff->taylor.size;
+
+    for (size_t i = 0; i < diff->diffTreesCnt; i++)
+    {
+        stage.nodes += diff->diffTrees[i].size;
+    }
+
+    int status = TREE_OK;
+
+    while (status == TREE_OK && BenchNeedRun (bench, &stage))
+    {
+        plotSet_t plots = {};
+
+        size_t allocations = BenchAllocations ();
+        uint64_t start     = BenchNow ();
+
+        status = TreeGeneratePlots (diff, &plots);
+
+        BenchStageAdd (&stage, BenchNow () - start, BenchAllocations () - allocations);
+
+        stage.points = plots.evaluationsCnt;
+
+        PlotSetDtor (&plots);
+    }
+
+    if (status == TREE_OK)
+        BenchStagePrint (benchCase, &stage);
+
+    return status;
+}
+
+// untimed parse for stages after it
+int BenchLoad (benchCase_t *benchCase, differentiator_t *diff)
+{
+    assert (benchCase);
+    assert (diff);
+
+    TREE_DO_AND_RETURN (DifferentiatorCtorEmpty (diff, kBenchVariablesCapacity));
+
+    size_t bufferLen = 0;
+    TREE_DO_AND_RETURN (TreeLoadInfixFromFile (diff, &diff->expression, benchCase->fileName,
+                                               &diff->buffer, &bufferLen));
+
+    for (size_t i = 0; i < diff->variablesSize; i++)
+    {
+        diff->variables[i].value = kBenchPoint;
+    }
+
+    if (diff->variablesSize > 0)
+        diff->varToDiff = &diff->variables[0];
+
+    return TREE_OK;
+}
+
+bool BenchNeedRun (bench_t *bench, benchStage_t *stage)
+{
+    assert (bench);
+    assert (stage);
+
+    return stage->runs < kBenchMinRuns || stage->ns < bench->minTimeNs;
+}
+
+void BenchStageAdd (benchStage_t *stage, uint64_t ns, size_t allocations)
+{
+    assert (stage);
+
+    stage->runs        += 1;
+    stage->ns          += ns;
+    stage->allocations += allocations;
+
+    if (ns < stage->nsMin)
+        stage->nsMin = ns;
+}
+
+// times are per run, ns_per_* are by mean time
+void BenchStagePrint (benchCase_t *benchCase, benchStage_t *stage)
+{
+    assert (benchCase);
+    assert (stage);
+    assert (stage->runs > 0);
+
+    double ns = (double) stage->ns / (double) stage->runs;
+
+    printf ("{\"version\": \"%s\", \"file\": \"%s\", \"stage\": \"%s\", \"order\": %lu, "
+            "\"runs\": %lu, \"ns\": %.0f, \"ns_min\": %lu, \"nodes\": %lu, "
+            "\"allocations\": %.1f, ",
+            BENCH_VERSION, benchCase->fileName, stage->name, stage->order,
+            stage->runs, ns, stage->nsMin, stage->nodes,
+            (double) stage->allocations / (double) stage->runs);
+
+    if (stage->nodeVisits > 0)
+        printf ("\"ns_per_node\": %.3f, ", ns / (double) stage->nodeVisits);
+    else
+        printf ("%s", "\"ns_per_node\": null, ");
+
+    if (stage->points > 0)
+        printf ("\"points\": %lu, \"ns_per_point\": %.3f}\n", stage->points, ns / (double) stage->points);
+    else
+        printf ("%s", "\"points\": 0, \"ns_per_point\": null}\n");
+
+    fflush (stdout);
+}
+
+uint64_t BenchNow ()
+{
+    timespec time = {};
+    clock_gettime (CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000 * 1000 * 1000 + (uint64_t) time.tv_nsec;
+}
+
+size_t BenchAllocations ()
+{
+    return __atomic_load_n (&allocationsCnt, __ATOMIC_RELAXED);
+}
+
+void *__wrap_malloc (size_t size)
+{
+    __atomic_add_fetch (&allocationsCnt, 1, __ATOMIC_RELAXED);
+
+    return __real_malloc (size);
+}
+
+void *__wrap_calloc (size_t cnt, size_t size)
+{
+    __atomic_add_fetch (&allocationsCnt, 1, __ATOMIC_RELAXED);
+
+    return __real_calloc (cnt, size);
+}
+
+void *__wrap_realloc (void *ptr, size_t size)
+{
+    __atomic_add_fetch (&allocationsCnt, 1, __ATOMIC_RELAXED);
+
+    return __real_realloc (ptr, size);
+}
+
+// "file order order ..." lines, empty lines and lines starting with '#' are skipped
+int BenchParseCases (char *buffer, benchCase_t **cases, size_t *casesCnt)
+{
+    assert (buffer);
+    assert (cases);
+    assert (casesCnt);
+
+    size_t linesCnt = 1;
+    for (char *c = buffer; *c != '\0'; c++)
+    {
+        if (*c == '\n')
+            linesCnt++;
+    }
+
+    *cases = (benchCase_t *) calloc (linesCnt, sizeof (benchCase_t));
+    if (*cases == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for benchmark cases - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    char *line = buffer;
+    while (line != NULL)
+    {
+        char *lineEnd = strchr (line, '\n');
+        if (lineEnd != NULL)
+            *lineEnd = '\0';
+
+        line = SkipSpaces (line);
+
+        if (*line != '\0' && *line != '#')
+        {
+            benchCase_t *benchCase = &(*cases)[*casesCnt];
+            benchCase->fileName = line;
+
+            char *cur = line + strcspn (line, " \t");
+
+            while (*cur != '\0')
+            {
+                *cur = '\0';
+                cur  = SkipSpaces (cur + 1);
+
+                if (*cur == '\0')
+                    break;
+
+                char *end = NULL;
+                unsigned long order = strtoul (cur, &end, 10);
+
+                if (end == cur || order == 0 || benchCase->ordersCnt == kBenchOrdersMax)
+                {
+                    ERROR_PRINT ("Bad derivative order in benchmark case \"%s\"", benchCase->fileName);
+
+                    return TREE_ERROR_COMMON |
+                           COMMON_ERROR_WRONG_USER_INPUT;
+                }
+
+                benchCase->orders[benchCase->ordersCnt++] = order;
+                cur = end;
+            }
+
+            (*casesCnt)++;
+        }
+
+        line = (lineEnd != NULL) ? lineEnd + 1 : NULL;
+    }
+
+    return TREE_OK;
+}
+
+int BenchParseOptions (int argc, char *argv[], bench_t *bench, const char **casesFileName)
+{
+    assert (argv);
+    assert (bench);
+    assert (casesFileName);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp (argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            char *end = NULL;
+            unsigned long ms = strtoul (argv[++i], &end, 10);
+            if (*end != '\0' || ms == 0)
+                return TREE_ERROR_COMMON |
+                       COMMON_ERROR_WRONG_USER_INPUT;
+
+            bench->minTimeNs = ms * 1000 * 1000;
+        }
+        else if (*casesFileName == NULL)
+        {
+            *casesFileName = argv[i];
+        }
+        else
+        {
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_WRONG_USER_INPUT;
+        }
+    }
+
+    return (*casesFileName == NULL) ? TREE_ERROR_COMMON | COMMON_ERROR_WRONG_USER_INPUT
+                                    : TREE_OK;
+}
@@ -35,7 +35,8 @@ enum commonErrors
     COMMON_ERROR_CREATING_FILE          = 1 << 7,
     COMMON_ERROR_WRONG_USER_INPUT       = 1 << 8,
     COMMON_ERROR_SNPRINTF               = 1 << 9,
-    COMMON_ERROR_RUNNING_SYSTEM_COMMAND = 1 << 10 // TODO: add text messages
+    COMMON_ERROR_RUNNING_SYSTEM_COMMAND = 1 << 10, // TODO: add text messages
+    COMMON_ERROR_CREATING_THREAD        = 1 << 11
 };
 
 // FIXME:
@@ -0,0 +1,31 @@
+#ifndef K_DOUBLE_FORMAT_H
+#define K_DOUBLE_FORMAT_H
+
+#include <stdio.h>
+
+// Number to text without printf(), std::to_chars() does the work
+// (shortest digits are found as in Ryu, no locale, no format parsing).
+// Shortest - the least digits which are read back to the same double,
+// fixed  - exactly as "%.<precision>g".
+
+enum doubleFormatMode_t
+{
+    DOUBLE_FORMAT_SHORTEST  = 0,
+    DOUBLE_FORMAT_FIXED     = 1,
+};
+
+struct doubleFormat_t
+{
+    doubleFormatMode_t mode = DOUBLE_FORMAT_SHORTEST;
+    int precision           = 6;    // significant digits, only for DOUBLE_FORMAT_FIXED
+};
+
+// enough for any double in both modes with precision <= kDoubleFormatMaxPrecision
+const size_t kDoubleFormatMaxLen        = 32;
+const int    kDoubleFormatMaxPrecision  = 17;
+
+// writes at most kDoubleFormatMaxLen chars without '\0', returns their number
+size_t FormatDouble         (char *buffer, double value, doubleFormat_t format);
+void   FprintDouble         (FILE *file, double value, doubleFormat_t format);
+
+#endif // K_DOUBLE_FORMAT_H
@@ -0,0 +1,54 @@
+#ifndef K_PROCESS_MANAGER_H
+#define K_PROCESS_MANAGER_H
+
+#include <stdio.h>
+#include <signal.h>
+#include <sys/types.h>
+
+// External tools (gnuplot, dot, pdflatex) without system():
+// processes are started with posix_spawnp() without shell,
+// long-lived ones get their commands through stdin pipe,
+// short ones are tracked by process manager and reaped asynchronously.
+
+enum processFlags_t
+{
+    PROCESS_DEFAULT     = 0,
+    PROCESS_WITH_INPUT  = 1 << 0, // stdin is a pipe, see process_t::input
+    PROCESS_QUIET       = 1 << 1, // stdout to /dev/null
+};
+
+struct process_t
+{
+    pid_t pid       = -1;   // -1 - not running
+    FILE *input     = NULL; // only with PROCESS_WITH_INPUT
+};
+
+const size_t kProcessesMaxRunning = 4;
+
+struct processManager_t
+{
+    process_t *running  = NULL;
+    size_t runningCnt   = 0;
+    size_t capacity     = 0;
+    int status          = 0; // errors of already reaped processes
+};
+
+// argv[0] is searched in PATH, argv ends with NULL
+int  ProcessStart           (process_t *process, const char * const *argv, int flags);
+// closes input and waits for exit, error if exit status is not 0
+int  ProcessWait            (process_t *process);
+// doesn't block, true if process has exited (*status is set then)
+bool ProcessTryWait         (process_t *process, int *status);
+
+// writing into pipe of exited process is an error, not a SIGPIPE
+void ProcessSigpipeBlock    (sigset_t *oldSet);
+void ProcessSigpipeRestore  (const sigset_t *oldSet);
+
+// starts process without waiting, not more than kProcessesMaxRunning at once
+int  ProcessManagerRun      (processManager_t *manager, const char * const *argv, int flags);
+// reaps exited processes, returns errors of all reaped ones
+int  ProcessManagerPoll     (processManager_t *manager);
+int  ProcessManagerWaitAll  (processManager_t *manager);
+void ProcessManagerDtor     (processManager_t *manager);
+
+#endif // K_PROCESS_MANAGER_H
@@ -0,0 +1,38 @@
+#ifndef K_TEXT_BUFFER_H
+#define K_TEXT_BUFFER_H
+
+#include <stdio.h>
+
+#include "double_format.h"
+
+// Growable in-memory text, written to file with one write() at the end.
+// Appending never fails loudly: after allocation error buffer stops growing
+// and remembers it, error is returned by TextBufferWriteFile()
+
+struct textBuffer_t
+{
+    char *data      = NULL;
+    size_t size     = 0;
+    size_t capacity = 0;
+    bool failed     = false;
+};
+
+const size_t kTextBufferStartCapacity = 1 << 16;
+
+int  TextBufferCtor         (textBuffer_t *buffer, size_t capacity);
+void TextBufferDtor         (textBuffer_t *buffer);
+
+bool TextBufferReserve      (textBuffer_t *buffer, size_t extraSize);
+
+void TextBufferAppend       (textBuffer_t *buffer, const char *str, size_t len);
+void TextBufferPuts         (textBuffer_t *buffer, const char *str);
+void TextBufferPutc         (textBuffer_t *buffer, char c);
+// drops text after size, to undo part that turned out not needed
+void TextBufferTruncate     (textBuffer_t *buffer, size_t size);
+void TextBufferPrintf       (textBuffer_t *buffer, const char *format, ...)
+                            __attribute__ ((format (printf, 2, 3)));
+void TextBufferDouble       (textBuffer_t *buffer, double value, doubleFormat_t format);
+
+int  TextBufferWriteFile    (textBuffer_t *buffer, const char *fileName);
+
+#endif // K_TEXT_BUFFER_H
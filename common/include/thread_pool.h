@@ -0,0 +1,76 @@
+#ifndef K_THREAD_POOL_H
+#define K_THREAD_POOL_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// Work-stealing thread pool.
+// Every worker has its own deque: owner pushes and pops from the tail,
+// other workers steal from the head. Threads which are not workers
+// (main thread for example) submit tasks into one more "external" deque
+// and help executing tasks while waiting in ThreadPoolWait().
+//
+// Worker indexes are in [0, ThreadPoolSlotsCnt()), the last one is external,
+// so per-worker data (arenas, contexts) can be stored in plain arrays.
+
+typedef void (*taskFunc_t) (void *arg, size_t workerIdx);
+
+struct taskGroup_t
+{
+    size_t pending = 0;
+};
+
+struct task_t
+{
+    taskFunc_t func     = NULL;
+    void *arg           = NULL;
+    taskGroup_t *group  = NULL;
+};
+
+struct taskDeque_t
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+    task_t *tasks   = NULL;
+    size_t capacity = 0;
+    size_t head     = 0; // thieves take from here
+    size_t size     = 0;
+};
+
+struct threadPool_t;
+
+struct workerArg_t
+{
+    threadPool_t *pool  = NULL;
+    size_t workerIdx    = 0;
+};
+
+struct threadPool_t
+{
+    pthread_t *threads      = NULL;
+    workerArg_t *workerArgs = NULL;
+    size_t threadsCnt       = 0;
+
+    taskDeque_t *deques     = NULL; // threadsCnt + 1
+
+    pthread_mutex_t sleepLock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t  sleepCond = PTHREAD_COND_INITIALIZER;
+
+    size_t queued   = 0; // tasks in all deques, atomic
+    bool stop       = false;
+};
+
+// threadsCnt = 0 - number of online processors
+int ThreadPoolCtor          (threadPool_t *pool, size_t threadsCnt);
+void ThreadPoolDtor         (threadPool_t *pool);
+
+size_t ThreadPoolSlotsCnt   (threadPool_t *pool);
+size_t ThreadPoolExternalIdx(threadPool_t *pool);
+
+// workerIdx - index of the calling thread: task argument inside tasks,
+// ThreadPoolExternalIdx() outside of them
+int ThreadPoolSubmit        (threadPool_t *pool, size_t workerIdx, taskGroup_t *group,
+                             taskFunc_t func, void *arg);
+void ThreadPoolWait         (threadPool_t *pool, size_t workerIdx, taskGroup_t *group);
+
+#endif // K_THREAD_POOL_H
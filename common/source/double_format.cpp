@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <assert.h>
+#include <charconv>
+
+#include "double_format.h"
+
+size_t FormatDouble (char *buffer, double value, doubleFormat_t format)
+{
+    assert (buffer);
+
+    std::to_chars_result result = {};
+
+    if (format.mode == DOUBLE_FORMAT_FIXED)
+    {
+        int precision = format.precision;
+
+        if (precision < 1)                          precision = 1;
+        if (precision > kDoubleFormatMaxPrecision)  precision = kDoubleFormatMaxPrecision;
+
+        result = std::to_chars (buffer, buffer + kDoubleFormatMaxLen, value,
+                                std::chars_format::general, precision);
+    }
+    else
+    {
+        result = std::to_chars (buffer, buffer + kDoubleFormatMaxLen, value);
+    }
+
+    assert (result.ec == std::errc ());
+
+    return (size_t) (result.ptr - buffer);
+}
+
+void FprintDouble (FILE *file, double value, doubleFormat_t format)
+{
+    assert (file);
+
+    char buffer[kDoubleFormatMaxLen] = {};
+    size_t len = FormatDouble (buffer, value, format);
+
+    fwrite (buffer, sizeof (char), len, file);
+}
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "process_manager.h"
+
+#include "debug.h"
+
+extern char **environ;
+
+static int ProcessExitStatus    (const char *name, int waitStatus);
+static void ProcessManagerRemove(processManager_t *manager, size_t idx);
+
+int ProcessStart (process_t *process, const char * const *argv, int flags)
+{
+    assert (process);
+    assert (argv);
+    assert (argv[0]);
+
+    process->pid   = -1;
+    process->input = NULL;
+
+    posix_spawn_file_actions_t actions = {};
+    posix_spawn_file_actions_init (&actions);
+
+    // both ends are closed on exec, so other children don't keep the pipe open
+    int pipeFds[2] = {-1, -1};
+
+    if ((flags & PROCESS_WITH_INPUT) && pipe2 (pipeFds, O_CLOEXEC) != 0)
+    {
+        ERROR_LOG ("Error in pipe2() - %s", strerror (errno));
+
+        posix_spawn_file_actions_destroy (&actions);
+
+        return COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
+    }
+
+    if (flags & PROCESS_WITH_INPUT)
+        posix_spawn_file_actions_adddup2 (&actions, pipeFds[0], STDIN_FILENO);
+
+    if (flags & PROCESS_QUIET)
+        posix_spawn_file_actions_addopen (&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    int status = posix_spawnp (&process->pid, argv[0], &actions, NULL,
+                               const_cast<char * const *> (argv), environ);
+
+    posix_spawn_file_actions_destroy (&actions);
+
+    if (flags & PROCESS_WITH_INPUT)
+        close (pipeFds[0]);
+
+    if (status != 0)
+    {
+        ERROR_PRINT ("Error starting \"%s\" - %s", argv[0], strerror (status));
+
+        if (flags & PROCESS_WITH_INPUT)
+            close (pipeFds[1]);
+
+        process->pid = -1;
+
+        return COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
+    }
+
+    if (flags & PROCESS_WITH_INPUT)
+    {
+        process->input = fdopen (pipeFds[1], "w");
+        if (process->input == NULL)
+        {
+            ERROR_LOG ("Error in fdopen() - %s", strerror (errno));
+
+            close (pipeFds[1]);
+            ProcessWait (process);
+
+            return COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
+        }
+    }
+
+    DEBUG_LOG ("Started \"%s\", pid = %d", argv[0], process->pid);
+
+    return COMMON_ERROR_OK;
+}
+
+int ProcessWait (process_t *process)
+{
+    assert (process);
+
+    if (process->input != NULL)
+    {
+        sigset_t oldSet = {};
+        ProcessSigpipeBlock (&oldSet);
+
+        fclose (process->input);
+
+        ProcessSigpipeRestore (&oldSet);
+
+        process->input = NULL;
+    }
+
+    if (process->pid == -1)
+        return COMMON_ERROR_OK;
+
+    int waitStatus = 0;
+    pid_t pid = -1;
+
+    do
+    {
+        pid = waitpid (process->pid, &waitStatus, 0);
+    }
+    while (pid == -1 && errno == EINTR);
+
+    char name[32] = {};
+    snprintf (name, sizeof (name), "pid %d", process->pid);
+
+    process->pid = -1;
+
+    if (pid == -1)
+    {
+        ERROR_LOG ("Error in waitpid() - %s", strerror (errno));
+
+        return COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
+    }
+
+    return ProcessExitStatus (name, waitStatus);
+}
+
+bool ProcessTryWait (process_t *process, int *status)
+{
+    assert (process);
+    assert (status);
+
+    if (process->pid == -1)
+    {
+        *status = COMMON_ERROR_OK;
+
+        return true;
+    }
+
+    int waitStatus = 0;
+    pid_t pid = waitpid (process->pid, &waitStatus, WNOHANG);
+
+    if (pid == 0)
+        return false;
+
+    char name[32] = {};
+    snprintf (name, sizeof (name), "pid %d", process->pid);
+
+    process->pid = -1;
+
+    *status = (pid == -1) ? COMMON_ERROR_RUNNING_SYSTEM_COMMAND
+                          : ProcessExitStatus (name, waitStatus);
+
+    return true;
+}
+
+int ProcessExitStatus (const char *name, int waitStatus)
+{
+    assert (name);
+
+    if (WIFEXITED (waitStatus) && WEXITSTATUS (waitStatus) == 0)
+        return COMMON_ERROR_OK;
+
+    ERROR_PRINT ("Process %s failed, wait status = %d", name, waitStatus);
+
+    return COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
+}
+
+void ProcessSigpipeBlock (sigset_t *oldSet)
+{
+    assert (oldSet);
+
+    sigset_t pipeSet = {};
+    sigemptyset (&pipeSet);
+    sigaddset   (&pipeSet, SIGPIPE);
+
+    pthread_sigmask (SIG_BLOCK, &pipeSet, oldSet);
+}
+
+// pending SIGPIPE of this thread is consumed, otherwise it kills us after unblocking
+void ProcessSigpipeRestore (const sigset_t *oldSet)
+{
+    assert (oldSet);
+
+    sigset_t pending = {};
+    sigpending (&pending);
+
+    if (sigismember (&pending, SIGPIPE) && !sigismember (oldSet, SIGPIPE))
+    {
+        sigset_t pipeSet = {};
+        sigemptyset (&pipeSet);
+        sigaddset   (&pipeSet, SIGPIPE);
+
+        struct timespec noWait = {};
+        sigtimedwait (&pipeSet, NULL, &noWait);
+    }
+
+    pthread_sigmask (SIG_SETMASK, oldSet, NULL);
+}
+
+int ProcessManagerRun (processManager_t *manager, const char * const *argv, int flags)
+{
+    assert (manager);
+    assert (argv);
+
+    manager->status |= ProcessManagerPoll (manager);
+
+    // the oldest one is most likely to finish first
+    while (manager->runningCnt >= kProcessesMaxRunning)
+    {
+        manager->status |= ProcessWait (&manager->running[0]);
+
+        ProcessManagerRemove (manager, 0);
+    }
+
+    if (manager->runningCnt == manager->capacity)
+    {
+        size_t newCapacity = (manager->capacity == 0) ? kProcessesMaxRunning : manager->capacity * 2;
+
+        process_t *newRunning = (process_t *) realloc (manager->running, newCapacity * sizeof (process_t));
+        if (newRunning == NULL)
+        {
+            ERROR_LOG ("Error reallocating memory for processes - %s", strerror (errno));
+
+            return COMMON_ERROR_REALLOCATING_MEMORY;
+        }
+
+        manager->running  = newRunning;
+        manager->capacity = newCapacity;
+    }
+
+    // input of tracked processes is never written
+    process_t *process = &manager->running[manager->runningCnt];
+
+    int status = ProcessStart (process, argv, flags & ~PROCESS_WITH_INPUT);
+    if (status != COMMON_ERROR_OK)
+        return status;
+
+    manager->runningCnt++;
+
+    return COMMON_ERROR_OK;
+}
+
+int ProcessManagerPoll (processManager_t *manager)
+{
+    assert (manager);
+
+    int status = COMMON_ERROR_OK;
+
+    for (size_t i = 0; i < manager->runningCnt; )
+    {
+        int processStatus = COMMON_ERROR_OK;
+
+        if (ProcessTryWait (&manager->running[i], &processStatus))
+        {
+            status |= processStatus;
+
+            ProcessManagerRemove (manager, i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return status;
+}
+
+int ProcessManagerWaitAll (processManager_t *manager)
+{
+    assert (manager);
+
+    int status = manager->status;
+
+    for (size_t i = 0; i < manager->runningCnt; i++)
+    {
+        status |= ProcessWait (&manager->running[i]);
+    }
+
+    manager->runningCnt = 0;
+    manager->status     = COMMON_ERROR_OK;
+
+    return status;
+}
+
+void ProcessManagerDtor (processManager_t *manager)
+{
+    assert (manager);
+
+    ProcessManagerWaitAll (manager);
+
+    free (manager->running);
+
+    manager->running    = NULL;
+    manager->capacity   = 0;
+}
+
+// keeps order of start
+void ProcessManagerRemove (processManager_t *manager, size_t idx)
+{
+    assert (manager);
+    assert (idx < manager->runningCnt);
+
+    memmove (&manager->running[idx], &manager->running[idx + 1],
+             (manager->runningCnt - idx - 1) * sizeof (process_t));
+
+    manager->runningCnt--;
+}
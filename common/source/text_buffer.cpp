@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "text_buffer.h"
+
+#include "debug.h"
+
+int TextBufferCtor (textBuffer_t *buffer, size_t capacity)
+{
+    assert (buffer);
+
+    buffer->size     = 0;
+    buffer->capacity = 0;
+    buffer->failed   = false;
+
+    buffer->data = (char *) calloc (capacity + 1, sizeof (char));
+    if (buffer->data == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for text buffer - %s", strerror (errno));
+
+        buffer->failed = true;
+
+        return COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    buffer->capacity = capacity;
+
+    return COMMON_ERROR_OK;
+}
+
+void TextBufferDtor (textBuffer_t *buffer)
+{
+    assert (buffer);
+
+    free (buffer->data);
+
+    buffer->data     = NULL;
+    buffer->size     = 0;
+    buffer->capacity = 0;
+}
+
+// data always has place for '\0' after capacity
+bool TextBufferReserve (textBuffer_t *buffer, size_t extraSize)
+{
+    assert (buffer);
+
+    if (buffer->failed)
+        return false;
+
+    if (buffer->size + extraSize <= buffer->capacity)
+        return true;
+
+    size_t newCapacity = (buffer->capacity == 0) ? kTextBufferStartCapacity : buffer->capacity;
+    while (newCapacity < buffer->size + extraSize)
+        newCapacity *= 2;
+
+    char *newData = (char *) realloc (buffer->data, newCapacity + 1);
+    if (newData == NULL)
+    {
+        ERROR_LOG ("Error reallocating memory for text buffer - %s", strerror (errno));
+
+        buffer->failed = true;
+
+        return false;
+    }
+
+    buffer->data     = newData;
+    buffer->capacity = newCapacity;
+
+    return true;
+}
+
+void TextBufferAppend (textBuffer_t *buffer, const char *str, size_t len)
+{
+    assert (buffer);
+    assert (str);
+
+    if (!TextBufferReserve (buffer, len))
+        return;
+
+    memcpy (buffer->data + buffer->size, str, len);
+    buffer->size += len;
+}
+
+void TextBufferPuts (textBuffer_t *buffer, const char *str)
+{
+    assert (str);
+
+    TextBufferAppend (buffer, str, strlen (str));
+}
+
+void TextBufferPutc (textBuffer_t *buffer, char c)
+{
+    assert (buffer);
+
+    if (!TextBufferReserve (buffer, 1))
+        return;
+
+    buffer->data[buffer->size++] = c;
+}
+
+void TextBufferTruncate (textBuffer_t *buffer, size_t size)
+{
+    assert (buffer);
+    assert (size <= buffer->size);
+
+    buffer->size = size;
+}
+
+void TextBufferPrintf (textBuffer_t *buffer, const char *format, ...)
+{
+    assert (buffer);
+    assert (format);
+
+    // vsnprintf() needs place at least for '\0'
+    if (buffer->data == NULL && !TextBufferReserve (buffer, 1))
+        return;
+
+    if (buffer->failed)
+        return;
+
+    va_list args;
+
+    va_start (args, format);
+    int len = vsnprintf (buffer->data + buffer->size, buffer->capacity - buffer->size + 1, format, args);
+    va_end (args);
+
+    if (len < 0)
+    {
+        ERROR_LOG ("Error in vsnprintf(), return code = %d", len);
+
+        buffer->failed = true;
+
+        return;
+    }
+
+    // didn't fit, once more with enough space
+    if (buffer->size + (size_t) len > buffer->capacity)
+    {
+        if (!TextBufferReserve (buffer, (size_t) len))
+            return;
+
+        va_start (args, format);
+        vsnprintf (buffer->data + buffer->size, buffer->capacity - buffer->size + 1, format, args);
+        va_end (args);
+    }
+
+    buffer->size += (size_t) len;
+}
+
+void TextBufferDouble (textBuffer_t *buffer, double value, doubleFormat_t format)
+{
+    assert (buffer);
+
+    if (!TextBufferReserve (buffer, kDoubleFormatMaxLen))
+        return;
+
+    buffer->size += FormatDouble (buffer->data + buffer->size, value, format);
+}
+
+int TextBufferWriteFile (textBuffer_t *buffer, const char *fileName)
+{
+    assert (buffer);
+    assert (fileName);
+
+    if (buffer->failed)
+    {
+        ERROR_LOG ("Text for \"%s\" is incomplete, there was an allocation error", fileName);
+
+        return COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    int fd = open (fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        ERROR_LOG ("Error opening file \"%s\" - %s", fileName, strerror (errno));
+
+        return COMMON_ERROR_OPENING_FILE;
+    }
+
+    size_t written = 0;
+    while (written < buffer->size)
+    {
+        ssize_t len = write (fd, buffer->data + written, buffer->size - written);
+        if (len == -1 && errno == EINTR)
+            continue;
+
+        if (len == -1)
+        {
+            ERROR_LOG ("Error writing file \"%s\" - %s", fileName, strerror (errno));
+
+            close (fd);
+
+            return COMMON_ERROR_WRITE_TO_FILE;
+        }
+
+        written += (size_t) len;
+    }
+
+    close (fd);
+
+    return COMMON_ERROR_OK;
+}
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+#include "debug.h"
+
+const size_t kDequeStartCapacity = 64;
+
+static void *WorkerLoop     (void *arg);
+static bool TryGetTask      (threadPool_t *pool, size_t workerIdx, unsigned int *seed, task_t *task);
+static void RunTask         (task_t *task, size_t workerIdx);
+static bool DequePopTail    (taskDeque_t *deque, task_t *task);
+static bool DequeStealHead  (taskDeque_t *deque, task_t *task);
+static int  DequePushTail   (taskDeque_t *deque, task_t *task);
+
+int ThreadPoolCtor (threadPool_t *pool, size_t threadsCnt)
+{
+    assert (pool);
+
+    if (threadsCnt == 0)
+    {
+        long onlineCnt = sysconf (_SC_NPROCESSORS_ONLN);
+        threadsCnt = (onlineCnt > 0) ? (size_t) onlineCnt : 1;
+    }
+
+    pool->threadsCnt = threadsCnt;
+    pool->queued     = 0;
+    pool->stop       = false;
+
+    pthread_mutex_init (&pool->sleepLock, NULL);
+    pthread_cond_init  (&pool->sleepCond, NULL);
+
+    pool->threads    = (pthread_t *)   calloc (threadsCnt,     sizeof (pthread_t));
+    pool->workerArgs = (workerArg_t *) calloc (threadsCnt,     sizeof (workerArg_t));
+    pool->deques     = (taskDeque_t *) calloc (threadsCnt + 1, sizeof (taskDeque_t));
+
+    if (pool->threads == NULL || pool->workerArgs == NULL || pool->deques == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for thread pool - %s", strerror (errno));
+
+        free (pool->threads);
+        free (pool->workerArgs);
+        free (pool->deques);
+
+        return COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    for (size_t i = 0; i < threadsCnt + 1; i++)
+    {
+        pthread_mutex_init (&pool->deques[i].lock, NULL);
+    }
+
+    for (size_t i = 0; i < threadsCnt; i++)
+    {
+        pool->workerArgs[i].pool      = pool;
+        pool->workerArgs[i].workerIdx = i;
+
+        int status = pthread_create (&pool->threads[i], NULL, WorkerLoop, &pool->workerArgs[i]);
+        if (status != 0)
+        {
+            ERROR_LOG ("Error creating thread - %s", strerror (status));
+
+            // join already started workers
+            pool->threadsCnt = i;
+            ThreadPoolDtor (pool);
+
+            return COMMON_ERROR_CREATING_THREAD;
+        }
+    }
+
+    DEBUG_LOG ("Thread pool with %lu workers created", threadsCnt);
+
+    return COMMON_ERROR_OK;
+}
+
+void ThreadPoolDtor (threadPool_t *pool)
+{
+    assert (pool);
+
+    pthread_mutex_lock (&pool->sleepLock);
+    pool->stop = true;
+    pthread_cond_broadcast (&pool->sleepCond);
+    pthread_mutex_unlock (&pool->sleepLock);
+
+    for (size_t i = 0; i < pool->threadsCnt; i++)
+    {
+        pthread_join (pool->threads[i], NULL);
+    }
+
+    if (pool->deques != NULL)
+    {
+        for (size_t i = 0; i < pool->threadsCnt + 1; i++)
+        {
+            free (pool->deques[i].tasks);
+            pthread_mutex_destroy (&pool->deques[i].lock);
+        }
+    }
+
+    pthread_mutex_destroy (&pool->sleepLock);
+    pthread_cond_destroy  (&pool->sleepCond);
+
+    free (pool->threads);
+    free (pool->workerArgs);
+    free (pool->deques);
+
+    pool->threads    = NULL;
+    pool->workerArgs = NULL;
+    pool->deques     = NULL;
+    pool->threadsCnt = 0;
+}
+
+size_t ThreadPoolSlotsCnt (threadPool_t *pool)
+{
+    assert (pool);
+
+    return pool->threadsCnt + 1;
+}
+
+size_t ThreadPoolExternalIdx (threadPool_t *pool)
+{
+    assert (pool);
+
+    return pool->threadsCnt;
+}
+
+int ThreadPoolSubmit (threadPool_t *pool, size_t workerIdx, taskGroup_t *group,
+                      taskFunc_t func, void *arg)
+{
+    assert (pool);
+    assert (workerIdx <= pool->threadsCnt);
+    assert (group);
+    assert (func);
+
+    task_t task = {.func = func, .arg = arg, .group = group};
+
+    // counters are incremented before push, so they never go below zero
+    __atomic_add_fetch (&group->pending, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch (&pool->queued,   1, __ATOMIC_RELEASE);
+
+    int status = DequePushTail (&pool->deques[workerIdx], &task);
+    if (status != COMMON_ERROR_OK)
+    {
+        __atomic_sub_fetch (&pool->queued,   1, __ATOMIC_RELEASE);
+        __atomic_sub_fetch (&group->pending, 1, __ATOMIC_RELEASE);
+
+        return status;
+    }
+
+    // signal under lock, so worker can't miss it between check and wait
+    pthread_mutex_lock (&pool->sleepLock);
+    pthread_cond_signal (&pool->sleepCond);
+    pthread_mutex_unlock (&pool->sleepLock);
+
+    return COMMON_ERROR_OK;
+}
+
+void ThreadPoolWait (threadPool_t *pool, size_t workerIdx, taskGroup_t *group)
+{
+    assert (pool);
+    assert (group);
+
+    unsigned int seed = (unsigned int) workerIdx * 2654435761u + 1;
+    task_t task = {};
+
+    while (__atomic_load_n (&group->pending, __ATOMIC_ACQUIRE) != 0)
+    {
+        if (TryGetTask (pool, workerIdx, &seed, &task))
+            RunTask (&task, workerIdx);
+        else
+            sched_yield ();
+    }
+}
+
+void *WorkerLoop (void *arg)
+{
+    assert (arg);
+
+    workerArg_t *workerArg = (workerArg_t *) arg;
+    threadPool_t *pool = workerArg->pool;
+    size_t workerIdx   = workerArg->workerIdx;
+
+    unsigned int seed = (unsigned int) workerIdx * 2654435761u + 1;
+    task_t task = {};
+
+    while (true)
+    {
+        if (TryGetTask (pool, workerIdx, &seed, &task))
+        {
+            RunTask (&task, workerIdx);
+
+            continue;
+        }
+
+        pthread_mutex_lock (&pool->sleepLock);
+
+        while (__atomic_load_n (&pool->queued, __ATOMIC_ACQUIRE) == 0 && !pool->stop)
+            pthread_cond_wait (&pool->sleepCond, &pool->sleepLock);
+
+        bool stop = pool->stop && __atomic_load_n (&pool->queued, __ATOMIC_ACQUIRE) == 0;
+
+        pthread_mutex_unlock (&pool->sleepLock);
+
+        if (stop)
+            break;
+    }
+
+    return NULL;
+}
+
+// own deque first, then steal starting from random victim
+bool TryGetTask (threadPool_t *pool, size_t workerIdx, unsigned int *seed, task_t *task)
+{
+    assert (pool);
+    assert (seed);
+    assert (task);
+
+    size_t dequesCnt = pool->threadsCnt + 1;
+
+    bool found = DequePopTail (&pool->deques[workerIdx], task);
+
+    if (!found)
+    {
+        size_t victim = (size_t) rand_r (seed) % dequesCnt;
+
+        for (size_t i = 0; i < dequesCnt && !found; i++)
+        {
+            size_t idx = (victim + i) % dequesCnt;
+
+            if (idx != workerIdx)
+                found = DequeStealHead (&pool->deques[idx], task);
+        }
+    }
+
+    if (found)
+        __atomic_sub_fetch (&pool->queued, 1, __ATOMIC_ACQ_REL);
+
+    return found;
+}
+
+void RunTask (task_t *task, size_t workerIdx)
+{
+    assert (task);
+
+    task->func (task->arg, workerIdx);
+
+    __atomic_sub_fetch (&task->group->pending, 1, __ATOMIC_RELEASE);
+}
+
+int DequePushTail (taskDeque_t *deque, task_t *task)
+{
+    assert (deque);
+    assert (task);
+
+    pthread_mutex_lock (&deque->lock);
+
+    if (deque->size == deque->capacity)
+    {
+        size_t newCapacity = (deque->capacity == 0) ? kDequeStartCapacity : deque->capacity * 2;
+
+        task_t *newTasks = (task_t *) calloc (newCapacity, sizeof (task_t));
+        if (newTasks == NULL)
+        {
+            pthread_mutex_unlock (&deque->lock);
+
+            ERROR_LOG ("Error allocating memory for tasks - %s", strerror (errno));
+
+            return COMMON_ERROR_ALLOCATING_MEMORY;
+        }
+
+        for (size_t i = 0; i < deque->size; i++)
+        {
+            newTasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        }
+
+        free (deque->tasks);
+
+        deque->tasks    = newTasks;
+        deque->capacity = newCapacity;
+        deque->head     = 0;
+    }
+
+    deque->tasks[(deque->head + deque->size) % deque->capacity] = *task;
+    deque->size++;
+
+    pthread_mutex_unlock (&deque->lock);
+
+    return COMMON_ERROR_OK;
+}
+
+bool DequePopTail (taskDeque_t *deque, task_t *task)
+{
+    assert (deque);
+    assert (task);
+
+    pthread_mutex_lock (&deque->lock);
+
+    bool found = deque->size > 0;
+    if (found)
+    {
+        deque->size--;
+        *task = deque->tasks[(deque->head + deque->size) % deque->capacity];
+    }
+
+    pthread_mutex_unlock (&deque->lock);
+
+    return found;
+}
+
+bool DequeStealHead (taskDeque_t *deque, task_t *task)
+{
+    assert (deque);
+    assert (task);
+
+    // don't wait for busy deque, there are other victims
+    if (pthread_mutex_trylock (&deque->lock) != 0)
+        return false;
+
+    bool found = deque->size > 0;
+    if (found)
+    {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->size--;
+    }
+
+    pthread_mutex_unlock (&deque->lock);
+
+    return found;
+}
@@ -0,0 +1,167 @@
+#ifndef K_LIBDIFFERENTIATOR_H
+#define K_LIBDIFFERENTIATOR_H
+
+// C API of differentiator. Every context owns all of its state
+// (trees, variables, buffers) and never writes any dumps or asks user,
+// so different contexts can be used from different threads without locks.
+// One context must not be used from several threads at the same time.
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct diffContext_t diffContext_t;
+typedef struct diffChebyshev_t diffChebyshev_t;
+typedef struct diffCompiled_t diffCompiled_t;
+
+// 0 on success, otherwise bit mask of errors, the same as treeError_t of tree.h.
+// With DIFF_ERROR_COMMON set other bits are errors of common library
+// (memory, files, threads), not the ones below
+enum diffStatus_t
+{
+    DIFF_OK                         = 0,
+    DIFF_ERROR_NULL_STRUCT          = 1 << 0,
+    DIFF_ERROR_NULL_ROOT            = 1 << 1,   // no expression
+    DIFF_ERROR_NULL_DATA            = 1 << 2,
+    DIFF_ERROR_NOT_ENOUGH_NODES     = 1 << 3,
+    DIFF_ERROR_TO_MUCH_NODES        = 1 << 4,
+    DIFF_ERROR_LOAD_INTO_NOT_EMPTY  = 1 << 5,
+    DIFF_ERROR_INVALID_NODE         = 1 << 6,
+    DIFF_ERROR_INVALID_PATH         = 1 << 7,
+    DIFF_ERROR_CREATING_NODE        = 1 << 8,
+    DIFF_ERROR_SYNTAX               = 1 << 9,   // expression can't be parsed
+    DIFF_ERROR_WRONG_ARGUMENT       = 1 << 10,
+    DIFF_ERROR_NODE_NOT_FOUND       = 1 << 11,
+    DIFF_ERROR_SINGULAR             = 1 << 12,
+    DIFF_ERROR_NOT_CONVERGED        = 1 << 13,  // result is computed, but not to tolerance
+
+    DIFF_ERROR_COMMON               = -2147483647 - 1 // 1 << 31
+};
+
+diffContext_t *DiffContextCreate    (void);
+void DiffContextFree                (diffContext_t *ctx);
+
+// Previous expression and its derivatives are dropped
+int DiffContextParse                (diffContext_t *ctx, const char *expression);
+
+// Computes derivatives of orders 1..times (each one is simplified)
+int DiffContextDifferentiate        (diffContext_t *ctx, const char *varName, size_t times);
+int DiffContextSimplify             (diffContext_t *ctx);
+
+int DiffContextSetVariable          (diffContext_t *ctx, const char *varName, double value);
+
+// order = 0 - expression itself, order = k - k-th derivative.
+// Variables without value are evaluated as NAN
+int DiffContextEvaluate             (diffContext_t *ctx, size_t order, double *result);
+
+// Bounds of expression (or derivative) for varName anywhere in [from, to]
+// by interval arithmetic, other variables are taken with their values.
+// Bounds are guaranteed but can be wider than real ones.
+// *undefined = 1 if somewhere in the range value is not finite,
+// *min > *max if it is finite nowhere
+int DiffContextBound                (diffContext_t *ctx, size_t order, const char *varName,
+                                     double from, double to,
+                                     double *min, double *max, int *undefined);
+
+// Taylor coefficients at varName = center: coefs[k] = f^(k) (center) / k!,
+// coefsCnt <= DiffContextDerivativesCount () + 1, derivatives must be taken by varName.
+// Polynomial is sum coefs[k] * (x - center)^k, see DiffTaylorEvaluate()
+int DiffContextTaylor               (diffContext_t *ctx, const char *varName, double center,
+                                     double *coefs, size_t coefsCnt);
+// The same for many centers at once, in parallel on temporary thread pool,
+// coefficients of centers[i] are coefs[i * coefsCnt .. (i + 1) * coefsCnt)
+int DiffContextTaylorCenters        (diffContext_t *ctx, const char *varName,
+                                     const double *centers, size_t centersCnt,
+                                     double *coefs, size_t coefsCnt);
+double DiffTaylorEvaluate           (const double *coefs, size_t coefsCnt, double center, double x);
+
+// Pade approximant [numDegree / denDegree] at varName = center:
+// sum num[k] t^k / sum den[k] t^k, t = x - center, den[0] = 1,
+// num has numDegree + 1 elements, den - denDegree + 1.
+// Needs numDegree + denDegree derivatives, DIFF_ERROR_SINGULAR
+// if there is no approximant of this shape. See DiffPadeEvaluate()
+int DiffContextPade                 (diffContext_t *ctx, const char *varName, double center,
+                                     size_t numDegree, size_t denDegree,
+                                     double *num, double *den);
+double DiffPadeEvaluate             (const double *num, size_t numDegree,
+                                     const double *den, size_t denDegree,
+                                     double center, double x);
+
+// Piecewise chebyshev approximation of expression (or derivative) by varName
+// on [from, to] with error about tolerance * max (1, |f|), other variables are
+// taken with their current values. Doesn't depend on context after creation and
+// can be evaluated from any number of threads. NULL with *status = DIFF_ERROR_SINGULAR
+// if expression is not finite somewhere in the range or too wiggly for tolerance
+diffChebyshev_t *DiffContextApproximate (diffContext_t *ctx, size_t order, const char *varName,
+                                         double from, double to, double tolerance, int *status);
+void DiffChebyshevFree              (diffChebyshev_t *approx);
+double DiffChebyshevEvaluate        (const diffChebyshev_t *approx, double x);
+
+// Expression and all derivatives compiled into native code by cc and loaded
+// with dlopen(). Shared object is kept in ~/.cache/differentiator/ (or
+// $XDG_CACHE_HOME/differentiator/, or DIFFERENTIATOR_CACHE), the same expression
+// next time is only loaded, if its saved source is the same. Other variables are taken
+// with their current values. Doesn't depend on context after creation and
+// can be evaluated from any number of threads, values are the same as of
+// DiffContextEvaluate() except pow (x, 2): compiler makes it x * x,
+// libm pow() can differ from it in the last bit
+diffCompiled_t *DiffContextCompile  (diffContext_t *ctx, const char *varName, int *status);
+void DiffCompiledFree               (diffCompiled_t *compiled);
+// order as in DiffContextEvaluate(), NAN if there is no such derivative
+double DiffCompiledEvaluate         (const diffCompiled_t *compiled, size_t order, double x);
+
+// Roots of expression by varName in [from, to]: sign changes on a grid,
+// each one polished in parallel by Halley iterations (Newton with one derivative,
+// bisection without derivatives), poles are dropped. Derivatives must be taken
+// by varName. *rootsCnt is the number of roots found, only first
+// rootsCapacity of them are written in ascending order
+int DiffContextRoots                (diffContext_t *ctx, const char *varName,
+                                     double from, double to,
+                                     double *roots, size_t rootsCapacity, size_t *rootsCnt);
+
+enum diffExtremumType_t
+{
+    DIFF_EXTREMUM_MIN           = 0,
+    DIFF_EXTREMUM_MAX           = 1,
+    DIFF_EXTREMUM_INFLECTION    = 2
+};
+
+typedef struct diffExtremum_t
+{
+    double x;
+    double y;   // value of expression in x
+    int type;   // diffExtremumType_t
+} diffExtremum_t;
+
+// Extrema (roots of the first derivative with sign change) and inflection
+// points (of the second) by varName in [from, to], found like in DiffContextRoots().
+// Derivatives must be taken by varName: minima and maxima need one,
+// inflections - two. *pointsCnt is the number of points found, only first
+// pointsCapacity of them are written in ascending order
+int DiffContextExtrema              (diffContext_t *ctx, const char *varName,
+                                     double from, double to,
+                                     diffExtremum_t *points, size_t pointsCapacity, size_t *pointsCnt);
+
+// Integral of expression by varName on [from, to], adaptive Gauss-Kronrod 7-15
+// with intervals evaluated in parallel. Stops when estimate of absolute error
+// is below tolerance * (integral of |f|), *error is that estimate.
+// Derivatives are not needed, if they are taken - only by varName.
+// DIFF_ERROR_NOT_CONVERGED if tolerance isn't reached with the maximum number
+// of intervals (4096), *value and *error are still the last estimates.
+// DIFF_ERROR_SINGULAR if expression is not finite in one of the nodes. Nodes are
+// inside intervals, so a pole at from or to is never sampled: such integral
+// either converges (1 / sqrt (x) on [0, 1]) or ends with DIFF_ERROR_NOT_CONVERGED
+int DiffContextIntegrate            (diffContext_t *ctx, const char *varName,
+                                     double from, double to, double tolerance,
+                                     double *value, double *error);
+
+size_t DiffContextVariablesCount    (const diffContext_t *ctx);
+size_t DiffContextDerivativesCount  (const diffContext_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // K_LIBDIFFERENTIATOR_H
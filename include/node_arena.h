@@ -0,0 +1,30 @@
+#ifndef K_NODE_ARENA_H
+#define K_NODE_ARENA_H
+
+#include <stdio.h>
+
+struct node_t;
+
+// Allocator of nodes for one thread.
+// Nodes are taken from big blocks, deleted nodes go to free list
+// and are reused, so batch of expressions doesn't call malloc for every node.
+// Blocks are returned to system only in NodeArenaDtor().
+
+const size_t kNodeArenaBlockSize = 4096;
+
+struct nodeArenaBlock_t;
+
+struct nodeArena_t
+{
+    nodeArenaBlock_t *blocks = NULL;
+    size_t blockUsed         = kNodeArenaBlockSize; // nodes used in blocks
+
+    node_t *freeList         = NULL; // linked by node->left
+};
+
+int NodeArenaCtor       (nodeArena_t *arena);
+void NodeArenaDtor      (nodeArena_t *arena);
+node_t *NodeArenaAlloc  (nodeArena_t *arena);
+void NodeArenaFree      (nodeArena_t *arena, node_t *node);
+
+#endif // K_NODE_ARENA_H
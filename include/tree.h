@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 #include "tree_log.h"
+#include "node_arena.h"
 #include "debug.h"
 
 typedef union value_t treeDataType;
@@ -56,6 +57,18 @@ struct varInfo_t
                            .line = __LINE__,        \
                            .func = __func__})
 
+#define TREE_VERIFY(tree) TreeVerify (tree) 
+#else
+
+#define TREE_CTOR(treeName, log) TreeCtor (treeName, log) 
+#define TREE_VERIFY(tree) TREE_OK;
+
+#endif // PRING_DEBUG
+
+// graph dumps are slow even when batched, so they need their own flag
+// (make dump), without it only diff is "used", other arguments are not evaluated
+#if defined (PRINT_DEBUG) && defined (TREE_GRAPH_DUMP)
+
 #define TREE_DUMP(diff, treeName, format, ...)      \
         TreeDump (diff, treeName,                   \
                   __FILE__, __LINE__, __func__,     \
@@ -65,16 +78,12 @@ struct varInfo_t
         NodeDump (diff, nodeName,                   \
                   __FILE__, __LINE__, __func__,     \
                   format, __VA_ARGS__)
-
-#define TREE_VERIFY(tree) TreeVerify (tree) 
 #else
 
-#define TREE_CTOR(treeName, log) TreeCtor (treeName, log) 
-#define TREE_VERIFY(tree) TREE_OK;
-#define TREE_DUMP(diff, tree, format, ...) 
-#define NODE_DUMP(diff, node, format, ...) 
+#define TREE_DUMP(diff, tree, format, ...) (void) (diff)
+#define NODE_DUMP(diff, node, format, ...) (void) (diff)
 
-#endif // PRING_DEBUG
+#endif // TREE_GRAPH_DUMP
 
 enum type_t // NOTE: maybe move to tree_calc.h
 {
@@ -108,6 +117,9 @@ struct tree_t
 
     treeLog_t *log = NULL;
 
+    // NULL - nodes are allocated with calloc()
+    nodeArena_t *arena = NULL;
+
 #ifdef PRINT_DEBUG
     varInfo_t varInfo = {};
 #endif
@@ -126,7 +138,10 @@ enum treeError_t
     TREE_ERROR_INVALID_PATH             = 1 << 7, // bad value on stackNodePath // FIXME
     TREE_ERROR_CREATING_NODE            = 1 << 8,
     TREE_ERROR_SYNTAX_IN_SAVE_FILE      = 1 << 9,
+    TREE_ERROR_WRONG_ARGUMENT           = 1 << 10,
     TREE_ERROR_NODE_NOT_FOUND           = 1 << 11,
+    TREE_ERROR_SINGULAR                 = 1 << 12, // system of equations has no single solution
+    TREE_ERROR_NOT_CONVERGED            = 1 << 13, // iterations stopped before tolerance
 
     TREE_ERROR_COMMON                   = 1 << 31
 };
@@ -0,0 +1,47 @@
+#ifndef K_TREE_BATCH_H
+#define K_TREE_BATCH_H
+
+#include <stdio.h>
+
+#include "double_format.h"
+#include "tree_log.h"
+
+// Batch mode: every non-empty line of input file (except '#' comments)
+// is an expression. Each one is parsed, differentiated, simplified
+// and expanded by Taylor independently on work-stealing thread pool.
+// Every worker has its own node arena and differentiator context.
+// Results are printed as JSON lines in the order of input (by sequence number).
+// Gradient and hessian of one expression are computed by nested tasks on the same pool.
+// With report option every expression also gets latex/pdf report with plots in its own
+// dump folder, reports are rendered by background threads (see tree_report.h).
+
+struct batchOptions_t
+{
+    const char *inputFileName = NULL;
+    size_t threadsCnt         = 0;    // 0 - number of processors
+    size_t diffTimes          = 1;
+    const char *varName       = NULL; // NULL - first variable of expression
+    double point              = 0;    // value of all variables
+    bool gradient             = false; // partial derivatives by all variables
+    bool hessian              = false;
+    bool report               = false; // dump/[date-time]_[seq]/ for every expression
+    doubleFormat_t numberFormat = {};  // numbers in reports, JSON is always shortest
+    size_t latexNodeLimit     = kLatexNodeLimit; // bigger trees in reports are summarized
+    bool pade                 = false; // pade approximant [padeNumDegree / padeDenDegree]
+    size_t padeNumDegree      = 0;
+    size_t padeDenDegree      = 0;
+    double chebyshevTolerance = 0;    // > 0 - plots in reports from chebyshev approximations
+    bool compile              = false; // plots in reports, roots, extrema and integral by native code, see tree_codegen.h
+    bool roots                = false; // roots of expression in [rootsLeft, rootsRight]
+    double rootsLeft          = 0;
+    double rootsRight         = 0;
+    bool extrema              = false; // extrema and inflections in plot range
+    bool integral             = false; // integral of expression on [integralLeft, integralRight]
+    double integralLeft       = 0;
+    double integralRight      = 0;
+    FILE *output              = NULL; // NULL - stdout
+};
+
+int TreeBatchRun (batchOptions_t *options);
+
+#endif // K_TREE_BATCH_H
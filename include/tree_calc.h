@@ -5,6 +5,8 @@
 
 #include "tree.h"
 
+struct threadPool_t;
+
 typedef size_t variable_idx_t; // TODO think
 
 enum keywordIdxes_t : variable_idx_t
@@ -49,6 +51,12 @@ struct differentiator_t
     tree_t *diffTrees   = NULL;
     size_t diffTreesCnt = 0;
 
+    // taylor as coefficients of (x - taylorCenter)^k, see tree_taylor.h
+    double *taylorCoefs         = NULL;
+    double *taylorDerivatives   = NULL; // f^(k) (taylorCenter), in the same block as taylorCoefs
+    size_t taylorCoefsCnt       = 0;
+    double taylorCenter         = 0;
+
     variable_t *variables    = NULL;
     size_t variablesCapacity = 0;
     size_t variablesSize     = 0;
@@ -56,6 +64,17 @@ struct differentiator_t
     variable_t *varToDiff = NULL;
 
     char *buffer = NULL;
+
+    // false - never ask user about anything (library mode),
+    // unknown variables are evaluated as NAN
+    bool interactive = true;
+
+    // not owned, used by all trees of differentiator, NULL - calloc()
+    nodeArena_t *arena = NULL;
+
+    // not owned, NULL - parallel parts create temporary pool
+    threadPool_t *pool = NULL;
+    size_t workerIdx   = 0; // index of the thread using diff in pool, see ThreadPoolSubmit()
 };
 
 struct keyword_t
@@ -103,12 +122,14 @@ const size_t kNumberOfKeywords = sizeof(keywords) / sizeof(keyword_t);
 
 
 int DifferentiatorCtor              (differentiator_t *diff, size_t variablesCapacity);
+int DifferentiatorCtorEmpty         (differentiator_t *diff, size_t variablesCapacity);
+void DifferentiatorCtorView         (differentiator_t *view, differentiator_t *source);
 void DifferentiatorDtor             (differentiator_t *diff);
 
 const char *GetTypeName             (type_t type);
 
 variable_t *FindVariableByIdx       (differentiator_t *diff, size_t idx);
-variable_t *FindVariableByName      (differentiator_t *diff, char *varName, size_t varNameLen);
+variable_t *FindVariableByName      (differentiator_t *diff, const char *varName, size_t varNameLen);
 const keyword_t *FindKeywordByIdx   (size_t idx);
 
 int CheckForReallocVariables        (differentiator_t *diff);
@@ -122,10 +143,14 @@ bool NodeFindVariable               (node_t *node, variable_t *argument);
 
 int TreeCalculate                   (differentiator_t *diff, tree_t *expression);
 double NodeCalculate                (differentiator_t *diff, node_t *node);
+double NodeCalculateAt              (differentiator_t *diff, node_t *node,
+                                     size_t varIdx, double varValue);
 
 void TreeSimplify                   (differentiator_t *diff, tree_t *tree);
 
 int TreesDiff                       (differentiator_t *diff, tree_t *expression);
+int TreesDiffByVariable             (differentiator_t *diff, tree_t *expression,
+                                     variable_t *var, size_t diffTimes);
 node_t *NodeDiff                    (differentiator_t *diff, node_t *expression, tree_t *tree,
                                      variable_t *argument);
 
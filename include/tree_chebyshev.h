@@ -0,0 +1,49 @@
+#ifndef K_TREE_CHEBYSHEV_H
+#define K_TREE_CHEBYSHEV_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+// Piecewise Chebyshev approximation of a tree on fixed [left, right].
+// Range is halved while series of kChebyshevDegree coefficients (from values
+// in Chebyshev nodes) doesn't reach tolerance, so smooth parts get long pieces.
+// Evaluation is a branchless binary search of piece and Clenshaw recurrence:
+// its cost depends only on number of pieces, not on the tree.
+// Functions which are not finite somewhere in range (poles, ln of negative)
+// or too wiggly to reach tolerance in kChebyshevMaxDepth halvings
+// can't be approximated, TREE_ERROR_SINGULAR is returned for them.
+
+const size_t kChebyshevDegree   = 16; // coefficients in piece
+const size_t kChebyshevMaxDepth = 12; // halvings of range, 4096 pieces at most
+
+struct chebyshevPiece_t
+{
+    double center                   = 0;
+    double invHalfWidth             = 0;
+    double coefs[kChebyshevDegree]  = {};
+};
+
+struct chebyshev_t
+{
+    double left                 = 0;
+    double right                = 0;
+
+    double *breaks              = NULL; // left ends of pieces in ascending order
+    chebyshevPiece_t *pieces    = NULL;
+    size_t piecesCnt            = 0;
+    size_t piecesCapacity       = 0;
+
+    size_t evaluationsCnt       = 0;    // of tree while building
+};
+
+// error is at most about tolerance * max (1, |f|) on every piece
+int  ChebyshevCtor          (chebyshev_t *cheb, differentiator_t *diff, node_t *root,
+                             size_t varIdx, double left, double right, double tolerance);
+void ChebyshevDtor          (chebyshev_t *cheb);
+
+// x outside of [left, right] is extrapolated by the nearest piece
+double ChebyshevEvaluate    (const chebyshev_t *cheb, double x);
+
+#endif // K_TREE_CHEBYSHEV_H
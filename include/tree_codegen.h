@@ -0,0 +1,73 @@
+#ifndef K_TREE_CODEGEN_H
+#define K_TREE_CODEGEN_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+// Trees of differentiator compiled into native code.
+// Expression, every derivative and taylor become C functions
+// double f (const double *variables, double x): one temporary for every
+// distinct subtree (interned like in tree_latex_share.h), so common
+// subexpressions are computed once. Source is compiled by kCodegenCompiler
+// into shared object named by hash of the source and loaded with dlopen().
+// Shared objects stay in cache folder, the same trees next time are
+// only loaded, if source saved next to object is the same (hash can collide).
+// Cache folder must belong to user and be closed for others, because
+// anything in it can be loaded. Code is built for this processor
+// (-march=native), so cache must not be shared between machines.
+// Contraction into fma is off, so results are the same as of NodeCalculateAt()
+// except pow (x, 2): compiler makes it x * x, libm pow() can differ in last bit.
+
+const char kCodegenCacheEnvName[] = "DIFFERENTIATOR_CACHE"; // overrides kCodegenCacheDir
+const char kCodegenCacheDir[]     = "differentiator/";        // in $XDG_CACHE_HOME
+const char kCodegenHomeCacheDir[] = ".cache/differentiator/"; // in $HOME without XDG_CACHE_HOME
+const char kCodegenCompiler[]     = "cc";
+
+const size_t kCodegenPathLen      = kFileNameLen * 4;
+
+typedef double (*codegenFunc_t) (const double *variables, double x);
+
+struct codegen_t
+{
+    void *handle            = NULL;     // of dlopen()
+
+    // [0] - expression, [1..diffTreesCnt] - derivatives, last - taylor,
+    // NULL for tree without root
+    codegenFunc_t *funcs    = NULL;
+    size_t funcsCnt         = 0;
+
+    // values of diff->variables at CodegenCtor(), x replaces variables[varIdx]
+    double *variables       = NULL;
+    size_t variablesCnt     = 0;
+
+    bool fromCache          = false;    // compiler wasn't run
+};
+
+int  CodegenCtor            (codegen_t *codegen, differentiator_t *diff, size_t varIdx);
+void CodegenDtor            (codegen_t *codegen);
+
+// function of one of the trees of diff, NULL if tree is not compiled
+codegenFunc_t CodegenFind   (const codegen_t *codegen, const differentiator_t *diff,
+                             const tree_t *tree);
+
+// tree of diff as function of one variable: compiled code if there is one,
+// NodeCalculateAt() otherwise. Doesn't change diff, can be used from many threads
+struct evaluator_t
+{
+    differentiator_t *diff      = NULL;
+    node_t *root                = NULL;
+    size_t varIdx               = 0;
+
+    codegenFunc_t compiled      = NULL;
+    const double *variables     = NULL; // of compiled
+};
+
+// codegen can be NULL, it must be built for the same varIdx
+void EvaluatorCtor          (evaluator_t *evaluator, differentiator_t *diff,
+                             const codegen_t *codegen, const tree_t *tree, size_t varIdx);
+double EvaluatorCalculate   (const evaluator_t *evaluator, double x);
+void EvaluatorCalculateMany (const evaluator_t *evaluator, const double *x, double *y, size_t cnt);
+
+#endif // K_TREE_CODEGEN_H
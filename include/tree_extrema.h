@@ -0,0 +1,46 @@
+#ifndef K_TREE_EXTREMA_H
+#define K_TREE_EXTREMA_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+struct codegen_t;
+
+// Extrema and inflection points of expression by diff->varToDiff on [left, right].
+// They are roots of f' and f'' found by RootsFind() (grid of sign changes,
+// bracketed Halley with the next derivatives): f' from negative to positive
+// is minimum, from positive to negative - maximum, every sign change of f''
+// is inflection. Minima and maxima need diffTrees[0], inflections - diffTrees[1],
+// with more derivatives taken refinement converges faster.
+// f' touching zero (x^3 in 0) is not an extremum and is skipped.
+
+enum extremumType_t
+{
+    EXTREMUM_MIN,
+    EXTREMUM_MAX,
+    EXTREMUM_INFLECTION,
+};
+
+struct extremum_t
+{
+    double x            = 0;
+    double y            = 0;    // f (x)
+    extremumType_t type = EXTREMUM_MIN;
+};
+
+struct extrema_t
+{
+    extremum_t *points  = NULL; // ascending x
+    size_t pointsCnt    = 0;
+};
+
+// codegen can be NULL, then trees are evaluated
+int  ExtremaFind            (extrema_t *extrema, differentiator_t *diff, const codegen_t *codegen,
+                             double left, double right);
+void ExtremaDtor            (extrema_t *extrema);
+
+const char *ExtremumTypeName (extremumType_t type);
+
+#endif // K_TREE_EXTREMA_H
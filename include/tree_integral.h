@@ -0,0 +1,41 @@
+#ifndef K_TREE_INTEGRAL_H
+#define K_TREE_INTEGRAL_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+struct codegen_t;
+
+// Definite integral of expression by diff->varToDiff on [left, right],
+// adaptive Gauss-Kronrod 7-15. Every interval gets 15 Kronrod nodes, 7 of them
+// are Gauss nodes, difference of two rules estimates the error (as in QUADPACK qk15).
+// Range starts from kIntegralStartIntervals equal parts, every round all new
+// intervals are evaluated in parallel, nodes of a chunk of intervals are
+// computed by one EvaluatorCalculateMany(). Then every interval with error
+// bigger than its share of tolerance (by width) is halved, until total error
+// is below tolerance * (integral of |f|) or there are kIntegralMaxIntervals intervals.
+
+const size_t kIntegralStartIntervals    = 8;
+const size_t kIntegralMaxIntervals      = 4096;
+const size_t kIntegralMinChunkSize      = 4;    // intervals of one task
+const size_t kIntegralChunksPerWorker   = 4;
+const double kIntegralTolerance         = 1e-10; // relative, of batch mode
+
+struct integral_t
+{
+    double value            = 0;
+    double error            = 0;    // estimate of absolute error
+    size_t intervalsCnt     = 0;
+    bool converged          = false; // error is below tolerance
+};
+
+// codegen can be NULL, then trees are evaluated,
+// TREE_ERROR_SINGULAR if expression is not finite in some node.
+// Nodes are inside intervals, pole at left or right is never sampled,
+// such integral ends with converged = false if it diverges
+int IntegralCompute (integral_t *integral, differentiator_t *diff, const codegen_t *codegen,
+                     double left, double right, double tolerance);
+
+#endif // K_TREE_INTEGRAL_H
@@ -0,0 +1,34 @@
+#ifndef K_TREE_INTERVAL_H
+#define K_TREE_INTERVAL_H
+
+#include <stdio.h>
+#include <math.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+// Interval arithmetic over trees: one pass gives [lo, hi] that contains
+// every finite value of the tree for variable anywhere in the range.
+// Bounds are rounded outwards (libm functions are widened by a few ulps),
+// so enclosure stays correct, but may be wider than real range:
+// every occurrence of variable is treated as independent.
+// Semantics are the same as in NodeCalculateDoMath(), e.g. arcctg(x) = 1 / arctg(x).
+
+struct interval_t
+{
+    double lo       = -INFINITY;
+    double hi       = INFINITY;
+    // somewhere in the range value is not finite: out of domain (ln(-1)) or pole (1/0)
+    bool undefined  = false;
+};
+
+interval_t IntervalPoint        (double x);
+interval_t IntervalMake         (double lo, double hi);
+// nowhere finite, e.g. ln([-2, -1])
+bool IntervalIsEmpty            (interval_t x);
+
+// variable varIdx is in range, others are points with their values
+interval_t NodeCalculateInterval(differentiator_t *diff, node_t *node,
+                                 size_t varIdx, interval_t range);
+
+#endif // K_TREE_INTERVAL_H
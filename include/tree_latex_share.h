@@ -0,0 +1,69 @@
+#ifndef K_TREE_LATEX_SHARE_H
+#define K_TREE_LATEX_SHARE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+struct node_t;
+
+// Repeated subexpressions of one tree for latex.
+// Every subtree is interned by structural hash: two nodes are the same
+// subexpression when type, value and interned children are equal,
+// so check is O(1) and the whole pass is linear.
+// Subexpressions met at least twice and not too small are printed
+// as names (\mathcal{A}, ...) with definitions after the formula.
+
+const size_t kLatexShareMinSize = 5; // nodes, smaller ones are cheaper to repeat
+
+struct latexShareEntry_t
+{
+    node_t *node        = NULL; // first occurrence
+    uint64_t hash       = 0;
+    size_t left         = 0;    // entries of children + 1, 0 - no child
+    size_t right        = 0;
+    size_t size         = 0;    // nodes in subtree
+    size_t count        = 0;    // occurrences in latex, see LatexShareCountUses()
+    size_t name         = 0;    // 0 - not named yet, else number of name from 1
+};
+
+struct latexShareNode_t
+{
+    const node_t *node  = NULL;
+    size_t entry        = 0;
+};
+
+struct latexShare_t
+{
+    latexShareNode_t *nodes     = NULL; // open addressing by pointer
+    size_t nodesCapacity        = 0;
+
+    latexShareEntry_t *entries  = NULL;
+    size_t entriesCnt           = 0;
+    size_t *entriesTable        = NULL; // open addressing by hash, entry + 1
+    size_t entriesCapacity      = 0;
+
+    size_t *pending             = NULL; // named entries without definition yet
+    size_t pendingCnt           = 0;
+    size_t namesCnt             = 0;
+
+    const node_t *defining      = NULL; // definition is printed in full, not as its name
+
+    // summary of tree
+    size_t nodesCnt             = 0;
+    size_t depth                = 0;
+    size_t numbersCnt           = 0;
+    size_t variablesCnt         = 0;
+    size_t operationsCnt        = 0;
+};
+
+int  LatexShareCtor     (latexShare_t *share, node_t *root);
+void LatexShareDtor     (latexShare_t *share);
+
+// name of subexpression if node has to be printed by name, NULL otherwise,
+// first lookup of name puts its definition into pending
+const latexShareEntry_t *LatexShareFind (latexShare_t *share, const node_t *node);
+bool LatexShareIsNamed  (const latexShareEntry_t *entry);
+// "\mathcal{A}", "\mathcal{A}_{2}" for names after the alphabet
+void LatexShareNameText (const latexShareEntry_t *entry, char *buffer, size_t bufferLen);
+
+#endif // K_TREE_LATEX_SHARE_H
@@ -4,7 +4,9 @@
 #include "tree.h"
 #include "tree_calc.h"
 
-int TreeLoadInfixFromFile (differentiator_t *diff, tree_t *tree,
-                           const char *fileName, char **buffer, size_t *bufferLen);
+int TreeLoadInfixFromFile   (differentiator_t *diff, tree_t *tree,
+                             const char *fileName, char **buffer, size_t *bufferLen);
+int TreeLoadInfixFromString (differentiator_t *diff, tree_t *tree,
+                             const char *str, char **buffer);
 
 #endif // K_TREE_LOAD_INFIX
\ No newline at end of file
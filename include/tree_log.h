@@ -1,10 +1,20 @@
 #ifndef K_TREE_LOG_H
 #define K_TREE_LOG_H
 
+#include <stdio.h>
+#include <stdint.h>
+
+#include "process_manager.h"
+#include "text_buffer.h"
+
 struct node_t;
 struct tree_t;
 struct variable_t;
 struct differentiator_t;
+struct plotSet_t;
+struct latexShare_t;
+struct pade_t;
+struct extrema_t;
 
 const char kLatexHeader[] = "\\documentclass{article}\n"
                             "\\usepackage[utf8x]{inputenc}\n"
@@ -37,6 +47,33 @@ const size_t kFileNameLen            = 64;
 const size_t kDateTimeLen            = 19;
 const size_t kLogFolderPathLen       = kFileNameLen - (sizeof(kParentDumpFolderName) - 1) - kDateTimeLen;
 
+// graph dumps (TREE_DUMP, NODE_DUMP) sampling, can be set with -D at build time
+#ifndef TREE_DUMP_EVERY
+#define TREE_DUMP_EVERY 1
+#endif
+#ifndef TREE_DUMP_TREES_ONLY
+#define TREE_DUMP_TREES_ONLY 0
+#endif
+
+const size_t kDumpEvery              = TREE_DUMP_EVERY;      // only every N-th dump is kept
+const bool   kDumpTreesOnly          = TREE_DUMP_TREES_ONLY; // NODE_DUMP-s are skipped
+
+// bigger trees are not typeset, only their summary is
+const size_t kLatexNodeLimit         = 2000;
+// steps of one derivative in latex, the rest are only counted
+const size_t kLatexStepsLimit        = 200;
+
+// how plot data gets to gnuplot
+enum plotDataFormat_t
+{
+    PLOT_DATA_TEXT      = 0, // plot/[name].txt, script is kept in plot/script.txt
+    PLOT_DATA_BINARY    = 1, // plot/[name].bin of float64 pairs and plot/script.txt
+    PLOT_DATA_PIPE      = 2, // binary data goes to gnuplot's stdin with script, no files
+};
+
+// "text", "binary" or "pipe", PLOT_DATA_PIPE if not set
+const char kPlotDataEnvName[] = "DIFFERENTIATOR_PLOT_DATA";
+
 struct treeLog_t
 {
     char logFolderPath      [kLogFolderPathLen] = {}; // dump/[date-time]
@@ -47,11 +84,42 @@ struct treeLog_t
     char htmlFilePath       [kFileNameLen]      = {}; // dump/[date-time]/log.html
     char latexFilePath      [kFileNameLen]      = {}; // dump/[date-time]/solve.tex
 
-    FILE *htmlFile  = NULL;
-    FILE *latexFile = NULL;
+    // NULL when context is created without log (library mode),
+    // all dump functions do nothing in this case
+    FILE *htmlFile      = NULL;
+    textBuffer_t *latex = NULL; // whole solve.tex, written in LogDtor()
+
+    plotDataFormat_t plotDataFormat = PLOT_DATA_PIPE;
+    double plotChebyshevTolerance   = 0;    // > 0 - curves are sampled from their chebyshev approximations
+    bool plotCompiled               = false; // curves are sampled by compiled trees, see tree_codegen.h
+    doubleFormat_t numberFormat     = {};   // numbers in latex, dot labels and text plot data
+
+    size_t latexNodeLimit           = kLatexNodeLimit;  // 0 - no limit
+    bool latexShare                 = true; // repeated subexpressions as names
+    latexShare_t *latexNames        = NULL; // of tree being printed
+    size_t latexNodesLeft           = SIZE_MAX; // printing stops at 0
+    bool latexNodesOver             = false; // some node didn't fit into latexNodesLeft
+    size_t latexStepsCnt            = 0;    // of current derivative
+    size_t latexStepsSkipped        = 0;
+
+    process_t gnuplot               = {}; // session for all plots
+    processManager_t processes      = {}; // dot and pdflatex
+
+    // dumps are only recorded, dot/[n].dot files are written and rendered in LogDtor()
+    textBuffer_t dotSources         = {};
+    size_t *dotBegins               = NULL; // offset of every graph in dotSources
+    size_t dotBeginsCapacity        = 0;
+    size_t dumpCalls                = 0;
+    size_t dumpEvery                = kDumpEvery;
+    bool dumpTreesOnly              = kDumpTreesOnly;
+
+    size_t imageCounter   = 0;
+    unsigned int randSeed = 0;
 };
 
 int LogCtor                     (treeLog_t *log);
+// dump/[date-time][suffix]/, for several logs created in the same second
+int LogCtorWithSuffix           (treeLog_t *log, const char *suffix);
 void LogDtor                    (treeLog_t *log);
 
 int TreeDump                    (differentiator_t *diff, tree_t *tree, 
@@ -70,9 +138,12 @@ int DumpLatexDifferentation     (differentiator_t *diff, node_t *expression,
 int DumpLatexFunction           (differentiator_t *diff, node_t *node);
 int DumpLatexAnswer             (differentiator_t *diff, node_t *node, size_t devirativeCount);
 int DumpLatexTaylor             (differentiator_t *diff);
+int DumpLatexPade               (differentiator_t *diff, const pade_t *pade);
+int DumpLatexExtrema            (differentiator_t *diff, const extrema_t *extrema);
 int DumpLatexNode               (differentiator_t *diff, node_t *node, node_t *parent);
 int DumpLatexNodeMathOperation  (differentiator_t *diff, node_t *node, node_t *parent);
 
 int DumpLatexAddImages          (differentiator_t *diff);
+int DumpLatexAddPlots           (differentiator_t *diff, plotSet_t *plots);
 
 #endif // K_TREE_LOG_H
\ No newline at end of file
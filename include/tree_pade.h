@@ -0,0 +1,37 @@
+#ifndef K_TREE_PADE_H
+#define K_TREE_PADE_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+// Pade approximant [L/M] from taylor coefficients c[0..L+M]:
+// P(t) / Q(t), t = x - center, deg P = L, deg Q = M, Q(0) = 1,
+// P - Q * taylor = O(t^(L+M+1)).
+// Q comes from Toeplitz system sum q[j] * c[L+i-j] = -c[L+i], i = 1..M,
+// P from convolution of Q with c. Usually much more precise than
+// taylor polynomial of the same L+M far from center, but has poles in roots of Q.
+
+struct pade_t
+{
+    double *num         = NULL; // L + 1 coefficients of P, lowest first
+    size_t numCnt       = 0;
+    double *den         = NULL; // M + 1 coefficients of Q, den[0] = 1
+    size_t denCnt       = 0;
+    double center       = 0;
+};
+
+// coefsCnt >= numDegree + denDegree + 1,
+// TREE_ERROR_SINGULAR if there is no approximant of this shape
+int  PadeCtor       (pade_t *pade, const double *coefs, size_t coefsCnt, double center,
+                     size_t numDegree, size_t denDegree);
+void PadeDtor       (pade_t *pade);
+
+// two Horner schemes and one division
+double PadeEvaluate (const pade_t *pade, double x);
+
+// P / Q with both polynomials in Horner form, nodes are from tree
+node_t *PadeBuildTree (const pade_t *pade, tree_t *tree, size_t varIdx);
+
+#endif // K_TREE_PADE_H
@@ -0,0 +1,29 @@
+#ifndef K_TREE_PARTIAL_H
+#define K_TREE_PARTIAL_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "thread_pool.h"
+
+// Symbolic gradient (and Hessian) of expression by all variables.
+// Every partial derivative is computed by separate task on thread pool
+// into its own tree, source tree is shared between tasks and is only read.
+
+struct partials_t
+{
+    size_t variablesCnt = 0;
+
+    tree_t *gradient    = NULL; // variablesCnt trees
+    tree_t *hessian     = NULL; // variablesCnt^2, only i <= j are filled, NULL if not requested
+};
+
+int TreesPartialDiff    (differentiator_t *diff, tree_t *expression,
+                         threadPool_t *pool, size_t workerIdx,
+                         bool withHessian, partials_t *partials);
+void PartialsDtor       (partials_t *partials);
+
+tree_t *PartialsHessian (partials_t *partials, size_t i, size_t j);
+
+#endif // K_TREE_PARTIAL_H
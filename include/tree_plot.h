@@ -9,23 +9,33 @@ const char kTaylorFileName[] = "taylor";
 
 const int kLeftRange    = -25;
 const int kRightRange   = 25;
-const double kStep      = 0.0001;
 
+// Adaptive sampling: x-range is split into pixel columns (same width as png in scripts).
+// Every column starts with kPlotColumnSamples uniform intervals, interval is halved
+// while its midpoint is far from the chord (curvature) or values jump (poles,
+// end of domain), but not deeper than kPlotMaxDepth (~ old fixed step 0.0001)
+// and not more than kPlotPointsPerPixel points per column.
+// Only first, min, max and last points of column (and break, if any) are kept.
+const size_t kPlotWidth             = 1600;
+const size_t kPlotColumnSamples     = 4;
+const size_t kPlotMaxDepth          = 6;
+const size_t kPlotPointsPerPixel    = 64;
+const size_t kPlotColumnPointsMax   = 5;
+const double kPlotTolerance         = 1e-3;
 
-const char kPlotOneFuncScript[] = "set terminal png size 1600,800\n"
-                                  "set xrange[%d:%d]\n"
-                                  "set output \"%s\"\n"
-                                 //  "set title \"%lu-ая производная\"\n"
-                               //    "plot x**2, cos(x), sin(x) * x"
-                                  "plot \"%s\" with lines";
+const size_t kPlotMinChunkSize      = 32;   // columns
+const size_t kPlotChunksPerWorker   = 4;
 
-const char kPlotTwoFuncScript[] = // "gnuplot -e \""
-                                 "set terminal png size 1600,800\n"
+
+const char kPlotScriptHeader[] = "set terminal png size 1600,800\n"
                                  "set xrange[%d:%d]\n"
                                  "set output \"%s\"\n"
-                                 // "set title \"%lu-ая производная\"\n"
-                              //    "plot x**2, cos(x), sin(x) * x"
-                                 "plot \"%s\" with lines, \"%s\" with lines";
+                                 "plot ";
+
+// one for every curve in "plot" command, separated by ", "
+const char kPlotTextCurve[]    = "\"%s\" with lines";
+const char kPlotBinaryCurve[]  = "\"%s\" binary format=\"%%float64%%float64\" with lines";
+const char kPlotPipeCurve[]    = "\"-\" binary record=%lu format=\"%%float64%%float64\" with lines";
 
 /*
 gnuplot -e \"
@@ -41,7 +51,30 @@ set output "dump/2025-12-02_04:54:18/plot/1.png"
 plot "dump/2025-12-02_04:54:18/plot/1.txt" with lines
 */
 
-// int TreeCreatePlotImages   (differentiator_t *diff);
+// Data of all curves is generated in parallel: every curve is split into chunks
+// of x-range, chunks of all curves are tasks on diff->pool (or temporary pool),
+// every task writes into its part of preallocated array
+
+struct plotCurve_t;
+
+// data of all plots of differentiator: expression, taylor, derivatives
+struct plotSet_t
+{
+    plotCurve_t *curves = NULL;
+    size_t curvesCnt    = 0;
+    char *numbers       = NULL; // names of derivative plots
+
+    // of all curves, for benchmarks
+    size_t pointsCnt        = 0;    // kept for gnuplot
+    size_t evaluationsCnt   = 0;    // calls of NodeCalculateAt()
+};
+
+// TreeCreatePlotImages() = TreeGeneratePlots() + TreeRenderPlots(),
+// they are separate so rendering can be done later by another thread
+int TreeCreatePlotImages      (differentiator_t *diff);
+int TreeGeneratePlots         (differentiator_t *diff, plotSet_t *plots);
+int TreeRenderPlots           (differentiator_t *diff, plotSet_t *plots);
+void PlotSetDtor              (plotSet_t *plots);
 
 int TreeCreatePlotImage       (differentiator_t *diff, tree_t *tree, const char *fileName);
 int TreePlotFunctionAndTaylor (differentiator_t *diff, const char *fileName);
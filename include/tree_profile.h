@@ -0,0 +1,86 @@
+#ifndef K_TREE_PROFILE_H
+#define K_TREE_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Timers of stages and counters of work, enabled by environment variables
+// DIFFERENTIATOR_PROFILE=<file> ("-" - stderr) - summary in JSON,
+// DIFFERENTIATOR_TRACE=<file> - every timed stage as a span in Chrome trace-event
+// format (chrome://tracing, Perfetto). Both are written at exit, see ProfileInit().
+// Every thread adds into its own slot without locks: counters are summed at exit,
+// spans are appended to buffer of the slot.
+// Disabled probe is a load of profileEnabled and a not taken branch.
+
+const char kProfileEnvName[] = "DIFFERENTIATOR_PROFILE";
+const char kTraceEnvName[]   = "DIFFERENTIATOR_TRACE";
+
+const size_t kTraceStartCapacity = 1024; // spans of one thread
+
+enum profileStage_t
+{
+    PROFILE_STAGE_PARSE,
+    PROFILE_STAGE_DIFF,
+    PROFILE_STAGE_SIMPLIFY,
+    PROFILE_STAGE_TAYLOR,
+    PROFILE_STAGE_CODEGEN,           // generating, compiling and loading code of trees
+    PROFILE_STAGE_ROOTS,
+    PROFILE_STAGE_INTEGRAL,
+    PROFILE_STAGE_PLOT_DATA,
+    PROFILE_STAGE_PLOT_CHUNK,        // part of plot data on pool thread
+    PROFILE_STAGE_GNUPLOT,
+    PROFILE_STAGE_LATEX_WRITE,
+    PROFILE_STAGE_DOT,
+    PROFILE_STAGE_WAIT_GNUPLOT,
+    PROFILE_STAGE_PDFLATEX,          // running pdflatex and waiting for it and dot
+    PROFILE_STAGE_BATCH_JOB,
+    PROFILE_STAGE_REPORT_QUEUE_WAIT, // computing thread blocked by full queue of reports
+    PROFILE_STAGE_REPORT_RENDER,
+
+    PROFILE_STAGES_CNT
+};
+
+enum profileCounter_t
+{
+    PROFILE_NODES_CREATED,
+    PROFILE_NODES_FREED,
+    PROFILE_SIMPLIFY_ROUNDS,
+    PROFILE_EVALUATIONS,             // of whole trees
+    PROFILE_BYTES_WRITTEN,           // latex, dot, plot data and batch output
+
+    PROFILE_COUNTERS_CNT
+};
+
+extern bool profileEnabled;
+
+#define PROFILE_START()                                                 \
+        (__builtin_expect (profileEnabled, 0) ? ProfileNow () : 0)
+
+#define PROFILE_STOP(stage, start)                                      \
+        do {                                                            \
+            if (__builtin_expect (profileEnabled, 0))                   \
+                ProfileAddTime (stage, start, 0);                       \
+        } while (0)
+
+// number is shown in the trace span, e.g. order of derivative, from 1
+#define PROFILE_STOP_N(stage, start, number)                            \
+        do {                                                            \
+            if (__builtin_expect (profileEnabled, 0))                   \
+                ProfileAddTime (stage, start, number);                  \
+        } while (0)
+
+#define PROFILE_COUNT(counter, value)                                   \
+        do {                                                            \
+            if (__builtin_expect (profileEnabled, 0))                   \
+                ProfileAddCount (counter, value);                       \
+        } while (0)
+
+// call at start of main(), before any thread is created
+void ProfileInit        ();
+
+uint64_t ProfileNow     ();
+// number = 0 - span without number
+void ProfileAddTime     (profileStage_t stage, uint64_t start, size_t number);
+void ProfileAddCount    (profileCounter_t counter, uint64_t value);
+
+#endif // K_TREE_PROFILE_H
@@ -0,0 +1,55 @@
+#ifndef K_TREE_REPORT_H
+#define K_TREE_REPORT_H
+
+#include <pthread.h>
+
+#include "tree_calc.h"
+#include "tree_plot.h"
+#include "node_arena.h"
+
+// Asynchronous reports: computing thread fills report (trees, taylor, derivative
+// steps in latex, plot arrays) and pushes it into bounded queue. Renderer threads
+// run gnuplot, finish latex, wait for dot and pdflatex and free the report,
+// while computing thread already works on the next expression.
+// Full queue blocks pushing thread, so reports can't eat all memory.
+
+const size_t kReportQueueCapacity   = 4;
+const size_t kReportRenderersCnt    = 2;
+
+struct report_t
+{
+    nodeArena_t arena       = {}; // all trees of diff, freed by renderer
+    differentiator_t diff   = {};
+    plotSet_t plots         = {};
+};
+
+struct reportQueue_t
+{
+    report_t **reports  = NULL; // ring buffer
+    size_t capacity     = 0;
+    size_t head         = 0;
+    size_t size         = 0;
+    bool closed         = false;
+
+    pthread_mutex_t lock    = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t notEmpty = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t notFull  = PTHREAD_COND_INITIALIZER;
+
+    pthread_t *renderers    = NULL;
+    size_t renderersCnt     = 0;
+
+    int status              = 0; // errors of all rendered reports
+};
+
+// calloc()-ed report with log in dump/[date-time]_[seq]/ and empty differentiator
+int  ReportCreate       (report_t **report, size_t seq, size_t variablesCapacity);
+// for reports which were not pushed
+void ReportDestroy      (report_t *report);
+
+int  ReportQueueCtor    (reportQueue_t *queue, size_t capacity, size_t renderersCnt);
+// queue owns report after push, blocks while queue is full
+void ReportQueuePush    (reportQueue_t *queue, report_t *report);
+// waits for all pushed reports, returns errors of rendering
+int  ReportQueueDtor    (reportQueue_t *queue);
+
+#endif // K_TREE_REPORT_H
@@ -0,0 +1,48 @@
+#ifndef K_TREE_ROOTS_H
+#define K_TREE_ROOTS_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+struct codegen_t;
+
+// Roots of expression (or its derivative) by diff->varToDiff on [left, right].
+// Range is split into kRootsGridSize cells, f is evaluated in their ends
+// (in parallel), every cell with sign change is a bracket. Every bracket
+// is polished in parallel by Halley iterations with f' and f'' from
+// diff->diffTrees (Newton with one derivative, bisection without them),
+// a step out of the bracket is replaced by bisection, so iterations always converge.
+// Sign change where |f| grows while bracket shrinks is a pole, not a root.
+// Roots of even multiplicity (f touches zero) have no sign change and are not found.
+
+const size_t kRootsGridSize         = 1024;
+const size_t kRootsMaxIterations    = 100;
+const size_t kRootsMinChunkSize     = 64;   // grid points or brackets of one task
+const size_t kRootsChunksPerWorker  = 4;
+
+struct root_t
+{
+    double x            = 0;
+    double value        = 0;    // f (x)
+    size_t iterations   = 0;
+    // +1 - f goes from negative to positive, -1 - back,
+    // 0 - f is zero in grid point and doesn't change sign there
+    int direction       = 0;
+};
+
+struct roots_t
+{
+    root_t *roots       = NULL; // ascending x
+    size_t rootsCnt     = 0;
+    size_t capacity     = 0;
+};
+
+// order = 0 - roots of expression, order = k - of k-th derivative,
+// codegen can be NULL, then trees are evaluated
+int  RootsFind  (roots_t *roots, differentiator_t *diff, const codegen_t *codegen,
+                 size_t order, double left, double right);
+void RootsDtor  (roots_t *roots);
+
+#endif // K_TREE_ROOTS_H
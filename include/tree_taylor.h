@@ -0,0 +1,38 @@
+#ifndef K_TREE_TAYLOR_H
+#define K_TREE_TAYLOR_H
+
+#include <stdio.h>
+
+#include "tree.h"
+#include "tree_calc.h"
+
+const size_t kTaylorMinChunkSize    = 16; // centers, smaller inputs are computed in place
+const size_t kTaylorChunksPerWorker = 4;
+
+// Taylor polynomial as plain coefficients:
+// coefs[0] + coefs[1] * (x - center) + ... + coefs[n - 1] * (x - center)^(n - 1),
+// coefs[k] = f^(k) (center) / k!, f^(k) are expression and diff->diffTrees
+
+// coefsCnt <= diff->diffTreesCnt + 1, other variables are taken with their values
+void TaylorCalculateCoefs   (differentiator_t *diff, size_t varIdx, double center,
+                             double *coefs, size_t coefsCnt);
+
+// coefsCnt coefficients for every center, centers[i] has coefs + i * coefsCnt.
+// Centers are split into chunks for diff->pool (or temporary pool),
+// derivative trees are shared by all threads and only read
+int TaylorCalculateCenters  (differentiator_t *diff, size_t varIdx,
+                             const double *centers, size_t centersCnt,
+                             double *coefs, size_t coefsCnt);
+
+// Horner scheme, coefsCnt - 1 fused multiply-adds
+double TaylorEvaluate       (const double *coefs, size_t coefsCnt, double center, double x);
+
+// polynomial in Horner form, nodes are from tree
+node_t *TaylorBuildTree     (tree_t *tree, const double *coefs, size_t coefsCnt,
+                             size_t varIdx, double center);
+
+// fills diff->taylorCoefs and diff->taylorDerivatives for diff->varToDiff
+// and builds diff->taylor in Horner form
+int TaylorBuild             (differentiator_t *diff);
+
+#endif // K_TREE_TAYLOR_H
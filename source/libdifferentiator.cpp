@@ -0,0 +1,579 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "libdifferentiator.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_load_infix.h"
+#include "tree_interval.h"
+#include "tree_taylor.h"
+#include "tree_pade.h"
+#include "tree_chebyshev.h"
+#include "tree_codegen.h"
+#include "tree_roots.h"
+#include "tree_extrema.h"
+#include "tree_integral.h"
+
+const size_t kContextVariablesCapacity = 4;
+
+// C callers see statuses only through diffStatus_t
+static_assert ((int) DIFF_ERROR_NULL_ROOT      == (int) TREE_ERROR_NULL_ROOT,           "");
+static_assert ((int) DIFF_ERROR_SYNTAX         == (int) TREE_ERROR_SYNTAX_IN_SAVE_FILE, "");
+static_assert ((int) DIFF_ERROR_WRONG_ARGUMENT == (int) TREE_ERROR_WRONG_ARGUMENT,      "");
+static_assert ((int) DIFF_ERROR_NODE_NOT_FOUND == (int) TREE_ERROR_NODE_NOT_FOUND,      "");
+static_assert ((int) DIFF_ERROR_SINGULAR       == (int) TREE_ERROR_SINGULAR,            "");
+static_assert ((int) DIFF_ERROR_NOT_CONVERGED  == (int) TREE_ERROR_NOT_CONVERGED,       "");
+static_assert ((int) DIFF_ERROR_COMMON         == (int) TREE_ERROR_COMMON,              "");
+
+struct diffContext_t
+{
+    differentiator_t diff;
+};
+
+struct diffChebyshev_t
+{
+    chebyshev_t cheb;
+};
+
+struct diffCompiled_t
+{
+    codegen_t codegen;
+};
+
+static void DiffContextClearDerivatives (differentiator_t *diff);
+
+diffContext_t *DiffContextCreate (void)
+{
+    diffContext_t *ctx = (diffContext_t *) calloc (1, sizeof (diffContext_t));
+    if (ctx == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for context - %s", strerror (errno));
+
+        return NULL;
+    }
+
+    // calloc() doesn't run default member initializers
+    ctx->diff = {};
+
+    int status = DifferentiatorCtorEmpty (&ctx->diff, kContextVariablesCapacity);
+    if (status != TREE_OK)
+    {
+        DiffContextFree (ctx);
+
+        return NULL;
+    }
+
+    return ctx;
+}
+
+void DiffContextFree (diffContext_t *ctx)
+{
+    if (ctx == NULL)
+        return;
+
+    DifferentiatorDtor (&ctx->diff);
+
+    free (ctx);
+}
+
+int DiffContextParse (diffContext_t *ctx, const char *expression)
+{
+    assert (ctx);
+    assert (expression);
+
+    differentiator_t *diff = &ctx->diff;
+
+    if (diff->expression.root != NULL || diff->buffer != NULL)
+    {
+        DifferentiatorDtor (diff);
+
+        TREE_DO_AND_RETURN (DifferentiatorCtorEmpty (diff, kContextVariablesCapacity));
+    }
+
+    return TreeLoadInfixFromString (diff, &diff->expression, expression, &diff->buffer);
+}
+
+int DiffContextDifferentiate (diffContext_t *ctx, const char *varName, size_t times)
+{
+    assert (ctx);
+    assert (varName);
+
+    differentiator_t *diff = &ctx->diff;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+    if (var == NULL)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    DiffContextClearDerivatives (diff);
+
+    return TreesDiffByVariable (diff, &diff->expression, var, times);
+}
+
+int DiffContextSimplify (diffContext_t *ctx)
+{
+    assert (ctx);
+
+    differentiator_t *diff = &ctx->diff;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    TreeSimplify (diff, &diff->expression);
+
+    return TREE_OK;
+}
+
+int DiffContextSetVariable (diffContext_t *ctx, const char *varName, double value)
+{
+    assert (ctx);
+    assert (varName);
+
+    variable_t *var = FindVariableByName (&ctx->diff, varName, strlen (varName));
+    if (var == NULL)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    var->value = value;
+
+    return TREE_OK;
+}
+
+int DiffContextEvaluate (diffContext_t *ctx, size_t order, double *result)
+{
+    assert (ctx);
+    assert (result);
+
+    differentiator_t *diff = &ctx->diff;
+
+    if (order > diff->diffTreesCnt)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    tree_t *tree = (order == 0) ? &diff->expression : &diff->diffTrees[order - 1];
+    if (tree->root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    *result = NodeCalculate (diff, tree->root);
+
+    return TREE_OK;
+}
+
+int DiffContextBound (diffContext_t *ctx, size_t order, const char *varName,
+                      double from, double to,
+                      double *min, double *max, int *undefined)
+{
+    assert (ctx);
+    assert (varName);
+    assert (min);
+    assert (max);
+    assert (undefined);
+
+    differentiator_t *diff = &ctx->diff;
+
+    if (order > diff->diffTreesCnt || !(from <= to))
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    tree_t *tree = (order == 0) ? &diff->expression : &diff->diffTrees[order - 1];
+    if (tree->root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+    if (var == NULL)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    interval_t bound = NodeCalculateInterval (diff, tree->root, (size_t) (var - diff->variables),
+                                              IntervalMake (from, to));
+
+    *min       = bound.lo;
+    *max       = bound.hi;
+    *undefined = bound.undefined;
+
+    return TREE_OK;
+}
+
+int DiffContextTaylor (diffContext_t *ctx, const char *varName, double center,
+                       double *coefs, size_t coefsCnt)
+{
+    return DiffContextTaylorCenters (ctx, varName, &center, 1, coefs, coefsCnt);
+}
+
+int DiffContextTaylorCenters (diffContext_t *ctx, const char *varName,
+                              const double *centers, size_t centersCnt,
+                              double *coefs, size_t coefsCnt)
+{
+    assert (ctx);
+    assert (varName);
+    assert (centers);
+    assert (coefs);
+
+    differentiator_t *diff = &ctx->diff;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    if (coefsCnt > diff->diffTreesCnt + 1)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+
+    // derivatives are taken by another variable
+    if (var == NULL || (coefsCnt > 1 && var != diff->varToDiff))
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    return TaylorCalculateCenters (diff, (size_t) (var - diff->variables),
+                                   centers, centersCnt, coefs, coefsCnt);
+}
+
+double DiffTaylorEvaluate (const double *coefs, size_t coefsCnt, double center, double x)
+{
+    assert (coefs);
+
+    return TaylorEvaluate (coefs, coefsCnt, center, x);
+}
+
+int DiffContextPade (diffContext_t *ctx, const char *varName, double center,
+                     size_t numDegree, size_t denDegree,
+                     double *num, double *den)
+{
+    assert (ctx);
+    assert (varName);
+    assert (num);
+    assert (den);
+
+    size_t coefsCnt = numDegree + denDegree + 1;
+
+    double *coefs = (double *) calloc (coefsCnt, sizeof (double));
+    if (coefs == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for taylor coefficients - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    int status = DiffContextTaylor (ctx, varName, center, coefs, coefsCnt);
+
+    pade_t pade = {};
+
+    if (status == TREE_OK)
+        status = PadeCtor (&pade, coefs, coefsCnt, center, numDegree, denDegree);
+
+    if (status == TREE_OK)
+    {
+        memcpy (num, pade.num, pade.numCnt * sizeof (double));
+        memcpy (den, pade.den, pade.denCnt * sizeof (double));
+    }
+
+    PadeDtor (&pade);
+    free (coefs);
+
+    return status;
+}
+
+double DiffPadeEvaluate (const double *num, size_t numDegree,
+                         const double *den, size_t denDegree,
+                         double center, double x)
+{
+    assert (num);
+    assert (den);
+
+    return TaylorEvaluate (num, numDegree + 1, center, x) /
+           TaylorEvaluate (den, denDegree + 1, center, x);
+}
+
+diffChebyshev_t *DiffContextApproximate (diffContext_t *ctx, size_t order, const char *varName,
+                                         double from, double to, double tolerance, int *status)
+{
+    assert (ctx);
+    assert (varName);
+    assert (status);
+
+    differentiator_t *diff = &ctx->diff;
+
+    *status = TREE_ERROR_WRONG_ARGUMENT;
+
+    if (order > diff->diffTreesCnt)
+        return NULL;
+
+    tree_t *tree = (order == 0) ? &diff->expression : &diff->diffTrees[order - 1];
+    if (tree->root == NULL)
+    {
+        *status = TREE_ERROR_NULL_ROOT;
+
+        return NULL;
+    }
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+    if (var == NULL)
+        return NULL;
+
+    diffChebyshev_t *approx = (diffChebyshev_t *) calloc (1, sizeof (diffChebyshev_t));
+    if (approx == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for approximation - %s", strerror (errno));
+
+        *status = TREE_ERROR_COMMON |
+                  COMMON_ERROR_ALLOCATING_MEMORY;
+
+        return NULL;
+    }
+
+    *status = ChebyshevCtor (&approx->cheb, diff, tree->root, (size_t) (var - diff->variables),
+                             from, to, tolerance);
+    if (*status != TREE_OK)
+    {
+        DiffChebyshevFree (approx);
+
+        return NULL;
+    }
+
+    return approx;
+}
+
+void DiffChebyshevFree (diffChebyshev_t *approx)
+{
+    if (approx == NULL)
+        return;
+
+    ChebyshevDtor (&approx->cheb);
+
+    free (approx);
+}
+
+double DiffChebyshevEvaluate (const diffChebyshev_t *approx, double x)
+{
+    assert (approx);
+
+    return ChebyshevEvaluate (&approx->cheb, x);
+}
+
+diffCompiled_t *DiffContextCompile (diffContext_t *ctx, const char *varName, int *status)
+{
+    assert (ctx);
+    assert (varName);
+    assert (status);
+
+    differentiator_t *diff = &ctx->diff;
+
+    if (diff->expression.root == NULL)
+    {
+        *status = TREE_ERROR_NULL_ROOT;
+
+        return NULL;
+    }
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+    if (var == NULL)
+    {
+        *status = TREE_ERROR_WRONG_ARGUMENT;
+
+        return NULL;
+    }
+
+    diffCompiled_t *compiled = (diffCompiled_t *) calloc (1, sizeof (diffCompiled_t));
+    if (compiled == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for compiled expression - %s", strerror (errno));
+
+        *status = TREE_ERROR_COMMON |
+                  COMMON_ERROR_ALLOCATING_MEMORY;
+
+        return NULL;
+    }
+
+    *status = CodegenCtor (&compiled->codegen, diff, (size_t) (var - diff->variables));
+    if (*status != TREE_OK)
+    {
+        DiffCompiledFree (compiled);
+
+        return NULL;
+    }
+
+    return compiled;
+}
+
+void DiffCompiledFree (diffCompiled_t *compiled)
+{
+    if (compiled == NULL)
+        return;
+
+    CodegenDtor (&compiled->codegen);
+
+    free (compiled);
+}
+
+double DiffCompiledEvaluate (const diffCompiled_t *compiled, size_t order, double x)
+{
+    assert (compiled);
+
+    const codegen_t *codegen = &compiled->codegen;
+
+    // the last function is taylor
+    if (order + 1 >= codegen->funcsCnt || codegen->funcs[order] == NULL)
+        return NAN;
+
+    return codegen->funcs[order] (codegen->variables, x);
+}
+
+int DiffContextRoots (diffContext_t *ctx, const char *varName,
+                      double from, double to,
+                      double *roots, size_t rootsCapacity, size_t *rootsCnt)
+{
+    assert (ctx);
+    assert (varName);
+    assert (roots || rootsCapacity == 0);
+    assert (rootsCnt);
+
+    differentiator_t *diff = &ctx->diff;
+
+    *rootsCnt = 0;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+
+    // derivatives are taken by another variable
+    if (var == NULL || (diff->varToDiff != NULL && var != diff->varToDiff))
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    // without derivatives roots are found by bisection
+    variable_t *varToDiff = diff->varToDiff;
+    diff->varToDiff = var;
+
+    roots_t found = {};
+
+    int status = RootsFind (&found, diff, NULL, 0, from, to);
+
+    diff->varToDiff = varToDiff;
+
+    if (status != TREE_OK)
+        return status;
+
+    for (size_t i = 0; i < found.rootsCnt && i < rootsCapacity; i++)
+    {
+        roots[i] = found.roots[i].x;
+    }
+
+    *rootsCnt = found.rootsCnt;
+
+    RootsDtor (&found);
+
+    return TREE_OK;
+}
+
+int DiffContextExtrema (diffContext_t *ctx, const char *varName,
+                        double from, double to,
+                        diffExtremum_t *points, size_t pointsCapacity, size_t *pointsCnt)
+{
+    assert (ctx);
+    assert (varName);
+    assert (points || pointsCapacity == 0);
+    assert (pointsCnt);
+
+    differentiator_t *diff = &ctx->diff;
+
+    *pointsCnt = 0;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+
+    // without derivatives by varName there is nothing to find
+    if (var == NULL || var != diff->varToDiff)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    extrema_t found = {};
+
+    TREE_DO_AND_RETURN (ExtremaFind (&found, diff, NULL, from, to));
+
+    for (size_t i = 0; i < found.pointsCnt && i < pointsCapacity; i++)
+    {
+        points[i].x    = found.points[i].x;
+        points[i].y    = found.points[i].y;
+        points[i].type = (found.points[i].type == EXTREMUM_MIN) ? DIFF_EXTREMUM_MIN :
+                         (found.points[i].type == EXTREMUM_MAX) ? DIFF_EXTREMUM_MAX :
+                                                                  DIFF_EXTREMUM_INFLECTION;
+    }
+
+    *pointsCnt = found.pointsCnt;
+
+    ExtremaDtor (&found);
+
+    return TREE_OK;
+}
+
+int DiffContextIntegrate (diffContext_t *ctx, const char *varName,
+                          double from, double to, double tolerance,
+                          double *value, double *error)
+{
+    assert (ctx);
+    assert (varName);
+    assert (value);
+    assert (error);
+
+    differentiator_t *diff = &ctx->diff;
+
+    *value = NAN;
+    *error = NAN;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    variable_t *var = FindVariableByName (diff, varName, strlen (varName));
+
+    if (var == NULL || (diff->varToDiff != NULL && var != diff->varToDiff))
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    variable_t *varToDiff = diff->varToDiff;
+    diff->varToDiff = var;
+
+    integral_t integral = {};
+
+    int status = IntegralCompute (&integral, diff, NULL, from, to, tolerance);
+
+    diff->varToDiff = varToDiff;
+
+    if (status != TREE_OK)
+        return status;
+
+    *value = integral.value;
+    *error = integral.error;
+
+    return integral.converged ? TREE_OK : TREE_ERROR_NOT_CONVERGED;
+}
+
+size_t DiffContextVariablesCount (const diffContext_t *ctx)
+{
+    assert (ctx);
+
+    return ctx->diff.variablesSize;
+}
+
+size_t DiffContextDerivativesCount (const diffContext_t *ctx)
+{
+    assert (ctx);
+
+    return ctx->diff.diffTreesCnt;
+}
+
+void DiffContextClearDerivatives (differentiator_t *diff)
+{
+    assert (diff);
+
+    for (size_t i = 0; i < diff->diffTreesCnt; i++)
+    {
+        TreeDtor (&diff->diffTrees[i]);
+    }
+
+    free (diff->diffTrees);
+    diff->diffTrees    = NULL;
+    diff->diffTreesCnt = 0;
+}
@@ -8,8 +8,37 @@
 #include "tree_calc.h"
 #include "tree_log.h"
 #include "tree_plot.h"
+#include "tree_batch.h"
+#include "tree_profile.h"
 
-int main()
+static int RunInteractive       ();
+static int ParseBatchOptions    (int argc, char *argv[], batchOptions_t *options);
+static void ParseDigits         (const char *value, doubleFormat_t *format);
+static int  ParsePade           (const char *value, batchOptions_t *options);
+static int  ParseRange          (const char *value, double *left, double *right);
+static void PrintUsage          (const char *programName);
+
+int main (int argc, char *argv[])
+{
+    ProfileInit ();
+
+    if (argc == 1)
+        return RunInteractive ();
+
+    batchOptions_t options = {};
+
+    int status = ParseBatchOptions (argc, argv, &options);
+    if (status != TREE_OK)
+    {
+        PrintUsage (argv[0]);
+
+        return status;
+    }
+
+    return TreeBatchRun (&options);
+}
+
+int RunInteractive ()
 {
     differentiator_t diff = {};
     TREE_DO_AND_CLEAR (DifferentiatorCtor (&diff, 4),
@@ -31,4 +60,168 @@ int main()
     }
 
     DifferentiatorDtor (&diff);
+
+    return TREE_OK;
+}
+
+int ParseBatchOptions (int argc, char *argv[], batchOptions_t *options)
+{
+    assert (argv);
+    assert (options);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *option = argv[i];
+        const char *value  = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        // flags without value
+        if (strcmp (option, "--gradient") == 0) { options->gradient = true; continue; }
+        if (strcmp (option, "--hessian")  == 0) { options->hessian  = true; continue; }
+        if (strcmp (option, "--report")   == 0) { options->report   = true; continue; }
+        if (strcmp (option, "--compile")  == 0) { options->compile  = true; continue; }
+        if (strcmp (option, "--extrema")  == 0) { options->extrema  = true; continue; }
+
+        if (value == NULL)
+        {
+            ERROR_PRINT ("Option \"%s\" requires value", option);
+
+            return TREE_ERROR_WRONG_ARGUMENT;
+        }
+
+        if      (strcmp (option, "--batch")       == 0) options->inputFileName  = value;
+        else if (strcmp (option, "--var")         == 0) options->varName        = value;
+        else if (strcmp (option, "--threads")     == 0) options->threadsCnt     = strtoul (value, NULL, 10);
+        else if (strcmp (option, "--order")       == 0) options->diffTimes      = strtoul (value, NULL, 10);
+        else if (strcmp (option, "--at")          == 0) options->point          = strtod  (value, NULL);
+        else if (strcmp (option, "--digits")      == 0) ParseDigits (value, &options->numberFormat);
+        else if (strcmp (option, "--latex-nodes") == 0) options->latexNodeLimit = strtoul (value, NULL, 10);
+        else if (strcmp (option, "--pade")        == 0) TREE_DO_AND_RETURN (ParsePade (value, options));
+        else if (strcmp (option, "--chebyshev")   == 0) options->chebyshevTolerance = strtod (value, NULL);
+        else if (strcmp (option, "--roots")       == 0)
+        {
+            TREE_DO_AND_RETURN (ParseRange (value, &options->rootsLeft, &options->rootsRight));
+            options->roots = true;
+        }
+        else if (strcmp (option, "--integral")    == 0)
+        {
+            TREE_DO_AND_RETURN (ParseRange (value, &options->integralLeft, &options->integralRight));
+            options->integral = true;
+        }
+        else
+        {
+            ERROR_PRINT ("Unknown option \"%s\"", option);
+
+            return TREE_ERROR_WRONG_ARGUMENT;
+        }
+
+        i++;
+    }
+
+    if (options->inputFileName == NULL)
+    {
+        ERROR_PRINT ("%s", "No input file, use --batch");
+
+        return TREE_ERROR_WRONG_ARGUMENT;
+    }
+
+    return TREE_OK;
+}
+
+// 0 - shortest round-trip digits
+void ParseDigits (const char *value, doubleFormat_t *format)
+{
+    assert (value);
+    assert (format);
+
+    unsigned long digits = strtoul (value, NULL, 10);
+
+    if (digits == 0)
+    {
+        format->mode = DOUBLE_FORMAT_SHORTEST;
+    }
+    else
+    {
+        format->mode      = DOUBLE_FORMAT_FIXED;
+        format->precision = (digits > kDoubleFormatMaxPrecision) ? kDoubleFormatMaxPrecision
+                                                                  : (int) digits;
+    }
+}
+
+// "<L>/<M>" - degrees of numerator and denominator
+int ParsePade (const char *value, batchOptions_t *options)
+{
+    assert (value);
+    assert (options);
+
+    char *end = NULL;
+
+    options->padeNumDegree = strtoul (value, &end, 10);
+
+    if (end == value || *end != '/')
+    {
+        ERROR_PRINT ("Wrong pade degrees \"%s\", expected <L>/<M>", value);
+
+        return TREE_ERROR_WRONG_ARGUMENT;
+    }
+
+    const char *den = end + 1;
+
+    options->padeDenDegree = strtoul (den, &end, 10);
+
+    if (end == den || *end != '\0')
+    {
+        ERROR_PRINT ("Wrong pade degrees \"%s\", expected <L>/<M>", value);
+
+        return TREE_ERROR_WRONG_ARGUMENT;
+    }
+
+    options->pade = true;
+
+    return TREE_OK;
+}
+
+// "<from>:<to>", from < to
+int ParseRange (const char *value, double *left, double *right)
+{
+    assert (value);
+    assert (left);
+    assert (right);
+
+    char *end = NULL;
+
+    *left = strtod (value, &end);
+
+    if (end == value || *end != ':')
+    {
+        ERROR_PRINT ("Wrong range \"%s\", expected <from>:<to>", value);
+
+        return TREE_ERROR_WRONG_ARGUMENT;
+    }
+
+    const char *rightText = end + 1;
+
+    *right = strtod (rightText, &end);
+
+    if (end == rightText || *end != '\0' || !(*left < *right))
+    {
+        ERROR_PRINT ("Wrong range \"%s\", expected <from>:<to>", value);
+
+        return TREE_ERROR_WRONG_ARGUMENT;
+    }
+
+    return TREE_OK;
+}
+
+void PrintUsage (const char *programName)
+{
+    assert (programName);
+
+    PRINT ("Usage:\n"
+           "\t%s                 - interactive mode, expression from %s\n"
+           "\t%s --batch <file> [--order <n>] [--var <name>] [--at <value>] [--threads <n>]\n"
+           "\t\t[--gradient] [--hessian] [--report] [--digits <n>] [--latex-nodes <n>] [--pade <L>/<M>]\n"
+           "\t\t[--chebyshev <tolerance>] [--compile] [--roots <from>:<to>] [--extrema]\n"
+           "\t\t[--integral <from>:<to>]\n",
+           programName, ktreeSaveFileName,
+           programName);
 }
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "node_arena.h"
+
+#include "tree.h"
+
+struct nodeArenaBlock_t
+{
+    nodeArenaBlock_t *next = NULL;
+    node_t nodes[kNodeArenaBlockSize];
+};
+
+int NodeArenaCtor (nodeArena_t *arena)
+{
+    assert (arena);
+
+    arena->blocks    = NULL;
+    arena->blockUsed = kNodeArenaBlockSize;
+    arena->freeList  = NULL;
+
+    return TREE_OK;
+}
+
+void NodeArenaDtor (nodeArena_t *arena)
+{
+    assert (arena);
+
+    nodeArenaBlock_t *block = arena->blocks;
+    while (block != NULL)
+    {
+        nodeArenaBlock_t *next = block->next;
+        free (block);
+        block = next;
+    }
+
+    arena->blocks    = NULL;
+    arena->blockUsed = kNodeArenaBlockSize;
+    arena->freeList  = NULL;
+}
+
+node_t *NodeArenaAlloc (nodeArena_t *arena)
+{
+    assert (arena);
+
+    node_t *node = NULL;
+
+    if (arena->freeList != NULL)
+    {
+        node = arena->freeList;
+        arena->freeList = node->left;
+    }
+    else
+    {
+        if (arena->blockUsed == kNodeArenaBlockSize)
+        {
+            nodeArenaBlock_t *block = (nodeArenaBlock_t *) calloc (1, sizeof (nodeArenaBlock_t));
+            if (block == NULL)
+            {
+                ERROR_LOG ("Error allocating memory for arena block - %s", strerror (errno));
+
+                return NULL;
+            }
+
+            block->next      = arena->blocks;
+            arena->blocks    = block;
+            arena->blockUsed = 0;
+        }
+
+        node = &arena->blocks->nodes[arena->blockUsed];
+        arena->blockUsed++;
+    }
+
+    node->type          = TYPE_UKNOWN;
+    node->value.number  = 0;
+    node->left          = NULL;
+    node->right         = NULL;
+
+    return node;
+}
+
+void NodeArenaFree (nodeArena_t *arena, node_t *node)
+{
+    assert (arena);
+    assert (node);
+
+    node->left  = arena->freeList;
+    node->right = NULL;
+
+    arena->freeList = node;
+}
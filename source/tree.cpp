@@ -9,11 +9,14 @@
 #include "tree_log.h"
 #include "utils.h"
 #include "float_math.h"
+#include "tree_profile.h"
 
 #include "tree.h"
 #include "tree_calc.h"
 
 static int TreeCountNodes       (node_t *node, size_t size, size_t *nodesCount);
+static node_t *NodeAlloc        (tree_t *tree);
+static void NodeFree            (tree_t *tree, node_t *node);
 
 
 // maybe: pass varInfo here for ERROR_LOG
@@ -21,13 +24,9 @@ node_t *NodeCtor (tree_t *tree)
 {
     assert (tree);
 
-    node_t *node = (node_t *) calloc (1, sizeof(node_t));
+    node_t *node = NodeAlloc (tree);
     if (node == NULL)
-    {
-        ERROR_LOG ("Error allocating memory for new node - %s", strerror (errno));
-
         return NULL;
-    }
 
     DEBUG_LOG ("tree->size = %lu", tree->size);
     tree->size += 1;
@@ -69,13 +68,9 @@ node_t *NodeCtorAndFill (tree_t *tree,
 
     DEBUG_PRINT ("%s", "\n========== NODE CTOR START ==========\n");
 
-    node_t *node = (node_t *) calloc (1, sizeof(node_t));
+    node_t *node = NodeAlloc (tree);
     if (node == NULL)
-    {
-        ERROR_LOG ("Error allocating memory for new node - %s", strerror (errno));
-
         return NULL;
-    }
 
     tree->size += 1;
 
@@ -132,7 +127,8 @@ void TreeDtor (tree_t *tree)
 {
     assert (tree);
 
-    TreeDelete (tree, &tree->root);
+    if (tree->root != NULL)
+        TreeDelete (tree, &tree->root);
 }
 
 // TODO: 
@@ -156,10 +152,43 @@ void TreeDelete (tree_t *tree, node_t **node)
     DEBUG_VAR ("deleted [%p]", node);
     DEBUG_VAR ("tree->size = %lu", tree->size);
     
-    free (*node);
+    NodeFree (tree, *node);
     *node = NULL;
 }
 
+node_t *NodeAlloc (tree_t *tree)
+{
+    assert (tree);
+
+    PROFILE_COUNT (PROFILE_NODES_CREATED, 1);
+
+    if (tree->arena != NULL)
+        return NodeArenaAlloc (tree->arena);
+
+    node_t *node = (node_t *) calloc (1, sizeof(node_t));
+    if (node == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for new node - %s", strerror (errno));
+
+        return NULL;
+    }
+
+    return node;
+}
+
+void NodeFree (tree_t *tree, node_t *node)
+{
+    assert (tree);
+    assert (node);
+
+    PROFILE_COUNT (PROFILE_NODES_FREED, 1);
+
+    if (tree->arena != NULL)
+        NodeArenaFree (tree->arena, node);
+    else
+        free (node);
+}
+
 int TreeVerify (tree_t *tree)
 {
     int error = TREE_OK;
@@ -0,0 +1,737 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "tree_batch.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_load_infix.h"
+#include "tree_partial.h"
+#include "tree_report.h"
+#include "node_arena.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include "tree_profile.h"
+#include "tree_pade.h"
+#include "tree_codegen.h"
+#include "tree_roots.h"
+#include "tree_extrema.h"
+#include "tree_integral.h"
+#include "tree_plot.h"
+
+struct batch_t;
+
+struct batchJob_t
+{
+    batch_t *batch      = NULL;
+    size_t seq          = 0;
+    char *expression    = NULL; // points into input buffer
+
+    char *result        = NULL; // JSON line, open_memstream() buffer
+    size_t resultLen    = 0;
+    bool done           = false;
+};
+
+// differentiator is not here: waiting worker can run another job in the middle of its own
+struct batchWorker_t
+{
+    nodeArena_t arena       = {};
+};
+
+struct batch_t
+{
+    batchOptions_t *options = NULL;
+    threadPool_t *pool      = NULL;
+    reportQueue_t *reports  = NULL; // NULL - without reports
+
+    batchJob_t *jobs        = NULL;
+    size_t jobsCnt          = 0;
+
+    batchWorker_t *workers  = NULL;
+    size_t workersCnt       = 0;
+
+    pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER;
+    size_t nextToPrint         = 0;
+};
+
+static int  BatchSplitLines     (batch_t *batch, char *buffer);
+static void BatchProcessJob     (void *arg, size_t workerIdx);
+static int  BatchProcessReport  (batchJob_t *job, size_t workerIdx, FILE *out);
+static int  BatchComputeJob     (batchJob_t *job, differentiator_t *diff,
+                                 size_t workerIdx, FILE *out);
+static int  BatchComputePade    (differentiator_t *diff, batchOptions_t *options, FILE *out);
+static int  BatchComputeRoots   (differentiator_t *diff, batchOptions_t *options,
+                                 const codegen_t *codegen, FILE *out);
+static int  BatchComputeExtrema (differentiator_t *diff, const codegen_t *codegen, FILE *out);
+static int  BatchComputeIntegral(differentiator_t *diff, batchOptions_t *options,
+                                 const codegen_t *codegen, FILE *out);
+static int  BatchComputePartials(batchJob_t *job, differentiator_t *diff,
+                                 size_t workerIdx, FILE *out);
+static void BatchPrintReady     (batch_t *batch, batchJob_t *job);
+static void BatchPrintDouble    (FILE *out, double value);
+static void BatchPrintString    (FILE *out, const char *str, size_t len);
+
+int TreeBatchRun (batchOptions_t *options)
+{
+    assert (options);
+    assert (options->inputFileName);
+
+    if (options->output == NULL)
+        options->output = stdout;
+
+    size_t bufferLen = 0;
+    char *buffer = ReadFile (options->inputFileName, &bufferLen);
+    if (buffer == NULL)
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_READING_FILE;
+
+    batch_t batch = {};
+    batch.options = options;
+
+    int status = BatchSplitLines (&batch, buffer);
+    if (status != TREE_OK)
+    {
+        free (buffer);
+
+        return status;
+    }
+
+    threadPool_t pool = {};
+    status = ThreadPoolCtor (&pool, options->threadsCnt);
+    if (status != COMMON_ERROR_OK)
+    {
+        free (batch.jobs);
+        free (buffer);
+
+        return TREE_ERROR_COMMON |
+               status;
+    }
+
+    batch.pool       = &pool;
+    batch.workersCnt = ThreadPoolSlotsCnt (&pool);
+    batch.workers    = (batchWorker_t *) calloc (batch.workersCnt, sizeof (batchWorker_t));
+    if (batch.workers == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for batch workers - %s", strerror (errno));
+
+        ThreadPoolDtor (&pool);
+        free (batch.jobs);
+        free (buffer);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    for (size_t i = 0; i < batch.workersCnt; i++)
+    {
+        NodeArenaCtor (&batch.workers[i].arena);
+    }
+
+    reportQueue_t reports = {};
+    if (options->report)
+    {
+        status = ReportQueueCtor (&reports, kReportQueueCapacity, kReportRenderersCnt);
+        if (status == TREE_OK)
+            batch.reports = &reports;
+    }
+
+    taskGroup_t group = {};
+    size_t externalIdx = ThreadPoolExternalIdx (&pool);
+
+    for (size_t i = 0; i < batch.jobsCnt && status == TREE_OK; i++)
+    {
+        status = ThreadPoolSubmit (&pool, externalIdx, &group, BatchProcessJob, &batch.jobs[i]);
+        if (status != COMMON_ERROR_OK)
+            status |= TREE_ERROR_COMMON;
+    }
+
+    ThreadPoolWait (&pool, externalIdx, &group);
+    ThreadPoolDtor (&pool);
+
+    // waits for the last reports
+    if (batch.reports != NULL)
+        status |= ReportQueueDtor (batch.reports);
+
+    for (size_t i = 0; i < batch.workersCnt; i++)
+    {
+        NodeArenaDtor (&batch.workers[i].arena);
+    }
+
+    // jobs which were not submitted because of error
+    for (size_t i = 0; i < batch.jobsCnt; i++)
+    {
+        free (batch.jobs[i].result);
+    }
+
+    pthread_mutex_destroy (&batch.outputLock);
+
+    free (batch.workers);
+    free (batch.jobs);
+    free (buffer);
+
+    return status;
+}
+
+int BatchSplitLines (batch_t *batch, char *buffer)
+{
+    assert (batch);
+    assert (buffer);
+
+    size_t linesCnt = 1;
+    for (char *c = buffer; *c != '\0'; c++)
+    {
+        if (*c == '\n')
+            linesCnt++;
+    }
+
+    batch->jobs = (batchJob_t *) calloc (linesCnt, sizeof (batchJob_t));
+    if (batch->jobs == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for batch jobs - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    char *line = buffer;
+    while (line != NULL)
+    {
+        char *lineEnd = strchr (line, '\n');
+        if (lineEnd != NULL)
+            *lineEnd = '\0';
+
+        line = SkipSpaces (line);
+
+        if (*line != '\0' && *line != '#')
+        {
+            batchJob_t *job = &batch->jobs[batch->jobsCnt];
+
+            job->batch      = batch;
+            job->seq        = batch->jobsCnt;
+            job->expression = line;
+
+            batch->jobsCnt++;
+        }
+
+        line = (lineEnd != NULL) ? lineEnd + 1 : NULL;
+    }
+
+    DEBUG_VAR ("%lu", batch->jobsCnt);
+
+    return TREE_OK;
+}
+
+void BatchProcessJob (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    batchJob_t *job = (batchJob_t *) arg;
+    batchWorker_t *worker = &job->batch->workers[workerIdx];
+
+    uint64_t start = PROFILE_START ();
+
+    FILE *out = open_memstream (&job->result, &job->resultLen);
+    if (out == NULL)
+    {
+        ERROR_LOG ("Error in open_memstream() - %s", strerror (errno));
+
+        BatchPrintReady (job->batch, job);
+
+        return;
+    }
+
+    fprintf (out, "{\"seq\": %lu, \"expression\": ", job->seq);
+    BatchPrintString (out, job->expression, strlen (job->expression));
+    fprintf (out, "%s", ", ");
+
+    int status = TREE_OK;
+
+    if (job->batch->reports != NULL)
+    {
+        status = BatchProcessReport (job, workerIdx, out);
+    }
+    else
+    {
+        differentiator_t diff = {};
+        diff.arena     = &worker->arena;
+        diff.pool      = job->batch->pool;
+        diff.workerIdx = workerIdx;
+
+        status = DifferentiatorCtorEmpty (&diff, 4);
+        if (status == TREE_OK)
+            status = BatchComputeJob (job, &diff, workerIdx, out);
+
+        DifferentiatorDtor (&diff);
+    }
+
+    fprintf (out, "\"status\": %d}\n", status);
+    fclose (out);
+
+    PROFILE_STOP_N (PROFILE_STAGE_BATCH_JOB, start, job->seq + 1);
+
+    BatchPrintReady (job->batch, job);
+}
+
+// computes everything including plot data, then report goes to renderers
+int BatchProcessReport (batchJob_t *job, size_t workerIdx, FILE *out)
+{
+    assert (job);
+    assert (out);
+
+    report_t *report = NULL;
+
+    int status = ReportCreate (&report, job->seq, 4);
+    if (status != TREE_OK)
+    {
+        ReportDestroy (report);
+
+        return status;
+    }
+
+    differentiator_t *diff = &report->diff;
+    diff->pool              = job->batch->pool;
+    diff->workerIdx         = workerIdx;
+    diff->log.numberFormat  = job->batch->options->numberFormat;
+    diff->log.latexNodeLimit = job->batch->options->latexNodeLimit;
+    diff->log.plotChebyshevTolerance = job->batch->options->chebyshevTolerance;
+    diff->log.plotCompiled  = job->batch->options->compile;
+
+    fprintf (out, "%s", "\"report\": ");
+    BatchPrintString (out, diff->log.logFolderPath, strlen (diff->log.logFolderPath));
+    fprintf (out, "%s", ", ");
+
+    status = BatchComputeJob (job, diff, workerIdx, out);
+
+    if (status == TREE_OK && diff->varToDiff != NULL)
+        status = TreeGeneratePlots (diff, &report->plots);
+
+    if (status != TREE_OK)
+    {
+        ReportDestroy (report);
+
+        return status;
+    }
+
+    ReportQueuePush (job->batch->reports, report);
+
+    return TREE_OK;
+}
+
+int BatchComputeJob (batchJob_t *job, differentiator_t *diff,
+                     size_t workerIdx, FILE *out)
+{
+    assert (job);
+    assert (diff);
+    assert (out);
+
+    batchOptions_t *options = job->batch->options;
+
+    TREE_DO_AND_RETURN (TreeLoadInfixFromString (diff, &diff->expression,
+                                                 job->expression, &diff->buffer));
+
+    for (size_t i = 0; i < diff->variablesSize; i++)
+    {
+        diff->variables[i].value = options->point;
+    }
+
+    variable_t *var = NULL;
+    if (diff->variablesSize > 0)
+    {
+        if (options->varName == NULL)
+            var = &diff->variables[0];
+        else
+            var = FindVariableByName (diff, options->varName, strlen (options->varName));
+
+        if (var == NULL)
+        {
+            ERROR_PRINT ("No variable \"%s\" in expression \"%s\"", options->varName, job->expression);
+
+            return TREE_ERROR_WRONG_ARGUMENT;
+        }
+
+        fprintf (out, "%s", "\"variable\": ");
+        BatchPrintString (out, var->name, var->len);
+        fprintf (out, "%s", ", ");
+
+        TREE_DO_AND_RETURN (TreesDiffByVariable (diff, &diff->expression, var, options->diffTimes));
+        TREE_DO_AND_RETURN (DumpLatexTaylor (diff));
+    }
+
+    fprintf (out, "%s", "\"point\": ");
+    BatchPrintDouble (out, options->point);
+
+    // without variables there is no taylor, only value
+    double value = 0;
+    if (diff->taylorCoefsCnt == 0)
+        value = NodeCalculate (diff, diff->expression.root);
+
+    // derivatives were evaluated once by TaylorBuild()
+    fprintf (out, "%s", ", \"derivatives\": [");
+
+    if (diff->taylorCoefsCnt == 0)
+        BatchPrintDouble (out, value);
+
+    for (size_t i = 0; i < diff->taylorCoefsCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "" : ", ");
+        BatchPrintDouble (out, diff->taylorDerivatives[i]);
+    }
+
+    fprintf (out, "%s", "], \"taylor\": [");
+
+    if (diff->taylorCoefsCnt == 0)
+        BatchPrintDouble (out, value);
+
+    for (size_t i = 0; i < diff->taylorCoefsCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "" : ", ");
+        BatchPrintDouble (out, diff->taylorCoefs[i]);
+    }
+
+    fprintf (out, "%s", "], ");
+
+    if (options->pade)
+        TREE_DO_AND_RETURN (BatchComputePade (diff, options, out));
+
+    if (options->roots || options->extrema || options->integral)
+    {
+        codegen_t codegen = {};
+
+        // roots, extrema and integral are found by trees if code can't be compiled
+        bool compiled = options->compile && diff->varToDiff != NULL &&
+                        CodegenCtor (&codegen, diff, diff->varToDiff->idx) == TREE_OK;
+
+        int status = TREE_OK;
+
+        if (options->roots)
+            status = BatchComputeRoots (diff, options, compiled ? &codegen : NULL, out);
+
+        if (status == TREE_OK && options->extrema)
+            status = BatchComputeExtrema (diff, compiled ? &codegen : NULL, out);
+
+        if (status == TREE_OK && options->integral)
+            status = BatchComputeIntegral (diff, options, compiled ? &codegen : NULL, out);
+
+        CodegenDtor (&codegen);
+
+        if (status != TREE_OK)
+            return status;
+    }
+
+    fprintf (out, "%s", "\"nodes\": [");
+    fprintf (out, "%lu", diff->expression.size);
+
+    for (size_t i = 0; i < diff->diffTreesCnt; i++)
+    {
+        fprintf (out, ", %lu", diff->diffTrees[i].size);
+    }
+
+    fprintf (out, "%s", "], ");
+
+    if (options->gradient || options->hessian)
+        TREE_DO_AND_RETURN (BatchComputePartials (job, diff, workerIdx, out));
+
+    return TREE_OK;
+}
+
+// null if there is no approximant of this shape or taylor is too short
+int BatchComputePade (differentiator_t *diff, batchOptions_t *options, FILE *out)
+{
+    assert (diff);
+    assert (options);
+    assert (out);
+
+    pade_t pade = {};
+
+    int status = TREE_ERROR_WRONG_ARGUMENT;
+
+    if (diff->taylorCoefsCnt > 0)
+        status = PadeCtor (&pade, diff->taylorCoefs, diff->taylorCoefsCnt, diff->taylorCenter,
+                           options->padeNumDegree, options->padeDenDegree);
+
+    if (status == TREE_ERROR_WRONG_ARGUMENT || status == TREE_ERROR_SINGULAR)
+    {
+        fprintf (out, "%s", "\"pade\": null, ");
+
+        return TREE_OK;
+    }
+
+    if (status != TREE_OK)
+        return status;
+
+    fprintf (out, "%s", "\"pade\": {\"numerator\": [");
+
+    for (size_t i = 0; i < pade.numCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "" : ", ");
+        BatchPrintDouble (out, pade.num[i]);
+    }
+
+    fprintf (out, "%s", "], \"denominator\": [");
+
+    for (size_t i = 0; i < pade.denCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "" : ", ");
+        BatchPrintDouble (out, pade.den[i]);
+    }
+
+    fprintf (out, "%s", "]}, ");
+
+    status = DumpLatexPade (diff, &pade);
+
+    PadeDtor (&pade);
+
+    return status;
+}
+
+// without variables there are no roots, expression is a constant
+int BatchComputeRoots (differentiator_t *diff, batchOptions_t *options,
+                       const codegen_t *codegen, FILE *out)
+{
+    assert (diff);
+    assert (options);
+    assert (out);
+
+    if (diff->varToDiff == NULL)
+    {
+        fprintf (out, "%s", "\"roots\": [], ");
+
+        return TREE_OK;
+    }
+
+    roots_t roots = {};
+
+    TREE_DO_AND_RETURN (RootsFind (&roots, diff, codegen, 0,
+                                   options->rootsLeft, options->rootsRight));
+
+    fprintf (out, "%s", "\"roots\": [");
+
+    for (size_t i = 0; i < roots.rootsCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "{\"x\": " : ", {\"x\": ");
+        BatchPrintDouble (out, roots.roots[i].x);
+        fprintf (out, "%s", ", \"value\": ");
+        BatchPrintDouble (out, roots.roots[i].value);
+        fprintf (out, ", \"iterations\": %lu}", roots.roots[i].iterations);
+    }
+
+    fprintf (out, "%s", "], ");
+
+    RootsDtor (&roots);
+
+    return TREE_OK;
+}
+
+// over the plot range, so extrema in report match its plots
+int BatchComputeExtrema (differentiator_t *diff, const codegen_t *codegen, FILE *out)
+{
+    assert (diff);
+    assert (out);
+
+    if (diff->varToDiff == NULL)
+    {
+        fprintf (out, "%s", "\"extrema\": [], ");
+
+        return TREE_OK;
+    }
+
+    extrema_t extrema = {};
+
+    TREE_DO_AND_RETURN (ExtremaFind (&extrema, diff, codegen, kLeftRange, kRightRange));
+
+    fprintf (out, "%s", "\"extrema\": [");
+
+    for (size_t i = 0; i < extrema.pointsCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "{\"x\": " : ", {\"x\": ");
+        BatchPrintDouble (out, extrema.points[i].x);
+        fprintf (out, "%s", ", \"y\": ");
+        BatchPrintDouble (out, extrema.points[i].y);
+        fprintf (out, ", \"type\": \"%s\"}", ExtremumTypeName (extrema.points[i].type));
+    }
+
+    fprintf (out, "%s", "], ");
+
+    int status = DumpLatexExtrema (diff, &extrema);
+
+    ExtremaDtor (&extrema);
+
+    return status;
+}
+
+// null if expression is not finite somewhere in range,
+// without variables expression is a constant and integral is exact
+int BatchComputeIntegral (differentiator_t *diff, batchOptions_t *options,
+                          const codegen_t *codegen, FILE *out)
+{
+    assert (diff);
+    assert (options);
+    assert (out);
+
+    integral_t integral = {};
+
+    int status = TREE_OK;
+
+    if (diff->varToDiff == NULL)
+    {
+        integral.value     = NodeCalculate (diff, diff->expression.root) *
+                             (options->integralRight - options->integralLeft);
+        integral.converged = isfinite (integral.value);
+
+        if (!integral.converged)
+            status = TREE_ERROR_SINGULAR;
+    }
+    else
+    {
+        status = IntegralCompute (&integral, diff, codegen, options->integralLeft,
+                                  options->integralRight, kIntegralTolerance);
+    }
+
+    if (status == TREE_ERROR_SINGULAR)
+    {
+        fprintf (out, "%s", "\"integral\": null, ");
+
+        return TREE_OK;
+    }
+
+    if (status != TREE_OK)
+        return status;
+
+    fprintf (out, "%s", "\"integral\": {\"value\": ");
+    BatchPrintDouble (out, integral.value);
+    fprintf (out, "%s", ", \"error\": ");
+    BatchPrintDouble (out, integral.error);
+    fprintf (out, ", \"intervals\": %lu, \"converged\": %s}, ",
+             integral.intervalsCnt, integral.converged ? "true" : "false");
+
+    return TREE_OK;
+}
+
+int BatchComputePartials (batchJob_t *job, differentiator_t *diff,
+                          size_t workerIdx, FILE *out)
+{
+    assert (job);
+    assert (diff);
+    assert (out);
+
+    bool withHessian = job->batch->options->hessian;
+
+    partials_t partials = {};
+    int status = TreesPartialDiff (diff, &diff->expression, job->batch->pool, workerIdx,
+                                   withHessian, &partials);
+    if (status != TREE_OK)
+    {
+        PartialsDtor (&partials);
+
+        return status;
+    }
+
+    // partials are in order of diff->variables (as in expression), not by name
+    fprintf (out, "%s", "\"variables\": [");
+
+    for (size_t i = 0; i < partials.variablesCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "" : ", ");
+        BatchPrintString (out, diff->variables[i].name, diff->variables[i].len);
+    }
+
+    fprintf (out, "%s", "], \"gradient\": [");
+
+    for (size_t i = 0; i < partials.variablesCnt; i++)
+    {
+        fprintf (out, "%s", (i == 0) ? "" : ", ");
+        BatchPrintDouble (out, NodeCalculate (diff, partials.gradient[i].root));
+    }
+
+    fprintf (out, "%s", "], ");
+
+    if (withHessian)
+    {
+        fprintf (out, "%s", "\"hessian\": [");
+
+        for (size_t i = 0; i < partials.variablesCnt; i++)
+        {
+            fprintf (out, "%s", (i == 0) ? "[" : ", [");
+
+            for (size_t j = 0; j < partials.variablesCnt; j++)
+            {
+                fprintf (out, "%s", (j == 0) ? "" : ", ");
+                BatchPrintDouble (out, NodeCalculate (diff, PartialsHessian (&partials, i, j)->root));
+            }
+
+            fprintf (out, "%s", "]");
+        }
+
+        fprintf (out, "%s", "], ");
+    }
+
+    PartialsDtor (&partials);
+
+    return TREE_OK;
+}
+
+// prints all finished jobs which are next in order
+void BatchPrintReady (batch_t *batch, batchJob_t *job)
+{
+    assert (batch);
+    assert (job);
+
+    pthread_mutex_lock (&batch->outputLock);
+
+    job->done = true;
+
+    while (batch->nextToPrint < batch->jobsCnt &&
+           batch->jobs[batch->nextToPrint].done)
+    {
+        batchJob_t *ready = &batch->jobs[batch->nextToPrint];
+
+        if (ready->result != NULL)
+        {
+            fwrite (ready->result, sizeof (char), ready->resultLen, batch->options->output);
+            PROFILE_COUNT (PROFILE_BYTES_WRITTEN, ready->resultLen);
+        }
+
+        free (ready->result);
+        ready->result = NULL;
+
+        batch->nextToPrint++;
+    }
+
+    fflush (batch->options->output);
+
+    pthread_mutex_unlock (&batch->outputLock);
+}
+
+// JSON has no nan and inf
+void BatchPrintDouble (FILE *out, double value)
+{
+    assert (out);
+
+    if (isfinite (value))
+        FprintDouble (out, value, {.mode = DOUBLE_FORMAT_SHORTEST});
+    else
+        fprintf (out, "%s", "null");
+}
+
+void BatchPrintString (FILE *out, const char *str, size_t len)
+{
+    assert (out);
+    assert (str);
+
+    fputc ('"', out);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (str[i] == '"' || str[i] == '\\')
+            fputc ('\\', out);
+
+        fputc (str[i], out);
+    }
+
+    fputc ('"', out);
+}
@@ -10,6 +10,7 @@
 #include "tree_load_infix.h"
 #include "utils.h"
 #include "float_math.h"
+#include "tree_profile.h"
 
 static double NodeCalculateDoMath       (node_t *node, double leftVal, double rightVal);
 static double NodeGetVariable           (differentiator_t *diff, node_t *node);
@@ -30,7 +31,24 @@ int DifferentiatorCtor (differentiator_t *diff, size_t variablesCapacity)
     assert (diff);
 
     TREE_DO_AND_RETURN (LogCtor (&diff->log));
-    
+
+    TREE_DO_AND_RETURN (DifferentiatorCtorEmpty (diff, variablesCapacity));
+
+    diff->interactive = true;
+
+    size_t len = 0;
+    TREE_DO_AND_RETURN (TreeLoadInfixFromFile (diff, &diff->expression, 
+                        ktreeSaveFileName, &diff->buffer, &len));
+
+    return TREE_OK;
+}
+
+// Doesn't touch diff->log and diff->arena and doesn't load anything,
+// so LogCtor() should be called and arena should be set before if needed
+int DifferentiatorCtorEmpty (differentiator_t *diff, size_t variablesCapacity)
+{
+    assert (diff);
+
     diff->variablesCapacity = variablesCapacity;
     diff->variablesSize     = 0;
 
@@ -48,16 +66,34 @@ int DifferentiatorCtor (differentiator_t *diff, size_t variablesCapacity)
     diff->diffTreesCnt      = 0;
     diff->varToDiff         = NULL;
     diff->buffer            = NULL;
+    diff->interactive       = false;
 
     TREE_DO_AND_RETURN (TREE_CTOR (&diff->expression, &diff->log));
+    TREE_DO_AND_RETURN (TREE_CTOR (&diff->taylor,     &diff->log));
 
-    size_t len = 0;
-    TREE_DO_AND_RETURN (TreeLoadInfixFromFile (diff, &diff->expression, 
-                        ktreeSaveFileName, &diff->buffer, &len));
+    diff->expression.arena = diff->arena;
+    diff->taylor.arena     = diff->arena;
 
     return TREE_OK;
 }
 
+// View shares variables with source, but has no log, no arena and
+// never asks user, so it can be used by several threads at the same time
+// for reading source trees. View must not be passed to DifferentiatorDtor()
+void DifferentiatorCtorView (differentiator_t *view, differentiator_t *source)
+{
+    assert (view);
+    assert (source);
+
+    *view = {};
+
+    view->variables         = source->variables;
+    view->variablesCapacity = source->variablesCapacity;
+    view->variablesSize     = source->variablesSize;
+    view->varToDiff         = source->varToDiff;
+    view->interactive       = false;
+}
+
 void DifferentiatorDtor (differentiator_t *diff)
 {
     assert (diff);
@@ -67,6 +103,11 @@ void DifferentiatorDtor (differentiator_t *diff)
     TreeDtor (&diff->expression);
     TreeDtor (&diff->taylor);
 
+    free (diff->taylorCoefs);
+    diff->taylorCoefs       = NULL;
+    diff->taylorDerivatives = NULL;
+    diff->taylorCoefsCnt    = 0;
+
     for (size_t i = 0; i < diff->diffTreesCnt; i++)
     {
         TreeDtor (&diff->diffTrees[i]);
@@ -117,7 +158,7 @@ void TryToFindOperator (char *str, int len, type_t *type, treeDataType *value)
     }
 }
 
-variable_t *FindVariableByName (differentiator_t *diff, char *varName, size_t varNameLen)
+variable_t *FindVariableByName (differentiator_t *diff, const char *varName, size_t varNameLen)
 {
     assert (diff);
     assert (varName);
@@ -133,7 +174,8 @@ variable_t *FindVariableByName (differentiator_t *diff, char *varName, size_t va
                    (int)diff->variables[i].len,
                    diff->variables[i].name);
         
-        if (strncmp (diff->variables[i].name, varName, varNameLen) == 0)
+        if (diff->variables[i].len == varNameLen &&
+            strncmp (diff->variables[i].name, varName, varNameLen) == 0)
         {
             return &diff->variables[i];
         }
@@ -286,6 +328,46 @@ double NodeCalculate (differentiator_t *diff, node_t *node)
     
         default:
             assert (0 && "Add new case in NodeCalctulate or wtf bro");
+            return NAN;
+    }
+}
+
+// Doesn't change diff and never asks user, so can be called from many threads.
+// Variable varIdx is equal to varValue, others are taken from diff->variables
+double NodeCalculateAt (differentiator_t *diff, node_t *node, size_t varIdx, double varValue)
+{
+    assert (diff);
+    assert (node);
+
+    double leftVal  = NAN;
+    double rightVal = NAN;
+
+    if (node->left != NULL)
+        leftVal = NodeCalculateAt (diff, node->left, varIdx, varValue);
+
+    if (node->right != NULL)
+        rightVal = NodeCalculateAt (diff, node->right, varIdx, varValue);
+
+    switch (node->type)
+    {
+        case TYPE_UKNOWN:
+            return NAN;
+            
+        case TYPE_CONST_NUM:
+            return node->value.number;
+
+        case TYPE_MATH_OPERATION:
+            return NodeCalculateDoMath (node, leftVal, rightVal);
+
+        case TYPE_VARIABLE:
+            if (node->value.idx == varIdx)
+                return varValue;
+
+            return diff->variables[node->value.idx].value;
+    
+        default:
+            assert (0 && "Add new case in NodeCalctulateAt");
+            return NAN;
     }
 }
 
@@ -321,6 +403,7 @@ double NodeCalculateDoMath (node_t *node, double leftVal, double rightVal)
         
         default:
             assert (0 && "Bro, add another case for NodeCalculateDoMath()");
+            return NAN;
     }
 }
 
@@ -331,7 +414,7 @@ double NodeGetVariable (differentiator_t *diff, node_t *node)
 
     // DEBUG_VAR ("%lu", node->value.idx);
 
-    if (isnan (diff->variables[node->value.idx].value))
+    if (isnan (diff->variables[node->value.idx].value) && diff->interactive)
     {
         AskVariableValue (diff, node);
     }
@@ -391,17 +474,23 @@ void TreeSimplify (differentiator_t *diff, tree_t *tree)
     bool modifiedFirst = true;
     bool modifiedSecond = true;
 
+    uint64_t start = PROFILE_START ();
+
     while (modifiedFirst || modifiedSecond)
     {
         modifiedFirst  = false;
         modifiedSecond = false;
 
+        PROFILE_COUNT (PROFILE_SIMPLIFY_ROUNDS, 1);
+
         tree->root = NodeSimplifyCalc (tree, tree->root, &modifiedFirst);
         TREE_DUMP (diff, tree, "%s", "After NodeSimplifyCalc()");
 
         tree->root = NodeSimplifyTrivial (tree, tree->root, &modifiedSecond);
         TREE_DUMP (diff, tree, "%s", "After NodeSimplifyTrivial()");
     }
+
+    PROFILE_STOP (PROFILE_STAGE_SIMPLIFY, start);
 }
 
 node_t *NodeSimplifyCalc (tree_t *tree, node_t *node, bool *modified)
@@ -582,6 +671,18 @@ int TreesDiff (differentiator_t *diff, tree_t *expression)
 
     TREE_DO_AND_RETURN (AskUserAboutDifferentation (diff, &diffTimes, &var));
 
+    return TreesDiffByVariable (diff, expression, var, diffTimes);
+}
+
+int TreesDiffByVariable (differentiator_t *diff, tree_t *expression,
+                         variable_t *var, size_t diffTimes)
+{
+    assert (diff);
+    assert (expression);
+    assert (var);
+
+    diff->varToDiff = var;
+
     if (diffTimes == 0) 
         return TREE_OK;
 
@@ -599,24 +700,32 @@ int TreesDiff (differentiator_t *diff, tree_t *expression)
     for (size_t i = 0; i < diff->diffTreesCnt; i++)
     {
         TREE_DO_AND_RETURN (TREE_CTOR (&diff->diffTrees[i], &diff->log));
+        diff->diffTrees[i].arena = diff->arena;
     }
 
     DumpLatexFunction (diff, expression->root);
 
-    fprintf (diff->log.latexFile, "\\section*{Продифференцируем нашу функцию %lu раз(-а)}\n", diff->diffTreesCnt);
+    if (diff->log.latex != NULL)
+        TextBufferPrintf (diff->log.latex, "\\section*{Продифференцируем нашу функцию %lu раз(-а)}\n", diff->diffTreesCnt);
 
     for (size_t i = 0; i < diff->diffTreesCnt; i++)
     {
         DEBUG_VAR ("%lu", i);
 
-        fprintf (diff->log.latexFile, "\\subsection*{Найдём %lu-ую производную}\n", i + 1);
+        if (diff->log.latex != NULL)
+            TextBufferPrintf (diff->log.latex, "\\subsection*{Найдём %lu-ую производную}\n", i + 1);
 
         tree_t *tree = &diff->diffTrees[i];
+
+        uint64_t start = PROFILE_START ();
+
         if (i == 0)
             tree->root = NodeDiff (diff, expression->root, tree, var);
         else
             tree->root = NodeDiff (diff, diff->diffTrees[i - 1].root, tree, var);
 
+        PROFILE_STOP_N (PROFILE_STAGE_DIFF, start, i + 1);
+
         if (tree->root == NULL)
             return TREE_ERROR_NULL_ROOT;
 
@@ -795,6 +904,7 @@ node_t *NodeDiffMathOperation (differentiator_t *diff, node_t *expression, tree_
                 return NUM_ (0);
             
             assert (0 && "Uknown case of OP_POW");
+            return NULL;
         }
 
         // FIXME: check all cases
@@ -891,6 +1001,7 @@ node_t *NodeDiffMathOperation (differentiator_t *diff, node_t *expression, tree_
 
         default:
             assert (0 && "There is not implemented differentation for function");
+            return NULL;
     }
 }
 
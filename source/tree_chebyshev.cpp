@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_chebyshev.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+
+const size_t kChebyshevStartCapacity = 16;
+
+// everything that doesn't change while range is split
+struct chebyshevBuild_t
+{
+    chebyshev_t *cheb       = NULL;
+    differentiator_t *diff  = NULL;
+    node_t *root            = NULL;
+    size_t varIdx           = 0;
+    double tolerance        = 0;
+
+    // cos (pi * k * (j + 1/2) / n): row k - coefficient, column j - node
+    double cosines[kChebyshevDegree * kChebyshevDegree] = {};
+};
+
+static int  ChebyshevSplit      (chebyshevBuild_t *build, double left, double right, size_t depth);
+static int  ChebyshevAddPiece   (chebyshev_t *cheb, double left, double right, const double *coefs);
+
+int ChebyshevCtor (chebyshev_t *cheb, differentiator_t *diff, node_t *root,
+                   size_t varIdx, double left, double right, double tolerance)
+{
+    assert (cheb);
+    assert (diff);
+    assert (root);
+
+    *cheb = {};
+
+    if (!(left < right) || !(tolerance > 0))
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    cheb->left  = left;
+    cheb->right = right;
+
+    chebyshevBuild_t build = {};
+    build.cheb      = cheb;
+    build.diff      = diff;
+    build.root      = root;
+    build.varIdx    = varIdx;
+    build.tolerance = tolerance;
+
+    const size_t n = kChebyshevDegree;
+
+    for (size_t k = 0; k < n; k++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            build.cosines[k * n + j] = cos (M_PI * (double) k * ((double) j + 0.5) / (double) n);
+        }
+    }
+
+    int status = ChebyshevSplit (&build, left, right, 0);
+
+    // cost of failed attempt is still counted
+    if (status != TREE_OK)
+    {
+        size_t evaluationsCnt = cheb->evaluationsCnt;
+
+        ChebyshevDtor (cheb);
+
+        cheb->evaluationsCnt = evaluationsCnt;
+    }
+
+    return status;
+}
+
+void ChebyshevDtor (chebyshev_t *cheb)
+{
+    assert (cheb);
+
+    free (cheb->breaks);
+    free (cheb->pieces);
+
+    *cheb = {};
+}
+
+// pieces are added from left to right, so breaks are sorted
+int ChebyshevSplit (chebyshevBuild_t *build, double left, double right, size_t depth)
+{
+    assert (build);
+
+    const size_t n = kChebyshevDegree;
+
+    double center    = (left + right) / 2;
+    double halfWidth = (right - left) / 2;
+
+    double values[kChebyshevDegree] = {};
+    double maxValue = 1;
+
+    for (size_t j = 0; j < n; j++)
+    {
+        // cos (pi * (j + 1/2) / n) is row k = 1
+        double x = center + halfWidth * build->cosines[n + j];
+
+        values[j] = NodeCalculateAt (build->diff, build->root, build->varIdx, x);
+        build->cheb->evaluationsCnt++;
+
+        if (!isfinite (values[j]))
+            return TREE_ERROR_SINGULAR;
+
+        maxValue = fmax (maxValue, fabs (values[j]));
+    }
+
+    double coefs[kChebyshevDegree] = {};
+
+    for (size_t k = 0; k < n; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 0; j < n; j++)
+        {
+            sum = fma (values[j], build->cosines[k * n + j], sum);
+        }
+
+        coefs[k] = sum * 2 / (double) n;
+    }
+
+    coefs[0] /= 2;
+
+    // series converges fast for smooth function, the last terms estimate the error
+    double tail = fabs (coefs[n - 1]) + fabs (coefs[n - 2]);
+
+    if (tail <= build->tolerance * maxValue)
+        return ChebyshevAddPiece (build->cheb, left, right, coefs);
+
+    if (depth == kChebyshevMaxDepth)
+        return TREE_ERROR_SINGULAR;
+
+    TREE_DO_AND_RETURN (ChebyshevSplit (build, left,   center, depth + 1));
+    TREE_DO_AND_RETURN (ChebyshevSplit (build, center, right,  depth + 1));
+
+    return TREE_OK;
+}
+
+int ChebyshevAddPiece (chebyshev_t *cheb, double left, double right, const double *coefs)
+{
+    assert (cheb);
+    assert (coefs);
+
+    if (cheb->piecesCnt == cheb->piecesCapacity)
+    {
+        size_t newCapacity = (cheb->piecesCapacity == 0) ? kChebyshevStartCapacity
+                                                         : cheb->piecesCapacity * 2;
+
+        double *breaks = (double *) realloc (cheb->breaks, newCapacity * sizeof (double));
+        if (breaks == NULL)
+        {
+            ERROR_LOG ("Error reallocating memory for chebyshev pieces - %s", strerror (errno));
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_ALLOCATING_MEMORY;
+        }
+
+        cheb->breaks = breaks;
+
+        chebyshevPiece_t *pieces = (chebyshevPiece_t *) realloc (cheb->pieces,
+                                                                 newCapacity * sizeof (chebyshevPiece_t));
+        if (pieces == NULL)
+        {
+            ERROR_LOG ("Error reallocating memory for chebyshev pieces - %s", strerror (errno));
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_ALLOCATING_MEMORY;
+        }
+
+        cheb->pieces         = pieces;
+        cheb->piecesCapacity = newCapacity;
+    }
+
+    chebyshevPiece_t *piece = &cheb->pieces[cheb->piecesCnt];
+
+    piece->center       = (left + right) / 2;
+    piece->invHalfWidth = 2 / (right - left);
+    memcpy (piece->coefs, coefs, kChebyshevDegree * sizeof (double));
+
+    cheb->breaks[cheb->piecesCnt] = left;
+    cheb->piecesCnt++;
+
+    return TREE_OK;
+}
+
+double ChebyshevEvaluate (const chebyshev_t *cheb, double x)
+{
+    assert (cheb);
+    assert (cheb->piecesCnt > 0);
+
+    // the same number of steps for every x, comparison becomes conditional move
+    const double *base = cheb->breaks;
+    size_t len = cheb->piecesCnt;
+
+    while (len > 1)
+    {
+        size_t half = len / 2;
+
+        base = (base[half] <= x) ? base + half : base;
+        len -= half;
+    }
+
+    const chebyshevPiece_t *piece = &cheb->pieces[base - cheb->breaks];
+
+    double t  = (x - piece->center) * piece->invHalfWidth;
+    double t2 = 2 * t;
+
+    // Clenshaw: b_k = c_k + 2t * b_(k+1) - b_(k+2), result = c_0 + t * b_1 - b_2
+    double b1 = 0;
+    double b2 = 0;
+
+    for (size_t k = kChebyshevDegree - 1; k > 0; k--)
+    {
+        double b0 = fma (t2, b1, piece->coefs[k] - b2);
+
+        b2 = b1;
+        b1 = b0;
+    }
+
+    return fma (t, b1, piece->coefs[0] - b2);
+}
@@ -0,0 +1,621 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "tree_codegen.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_latex_share.h"
+#include "tree_profile.h"
+#include "text_buffer.h"
+#include "process_manager.h"
+
+// part of the hash: the same source with other flags is another object
+const char * const kCodegenFlags[] =
+{
+    "-O3", "-march=native", "-ffp-contract=off", "-fPIC", "-shared"
+};
+const size_t kCodegenFlagsCnt = sizeof (kCodegenFlags) / sizeof (kCodegenFlags[0]);
+
+const char kCodegenFuncFormat[] = "diff_tree_%lu";
+
+const size_t kCodegenCacheDirLen = kCodegenPathLen - 64; // the rest is for file names
+
+static size_t codegenTmpCnt = 0; // unique names of temporary files
+
+static int  CodegenSource       (textBuffer_t *source, const tree_t *tree,
+                                 size_t funcIdx, size_t varIdx);
+static void CodegenOperand      (textBuffer_t *source, const latexShare_t *share,
+                                 size_t entry, size_t varIdx);
+static void CodegenOperation    (textBuffer_t *source, const latexShare_t *share,
+                                 const latexShareEntry_t *entry, size_t varIdx);
+static int  CodegenCacheDir     (char *cacheDir);
+static bool CodegenIsCached     (const char *cacheDir, const char *name,
+                                 const textBuffer_t *source, const char *objectPath);
+static int  CodegenCompile      (const char *cacheDir, const char *name,
+                                 textBuffer_t *source, const char *objectPath);
+static int  CodegenLoad         (codegen_t *codegen, const char *objectPath);
+static const tree_t *CodegenTree (differentiator_t *diff, size_t funcIdx);
+static uint64_t CodegenHash     (const char *data, size_t size);
+
+int CodegenCtor (codegen_t *codegen, differentiator_t *diff, size_t varIdx)
+{
+    assert (codegen);
+    assert (diff);
+
+    *codegen = {};
+
+    uint64_t start = PROFILE_START ();
+
+    codegen->funcsCnt     = diff->diffTreesCnt + 2;
+    codegen->variablesCnt = diff->variablesSize;
+
+    codegen->funcs     = (codegenFunc_t *) calloc (codegen->funcsCnt, sizeof (codegenFunc_t));
+    codegen->variables = (double *)        calloc (codegen->variablesCnt + 1, sizeof (double));
+
+    if (codegen->funcs == NULL || codegen->variables == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for compiled trees - %s", strerror (errno));
+
+        CodegenDtor (codegen);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    for (size_t i = 0; i < codegen->variablesCnt; i++)
+    {
+        codegen->variables[i] = diff->variables[i].value;
+    }
+
+    textBuffer_t source = {};
+
+    int status = TextBufferCtor (&source, kTextBufferStartCapacity);
+    if (status != COMMON_ERROR_OK)
+    {
+        CodegenDtor (codegen);
+
+        return TREE_ERROR_COMMON |
+               status;
+    }
+
+    TextBufferPuts (&source, "#include <math.h>\n");
+
+    for (size_t i = 0; i < codegen->funcsCnt && status == TREE_OK; i++)
+    {
+        status = CodegenSource (&source, CodegenTree (diff, i), i, varIdx);
+    }
+
+    TextBufferPrintf (&source, "\n// %s", kCodegenCompiler);
+
+    for (size_t i = 0; i < kCodegenFlagsCnt; i++)
+    {
+        TextBufferPrintf (&source, " %s", kCodegenFlags[i]);
+    }
+
+    TextBufferPuts (&source, "\n");
+
+    char cacheDir[kCodegenCacheDirLen]  = {};
+    char name[32]                       = {};
+    char objectPath[kCodegenPathLen]    = {};
+
+    if (status == TREE_OK && source.failed)
+        status = TREE_ERROR_COMMON |
+                 COMMON_ERROR_ALLOCATING_MEMORY;
+
+    if (status == TREE_OK)
+        status = CodegenCacheDir (cacheDir);
+
+    snprintf (name, sizeof (name), "%016lx", CodegenHash (source.data, source.size));
+    snprintf (objectPath, kCodegenPathLen, "%s%s.so", cacheDir, name);
+
+    // broken or foreign object in cache is compiled again
+    if (status == TREE_OK)
+    {
+        codegen->fromCache = (CodegenIsCached (cacheDir, name, &source, objectPath) &&
+                              CodegenLoad (codegen, objectPath) == TREE_OK);
+
+        if (!codegen->fromCache)
+        {
+            status = CodegenCompile (cacheDir, name, &source, objectPath);
+
+            if (status == TREE_OK)
+                status = CodegenLoad (codegen, objectPath);
+        }
+    }
+
+    TextBufferDtor (&source);
+
+    if (status != TREE_OK)
+        CodegenDtor (codegen);
+
+    PROFILE_STOP (PROFILE_STAGE_CODEGEN, start);
+
+    return status;
+}
+
+void CodegenDtor (codegen_t *codegen)
+{
+    assert (codegen);
+
+    if (codegen->handle != NULL)
+        dlclose (codegen->handle);
+
+    free (codegen->funcs);
+    free (codegen->variables);
+
+    *codegen = {};
+}
+
+codegenFunc_t CodegenFind (const codegen_t *codegen, const differentiator_t *diff,
+                           const tree_t *tree)
+{
+    assert (codegen);
+    assert (diff);
+    assert (tree);
+
+    if (codegen->funcs == NULL)
+        return NULL;
+
+    if (tree == &diff->expression)
+        return codegen->funcs[0];
+
+    if (tree == &diff->taylor)
+        return codegen->funcs[codegen->funcsCnt - 1];
+
+    if (tree >= diff->diffTrees && tree < diff->diffTrees + diff->diffTreesCnt)
+        return codegen->funcs[(size_t) (tree - diff->diffTrees) + 1];
+
+    return NULL;
+}
+
+void EvaluatorCtor (evaluator_t *evaluator, differentiator_t *diff,
+                    const codegen_t *codegen, const tree_t *tree, size_t varIdx)
+{
+    assert (evaluator);
+    assert (diff);
+    assert (tree);
+    assert (tree->root);
+
+    *evaluator = {};
+
+    evaluator->diff   = diff;
+    evaluator->root   = tree->root;
+    evaluator->varIdx = varIdx;
+
+    if (codegen != NULL)
+    {
+        evaluator->compiled  = CodegenFind (codegen, diff, tree);
+        evaluator->variables = codegen->variables;
+    }
+}
+
+double EvaluatorCalculate (const evaluator_t *evaluator, double x)
+{
+    assert (evaluator);
+
+    if (evaluator->compiled != NULL)
+        return evaluator->compiled (evaluator->variables, x);
+
+    return NodeCalculateAt (evaluator->diff, evaluator->root, evaluator->varIdx, x);
+}
+
+void EvaluatorCalculateMany (const evaluator_t *evaluator, const double *x, double *y, size_t cnt)
+{
+    assert (evaluator);
+    assert (x);
+    assert (y);
+
+    // check is out of the loop
+    if (evaluator->compiled != NULL)
+    {
+        for (size_t i = 0; i < cnt; i++)
+        {
+            y[i] = evaluator->compiled (evaluator->variables, x[i]);
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < cnt; i++)
+    {
+        y[i] = NodeCalculateAt (evaluator->diff, evaluator->root, evaluator->varIdx, x[i]);
+    }
+}
+
+const tree_t *CodegenTree (differentiator_t *diff, size_t funcIdx)
+{
+    assert (diff);
+
+    if (funcIdx == 0)
+        return &diff->expression;
+
+    if (funcIdx <= diff->diffTreesCnt)
+        return &diff->diffTrees[funcIdx - 1];
+
+    return &diff->taylor;
+}
+
+// every entry of share is computed once, children go before parents
+int CodegenSource (textBuffer_t *source, const tree_t *tree, size_t funcIdx, size_t varIdx)
+{
+    assert (source);
+    assert (tree);
+
+    if (tree->root == NULL)
+        return TREE_OK;
+
+    latexShare_t share = {};
+    TREE_DO_AND_RETURN (LatexShareCtor (&share, tree->root));
+
+    TextBufferPuts   (source, "\ndouble ");
+    TextBufferPrintf (source, kCodegenFuncFormat, funcIdx);
+    TextBufferPuts   (source, " (const double *v, double x)\n{\n");
+
+    for (size_t i = 0; i < share.entriesCnt; i++)
+    {
+        const latexShareEntry_t *entry = &share.entries[i];
+
+        if (entry->node->type != TYPE_MATH_OPERATION)
+            continue;
+
+        TextBufferPrintf (source, "    const double t%lu = ", i);
+        CodegenOperation (source, &share, entry, varIdx);
+        TextBufferPuts   (source, ";\n");
+    }
+
+    TextBufferPuts (source, "    return ");
+    CodegenOperand (source, &share, share.entriesCnt, varIdx);
+    TextBufferPuts (source, ";\n}\n");
+
+    LatexShareDtor (&share);
+
+    return TREE_OK;
+}
+
+// entry + 1, as in latexShareEntry_t::left, leaves are written in place
+void CodegenOperand (textBuffer_t *source, const latexShare_t *share, size_t entry, size_t varIdx)
+{
+    assert (source);
+    assert (share);
+
+    if (entry == 0)
+    {
+        TextBufferPuts (source, "NAN");
+
+        return;
+    }
+
+    const node_t *node = share->entries[entry - 1].node;
+
+    switch (node->type)
+    {
+        case TYPE_MATH_OPERATION:
+            TextBufferPrintf (source, "t%lu", entry - 1);
+            break;
+
+        case TYPE_VARIABLE:
+            if (node->value.idx == varIdx)
+                TextBufferPuts (source, "x");
+            else
+                TextBufferPrintf (source, "v[%lu]", node->value.idx);
+            break;
+
+        // hexadecimal is exact
+        case TYPE_CONST_NUM:
+            if (isnan (node->value.number))
+                TextBufferPuts (source, "NAN");
+            else if (isinf (node->value.number))
+                TextBufferPuts (source, (node->value.number > 0) ? "INFINITY" : "(-INFINITY)");
+            else
+                TextBufferPrintf (source, "(%a)", node->value.number);
+            break;
+
+        case TYPE_UKNOWN:
+        default:
+            TextBufferPuts (source, "NAN");
+            break;
+    }
+}
+
+// the same functions as NodeCalculateDoMath()
+void CodegenOperation (textBuffer_t *source, const latexShare_t *share,
+                       const latexShareEntry_t *entry, size_t varIdx)
+{
+    assert (source);
+    assert (share);
+    assert (entry);
+
+    const char *function = NULL;
+    const char *infix    = NULL;
+    const char *prefix   = "";
+
+    switch (entry->node->value.idx)
+    {
+        case OP_ADD:    infix    = " + ";                   break;
+        case OP_SUB:    infix    = " - ";                   break;
+        case OP_MUL:    infix    = " * ";                   break;
+        case OP_DIV:    infix    = " / ";                   break;
+        case OP_LN:     function = "log";                   break;
+        case OP_SIN:    function = "sin";                   break;
+        case OP_COS:    function = "cos";                   break;
+        case OP_TG:     function = "tan";                   break;
+        case OP_CTG:    function = "tan";   prefix = "1 / "; break;
+        case OP_ARCSIN: function = "asin";                  break;
+        case OP_ARCCOS: function = "acos";                  break;
+        case OP_ARCTG:  function = "atan";                  break;
+        case OP_ARCCTG: function = "atan";  prefix = "1 / "; break;
+        case OP_SH:     function = "sinh";                  break;
+        case OP_CH:     function = "cosh";                  break;
+        case OP_TH:     function = "tanh";                  break;
+        case OP_CTH:    function = "tanh";  prefix = "1 / "; break;
+
+        case OP_POW:
+            TextBufferPuts (source, "pow (");
+            CodegenOperand (source, share, entry->left, varIdx);
+            TextBufferPuts (source, ", ");
+            CodegenOperand (source, share, entry->right, varIdx);
+            TextBufferPuts (source, ")");
+            return;
+
+        case OP_LOG:
+            TextBufferPuts (source, "log (");
+            CodegenOperand (source, share, entry->right, varIdx);
+            TextBufferPuts (source, ") / log (");
+            CodegenOperand (source, share, entry->left, varIdx);
+            TextBufferPuts (source, ")");
+            return;
+
+        case OP_UNKNOWN:
+        default:
+            TextBufferPuts (source, "NAN");
+            return;
+    }
+
+    if (infix != NULL)
+    {
+        CodegenOperand (source, share, entry->left, varIdx);
+        TextBufferPuts (source, infix);
+        CodegenOperand (source, share, entry->right, varIdx);
+
+        return;
+    }
+
+    TextBufferPrintf (source, "%s%s (", prefix, function);
+    CodegenOperand   (source, share, entry->right, varIdx);
+    TextBufferPuts   (source, ")");
+}
+
+// $DIFFERENTIATOR_CACHE, $XDG_CACHE_HOME/differentiator/ or ~/.cache/differentiator/,
+// with '/' at the end, into kCodegenCacheDirLen bytes. Missing folders are created only for user
+int CodegenCacheDir (char *cacheDir)
+{
+    assert (cacheDir);
+
+    const char *base   = getenv (kCodegenCacheEnvName);
+    const char *folder = "";    // inside base
+
+    if (base == NULL || base[0] == '\0')
+    {
+        base   = getenv ("XDG_CACHE_HOME");
+        folder = kCodegenCacheDir;
+    }
+
+    if (base == NULL || base[0] == '\0')
+    {
+        base   = getenv ("HOME");
+        folder = kCodegenHomeCacheDir;
+    }
+
+    if (base == NULL || base[0] == '\0')
+    {
+        ERROR_LOG ("No folder for compiled code, set %s or HOME", kCodegenCacheEnvName);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_CREATING_FILE;
+    }
+
+    int len = snprintf (cacheDir, kCodegenCacheDirLen, "%s%s%s", base,
+                        (base[strlen (base) - 1] == '/') ? "" : "/", folder);
+    if (len < 0 || (size_t) len >= kCodegenCacheDirLen)
+    {
+        ERROR_LOG ("Folder for compiled code in \"%s\" is too long", base);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_SNPRINTF;
+    }
+
+    // like mkdir -p, but with S_IRWXU only
+    for (char *slash = strchr (cacheDir + 1, '/'); slash != NULL; slash = strchr (slash + 1, '/'))
+    {
+        *slash = '\0';
+
+        bool failed = (mkdir (cacheDir, S_IRWXU) != 0 && errno != EEXIST);
+
+        *slash = '/';
+
+        if (failed)
+        {
+            ERROR_LOG ("Error creating folder \"%s\" - %s", cacheDir, strerror (errno));
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_CREATING_FILE;
+        }
+    }
+
+    // anything others can put here would be loaded
+    struct stat info = {};
+    if (stat (cacheDir, &info) != 0 || info.st_uid != getuid () ||
+        (info.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+        ERROR_LOG ("Folder \"%s\" for compiled code must belong to user "
+                   "and be closed for writing by others", cacheDir);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_CREATING_FILE;
+    }
+
+    return TREE_OK;
+}
+
+// object is used only with the same source saved next to it, hash alone can collide
+bool CodegenIsCached (const char *cacheDir, const char *name,
+                      const textBuffer_t *source, const char *objectPath)
+{
+    assert (cacheDir);
+    assert (name);
+    assert (source);
+    assert (objectPath);
+
+    if (access (objectPath, R_OK) != 0)
+        return false;
+
+    char sourcePath[kCodegenPathLen] = {};
+    snprintf (sourcePath, kCodegenPathLen, "%s%s.c", cacheDir, name);
+
+    FILE *sourceFile = fopen (sourcePath, "rb");
+    if (sourceFile == NULL)
+        return false;
+
+    // one byte more to see that saved source is not longer
+    char *saved = (char *) calloc (source->size + 1, sizeof (char));
+
+    bool same = (saved != NULL &&
+                 fread (saved, sizeof (char), source->size + 1, sourceFile) == source->size &&
+                 memcmp (saved, source->data, source->size) == 0);
+
+    free (saved);
+    fclose (sourceFile);
+
+    return same;
+}
+
+// into temporary files, then renamed: other processes never see half-written object
+int CodegenCompile (const char *cacheDir, const char *name, textBuffer_t *source,
+                    const char *objectPath)
+{
+    assert (cacheDir);
+    assert (name);
+    assert (source);
+    assert (objectPath);
+
+    size_t tmpIdx = __atomic_fetch_add (&codegenTmpCnt, 1, __ATOMIC_RELAXED);
+
+    char sourcePath[kCodegenPathLen]    = {};
+    char tmpSourcePath[kCodegenPathLen] = {};
+    char tmpObjectPath[kCodegenPathLen] = {};
+
+    snprintf (sourcePath,    kCodegenPathLen, "%s%s.c", cacheDir, name);
+    snprintf (tmpSourcePath, kCodegenPathLen, "%s%s.%d.%lu.c",  cacheDir, name, getpid (), tmpIdx);
+    snprintf (tmpObjectPath, kCodegenPathLen, "%s%s.%d.%lu.so", cacheDir, name, getpid (), tmpIdx);
+
+    int status = TextBufferWriteFile (source, tmpSourcePath);
+    if (status != COMMON_ERROR_OK)
+        return TREE_ERROR_COMMON |
+               status;
+
+    const char *argv[kCodegenFlagsCnt + 6] = {};
+    size_t argc = 0;
+
+    argv[argc++] = kCodegenCompiler;
+
+    for (size_t i = 0; i < kCodegenFlagsCnt; i++)
+    {
+        argv[argc++] = kCodegenFlags[i];
+    }
+
+    argv[argc++] = "-o";
+    argv[argc++] = tmpObjectPath;
+    argv[argc++] = tmpSourcePath;
+    argv[argc++] = "-lm";
+    argv[argc++] = NULL;
+
+    process_t compiler = {};
+
+    status = ProcessStart (&compiler, argv, PROCESS_QUIET);
+    if (status == COMMON_ERROR_OK)
+        status = ProcessWait (&compiler);
+
+    if (status == COMMON_ERROR_OK &&
+        (rename (tmpObjectPath, objectPath) != 0 || rename (tmpSourcePath, sourcePath) != 0))
+    {
+        ERROR_LOG ("Error moving compiled code into \"%s\" - %s", objectPath, strerror (errno));
+
+        status = COMMON_ERROR_CREATING_FILE;
+    }
+
+    if (status != COMMON_ERROR_OK)
+    {
+        remove (tmpSourcePath);
+        remove (tmpObjectPath);
+
+        return TREE_ERROR_COMMON |
+               status;
+    }
+
+    return TREE_OK;
+}
+
+int CodegenLoad (codegen_t *codegen, const char *objectPath)
+{
+    assert (codegen);
+    assert (objectPath);
+
+    void *handle = dlopen (objectPath, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL)
+    {
+        ERROR_LOG ("Error loading \"%s\" - %s", objectPath, dlerror ());
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_OPENING_FILE;
+    }
+
+    char funcName[32] = {};
+
+    for (size_t i = 0; i < codegen->funcsCnt; i++)
+    {
+        snprintf (funcName, sizeof (funcName), kCodegenFuncFormat, i);
+
+        // tree without root has no function
+        void *symbol = dlsym (handle, funcName);
+
+        memcpy (&codegen->funcs[i], &symbol, sizeof (codegenFunc_t));
+    }
+
+    if (codegen->funcs[0] == NULL)
+    {
+        ERROR_LOG ("No \"%s\" in \"%s\"", "diff_tree_0", objectPath);
+
+        dlclose (handle);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_OPENING_FILE;
+    }
+
+    codegen->handle = handle;
+
+    return TREE_OK;
+}
+
+// FNV-1a
+uint64_t CodegenHash (const char *data, size_t size)
+{
+    assert (data);
+
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_extrema.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_codegen.h"
+#include "tree_roots.h"
+
+static int  ExtremaRoots    (roots_t *roots, differentiator_t *diff, const codegen_t *codegen,
+                             size_t order, double left, double right);
+static void ExtremaMerge    (extrema_t *extrema, const evaluator_t *function,
+                             const roots_t *critical, const roots_t *inflections);
+
+int ExtremaFind (extrema_t *extrema, differentiator_t *diff, const codegen_t *codegen,
+                 double left, double right)
+{
+    assert (extrema);
+    assert (diff);
+    assert (diff->varToDiff);
+
+    *extrema = {};
+
+    if (!(left < right))
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    roots_t critical    = {};
+    roots_t inflections = {};
+
+    int status = ExtremaRoots (&critical, diff, codegen, 1, left, right);
+
+    if (status == TREE_OK)
+        status = ExtremaRoots (&inflections, diff, codegen, 2, left, right);
+
+    if (status == TREE_OK && critical.rootsCnt + inflections.rootsCnt > 0)
+    {
+        extrema->points = (extremum_t *) calloc (critical.rootsCnt + inflections.rootsCnt,
+                                                 sizeof (extremum_t));
+        if (extrema->points == NULL)
+        {
+            ERROR_LOG ("Error allocating memory for extrema - %s", strerror (errno));
+
+            status = TREE_ERROR_COMMON |
+                     COMMON_ERROR_ALLOCATING_MEMORY;
+        }
+    }
+
+    if (status == TREE_OK)
+    {
+        evaluator_t function = {};
+        EvaluatorCtor (&function, diff, codegen, &diff->expression, diff->varToDiff->idx);
+
+        ExtremaMerge (extrema, &function, &critical, &inflections);
+    }
+
+    RootsDtor (&critical);
+    RootsDtor (&inflections);
+
+    if (status != TREE_OK)
+        ExtremaDtor (extrema);
+
+    return status;
+}
+
+void ExtremaDtor (extrema_t *extrema)
+{
+    assert (extrema);
+
+    free (extrema->points);
+
+    *extrema = {};
+}
+
+const char *ExtremumTypeName (extremumType_t type)
+{
+    switch (type)
+    {
+        case EXTREMUM_MIN:          return "min";
+        case EXTREMUM_MAX:          return "max";
+        case EXTREMUM_INFLECTION:   return "inflection";
+
+        default:                    return "unknown";
+    }
+}
+
+// derivative which wasn't taken has no roots
+int ExtremaRoots (roots_t *roots, differentiator_t *diff, const codegen_t *codegen,
+                  size_t order, double left, double right)
+{
+    assert (roots);
+    assert (diff);
+
+    *roots = {};
+
+    if (order > diff->diffTreesCnt || diff->diffTrees[order - 1].root == NULL)
+        return TREE_OK;
+
+    return RootsFind (roots, diff, codegen, order, left, right);
+}
+
+// both lists are sorted, so merge keeps ascending x
+void ExtremaMerge (extrema_t *extrema, const evaluator_t *function,
+                   const roots_t *critical, const roots_t *inflections)
+{
+    assert (extrema);
+    assert (function);
+    assert (critical);
+    assert (inflections);
+
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < critical->rootsCnt || j < inflections->rootsCnt)
+    {
+        bool isCritical = j == inflections->rootsCnt ||
+                          (i < critical->rootsCnt &&
+                           critical->roots[i].x <= inflections->roots[j].x);
+
+        const root_t *root = isCritical ? &critical->roots[i++] : &inflections->roots[j++];
+
+        if (root->direction == 0)
+            continue;
+
+        extremum_t *point = &extrema->points[extrema->pointsCnt++];
+
+        point->x = root->x;
+        point->y = EvaluatorCalculate (function, root->x);
+
+        if (!isCritical)
+            point->type = EXTREMUM_INFLECTION;
+        else
+            point->type = (root->direction > 0) ? EXTREMUM_MIN : EXTREMUM_MAX;
+    }
+}
@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_integral.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_codegen.h"
+#include "tree_profile.h"
+#include "thread_pool.h"
+
+const size_t kIntegralNodesCnt = 15;
+
+// nodes of Kronrod rule on [-1, 1] (x and -x), odd ones are Gauss nodes, the last is 0
+const double kIntegralKronrodNodes[8] = {
+    0.991455371120812639206854697526329,
+    0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926,
+    0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013,
+    0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245,
+    0.000000000000000000000000000000000,
+};
+
+const double kIntegralKronrodWeights[8] = {
+    0.022935322010529224963732008058970,
+    0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518,
+    0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550,
+    0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649,
+    0.209482141084727828012999174891714,
+};
+
+// weights of Gauss nodes kIntegralKronrodNodes[1, 3, 5, 7]
+const double kIntegralGaussWeights[4] = {
+    0.129484966168869693270611432679082,
+    0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975,
+    0.417959183673469387755102040816327,
+};
+
+struct integralInterval_t
+{
+    double left         = 0;
+    double right        = 0;
+    double value        = 0;
+    double absValue     = 0;    // of |f|
+    double error        = 0;
+    bool singular       = false; // not finite value in some node
+};
+
+// shared by all tasks, every task writes only its own intervals
+struct integralSearch_t
+{
+    evaluator_t function            = {};
+
+    integralInterval_t *intervals   = NULL;
+    size_t intervalsCnt             = 0;
+
+    size_t *pending                 = NULL; // intervals to evaluate in this round
+    size_t pendingCnt               = 0;
+};
+
+struct integralChunk_t
+{
+    integralSearch_t *search    = NULL;
+    size_t begin                = 0;    // in pending
+    size_t end                  = 0;
+};
+
+static int  IntegralRunRound    (integralSearch_t *search, threadPool_t *pool, size_t workerIdx);
+static void IntegralTask        (void *arg, size_t workerIdx);
+static void IntegralRule        (integralInterval_t *interval, const double *values);
+static void IntegralSplit       (integralSearch_t *search, double tolerance, double width);
+
+int IntegralCompute (integral_t *integral, differentiator_t *diff, const codegen_t *codegen,
+                     double left, double right, double tolerance)
+{
+    assert (integral);
+    assert (diff);
+    assert (diff->varToDiff);
+
+    *integral = {};
+
+    if (!(left < right) || !(tolerance > 0))
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    if (diff->expression.root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    uint64_t start = PROFILE_START ();
+
+    integralSearch_t search = {};
+
+    search.intervals = (integralInterval_t *) calloc (kIntegralMaxIntervals, sizeof (integralInterval_t));
+    search.pending   = (size_t *)             calloc (kIntegralMaxIntervals, sizeof (size_t));
+
+    if (search.intervals == NULL || search.pending == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for integral intervals - %s", strerror (errno));
+
+        free (search.intervals);
+        free (search.pending);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    EvaluatorCtor (&search.function, diff, codegen, &diff->expression, diff->varToDiff->idx);
+
+    for (size_t i = 0; i < kIntegralStartIntervals; i++)
+    {
+        search.intervals[i].left  = left + (right - left) * (double) i       / (double) kIntegralStartIntervals;
+        search.intervals[i].right = left + (right - left) * (double) (i + 1) / (double) kIntegralStartIntervals;
+
+        search.pending[i] = i;
+    }
+
+    search.intervals[kIntegralStartIntervals - 1].right = right;
+    search.intervalsCnt = kIntegralStartIntervals;
+    search.pendingCnt   = kIntegralStartIntervals;
+
+    threadPool_t localPool = {};
+    threadPool_t *pool     = diff->pool;
+    size_t workerIdx       = diff->workerIdx;
+
+    int status = TREE_OK;
+
+    if (pool == NULL)
+    {
+        status = ThreadPoolCtor (&localPool, 0);
+        if (status != COMMON_ERROR_OK)
+        {
+            free (search.intervals);
+            free (search.pending);
+
+            return TREE_ERROR_COMMON |
+                   status;
+        }
+
+        pool      = &localPool;
+        workerIdx = ThreadPoolExternalIdx (pool);
+    }
+
+    size_t evaluationsCnt = 0;
+
+    while (status == TREE_OK && search.pendingCnt > 0)
+    {
+        evaluationsCnt += search.pendingCnt * kIntegralNodesCnt;
+
+        status = IntegralRunRound (&search, pool, workerIdx);
+        if (status != TREE_OK)
+            break;
+
+        // sums are recomputed every round, so rounding errors don't accumulate
+        integral->value = 0;
+        integral->error = 0;
+
+        double absValue = 0;
+
+        for (size_t i = 0; i < search.intervalsCnt; i++)
+        {
+            if (search.intervals[i].singular)
+                status = TREE_ERROR_SINGULAR;
+
+            integral->value += search.intervals[i].value;
+            integral->error += search.intervals[i].error;
+            absValue        += search.intervals[i].absValue;
+        }
+
+        // integral of |f| doesn't vanish when positive and negative parts cancel
+        double absTolerance = tolerance * absValue;
+
+        if (status == TREE_OK && integral->error <= absTolerance)
+        {
+            integral->converged = true;
+            break;
+        }
+
+        if (status == TREE_OK)
+            IntegralSplit (&search, absTolerance, right - left);
+    }
+
+    if (pool == &localPool)
+        ThreadPoolDtor (&localPool);
+
+    integral->intervalsCnt = search.intervalsCnt;
+
+    free (search.intervals);
+    free (search.pending);
+
+    PROFILE_STOP  (PROFILE_STAGE_INTEGRAL, start);
+    PROFILE_COUNT (PROFILE_EVALUATIONS, evaluationsCnt);
+
+    return status;
+}
+
+int IntegralRunRound (integralSearch_t *search, threadPool_t *pool, size_t workerIdx)
+{
+    assert (search);
+    assert (pool);
+
+    size_t cnt = search->pendingCnt;
+
+    size_t chunksCnt = ThreadPoolSlotsCnt (pool) * kIntegralChunksPerWorker;
+    size_t chunkSize = (cnt + chunksCnt - 1) / chunksCnt;
+
+    if (chunkSize < kIntegralMinChunkSize)
+        chunkSize = kIntegralMinChunkSize;
+
+    chunksCnt = (cnt + chunkSize - 1) / chunkSize;
+
+    integralChunk_t *chunks = (integralChunk_t *) calloc (chunksCnt, sizeof (integralChunk_t));
+    if (chunks == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for integral chunks - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    taskGroup_t group = {};
+
+    for (size_t i = 0; i < chunksCnt; i++)
+    {
+        chunks[i].search = search;
+        chunks[i].begin  = i * chunkSize;
+        chunks[i].end    = chunks[i].begin + chunkSize;
+
+        if (chunks[i].end > cnt)
+            chunks[i].end = cnt;
+
+        if (ThreadPoolSubmit (pool, workerIdx, &group, IntegralTask, &chunks[i]) != COMMON_ERROR_OK)
+            IntegralTask (&chunks[i], workerIdx);
+    }
+
+    ThreadPoolWait (pool, workerIdx, &group);
+
+    free (chunks);
+
+    return TREE_OK;
+}
+
+// nodes of all intervals of chunk are evaluated by one call
+void IntegralTask (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    (void) workerIdx;
+
+    integralChunk_t *chunk   = (integralChunk_t *) arg;
+    integralSearch_t *search = chunk->search;
+
+    const size_t n = kIntegralNodesCnt;
+
+    double x[kIntegralMinChunkSize * kIntegralNodesCnt] = {};
+    double y[kIntegralMinChunkSize * kIntegralNodesCnt] = {};
+
+    for (size_t begin = chunk->begin; begin < chunk->end; begin += kIntegralMinChunkSize)
+    {
+        size_t end = begin + kIntegralMinChunkSize;
+        if (end > chunk->end)
+            end = chunk->end;
+
+        for (size_t i = begin; i < end; i++)
+        {
+            const integralInterval_t *interval = &search->intervals[search->pending[i]];
+
+            double center    = (interval->left + interval->right) / 2;
+            double halfWidth = (interval->right - interval->left) / 2;
+
+            double *nodes = x + (i - begin) * n;
+
+            // [0..6] - left of center, [7] - center, [8..14] - right
+            for (size_t j = 0; j < 7; j++)
+            {
+                nodes[j]         = center - halfWidth * kIntegralKronrodNodes[j];
+                nodes[n - 1 - j] = center + halfWidth * kIntegralKronrodNodes[j];
+            }
+
+            nodes[7] = center;
+        }
+
+        EvaluatorCalculateMany (&search->function, x, y, (end - begin) * n);
+
+        for (size_t i = begin; i < end; i++)
+        {
+            IntegralRule (&search->intervals[search->pending[i]], y + (i - begin) * n);
+        }
+    }
+}
+
+// error estimate of QUADPACK qk15
+void IntegralRule (integralInterval_t *interval, const double *values)
+{
+    assert (interval);
+    assert (values);
+
+    const size_t n = kIntegralNodesCnt;
+
+    for (size_t j = 0; j < n; j++)
+    {
+        if (!isfinite (values[j]))
+        {
+            interval->singular = true;
+            interval->value    = NAN;
+            interval->error    = NAN;
+
+            return;
+        }
+    }
+
+    double center     = values[7];
+    double kronrod    = center * kIntegralKronrodWeights[7];
+    double gauss      = center * kIntegralGaussWeights[3];
+    double absKronrod = fabs (kronrod);
+
+    for (size_t j = 0; j < 7; j++)
+    {
+        double sum = values[j] + values[n - 1 - j];
+
+        kronrod    += kIntegralKronrodWeights[j] * sum;
+        absKronrod += kIntegralKronrodWeights[j] * (fabs (values[j]) + fabs (values[n - 1 - j]));
+
+        if (j % 2 == 1)
+            gauss += kIntegralGaussWeights[j / 2] * sum;
+    }
+
+    double mean = kronrod / 2;
+    double deviation = kIntegralKronrodWeights[7] * fabs (center - mean);
+
+    for (size_t j = 0; j < 7; j++)
+    {
+        deviation += kIntegralKronrodWeights[j] * (fabs (values[j] - mean) + fabs (values[n - 1 - j] - mean));
+    }
+
+    double halfWidth = (interval->right - interval->left) / 2;
+
+    double error = fabs ((kronrod - gauss) * halfWidth);
+
+    deviation  *= halfWidth;
+    absKronrod *= halfWidth;
+
+    if (deviation > 0 && error > 0)
+        error = deviation * fmin (1, pow (200 * error / deviation, 1.5));
+
+    if (absKronrod > DBL_MIN / (50 * DBL_EPSILON))
+        error = fmax (50 * DBL_EPSILON * absKronrod, error);
+
+    interval->value    = kronrod * halfWidth;
+    interval->absValue = absKronrod;
+    interval->error    = error;
+}
+
+// interval is halved if its error is bigger than its share of tolerance,
+// left half stays in place, right one is appended
+void IntegralSplit (integralSearch_t *search, double tolerance, double width)
+{
+    assert (search);
+
+    search->pendingCnt = 0;
+
+    size_t intervalsCnt = search->intervalsCnt;
+
+    for (size_t i = 0; i < intervalsCnt; i++)
+    {
+        integralInterval_t *interval = &search->intervals[i];
+
+        double share  = tolerance * (interval->right - interval->left) / width;
+        double center = (interval->left + interval->right) / 2;
+
+        // interval can't be halved any more
+        if (!(interval->left < center && center < interval->right))
+            continue;
+
+        if (!(interval->error > share))
+            continue;
+
+        if (search->intervalsCnt == kIntegralMaxIntervals)
+            break;
+
+        integralInterval_t *right = &search->intervals[search->intervalsCnt];
+
+        *right       = {};
+        right->left  = center;
+        right->right = interval->right;
+
+        interval->right = center;
+
+        search->pending[search->pendingCnt++] = i;
+        search->pending[search->pendingCnt++] = search->intervalsCnt;
+        search->intervalsCnt++;
+    }
+}
@@ -0,0 +1,585 @@
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#include "tree_interval.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+
+// +, -, *, / are correctly rounded, libm functions are within 1 ulp,
+// ctg = 1 / tan has two roundings
+const int kIntervalArithmeticUlps   = 1;
+const int kIntervalLibmUlps         = 4;
+
+// sin, cos and tan can't find period of bigger arguments precisely
+const double kIntervalPeriodicMax   = 1e15;
+
+static interval_t IntervalEmpty     ();
+static interval_t IntervalWiden     (double lo, double hi, int ulps);
+static interval_t IntervalJoin      (interval_t a, interval_t b);
+static bool IntervalIsPoint         (interval_t x);
+static bool IntervalHasPeriodPoint  (interval_t x, double phase, double period);
+
+static interval_t IntervalDoMath    (node_t *node, interval_t left, interval_t right);
+static interval_t IntervalAdd       (interval_t a, interval_t b);
+static interval_t IntervalSub       (interval_t a, interval_t b);
+static interval_t IntervalMul       (interval_t a, interval_t b);
+static interval_t IntervalDiv       (interval_t a, interval_t b);
+static interval_t IntervalPow       (interval_t a, interval_t b);
+static interval_t IntervalPowInt    (interval_t a, double n);
+static interval_t IntervalPowPositive(interval_t a, interval_t b);
+static interval_t IntervalLn        (interval_t x);
+static interval_t IntervalSin       (interval_t x);
+static interval_t IntervalCos       (interval_t x);
+static interval_t IntervalTg        (interval_t x);
+static interval_t IntervalCtg       (interval_t x);
+static interval_t IntervalArcsin    (interval_t x);
+static interval_t IntervalArccos    (interval_t x);
+static interval_t IntervalArctg     (interval_t x);
+static interval_t IntervalSh        (interval_t x);
+static interval_t IntervalCh        (interval_t x);
+static interval_t IntervalTh        (interval_t x);
+static double MulEndpoints          (double a, double b);
+static bool IsZero                  (double x);
+static bool IsInteger               (double x);
+
+interval_t IntervalPoint (double x)
+{
+    if (isnan (x))
+        return IntervalEmpty ();
+
+    return IntervalMake (x, x);
+}
+
+interval_t IntervalMake (double lo, double hi)
+{
+    interval_t x = {};
+    x.lo = lo;
+    x.hi = hi;
+
+    return x;
+}
+
+bool IntervalIsEmpty (interval_t x)
+{
+    return !(x.lo <= x.hi);
+}
+
+interval_t NodeCalculateInterval (differentiator_t *diff, node_t *node,
+                                  size_t varIdx, interval_t range)
+{
+    assert (diff);
+    assert (node);
+
+    interval_t left  = IntervalEmpty ();
+    interval_t right = IntervalEmpty ();
+
+    if (node->left != NULL)
+        left = NodeCalculateInterval (diff, node->left, varIdx, range);
+
+    if (node->right != NULL)
+        right = NodeCalculateInterval (diff, node->right, varIdx, range);
+
+    switch (node->type)
+    {
+        case TYPE_UKNOWN:
+            return IntervalEmpty ();
+
+        case TYPE_CONST_NUM:
+            return IntervalPoint (node->value.number);
+
+        case TYPE_MATH_OPERATION:
+            return IntervalDoMath (node, left, right);
+
+        case TYPE_VARIABLE:
+            if (node->value.idx == varIdx)
+                return range;
+
+            return IntervalPoint (diff->variables[node->value.idx].value);
+
+        default:
+            assert (0 && "Add new case in NodeCalculateInterval");
+            return IntervalEmpty ();
+    }
+}
+
+interval_t IntervalDoMath (node_t *node, interval_t left, interval_t right)
+{
+    assert (node);
+
+    switch (node->value.idx)
+    {
+        case OP_ADD:    return IntervalAdd (left, right);
+        case OP_SUB:    return IntervalSub (left, right);
+        case OP_MUL:    return IntervalMul (left, right);
+        case OP_DIV:    return IntervalDiv (left, right);
+        case OP_POW:    return IntervalPow (left, right);
+        case OP_LOG:    return IntervalDiv (IntervalLn (right), IntervalLn (left));
+        case OP_LN:     return IntervalLn (right);
+        case OP_SIN:    return IntervalSin (right);
+        case OP_COS:    return IntervalCos (right);
+        case OP_TG:     return IntervalTg (right);
+        case OP_CTG:    return IntervalCtg (right);
+        case OP_ARCSIN: return IntervalArcsin (right);
+        case OP_ARCCOS: return IntervalArccos (right);
+        case OP_ARCTG:  return IntervalArctg (right);
+        case OP_ARCCTG: return IntervalDiv (IntervalPoint (1), IntervalArctg (right));
+        case OP_SH:     return IntervalSh (right);
+        case OP_CH:     return IntervalCh (right);
+        case OP_TH:     return IntervalTh (right);
+        case OP_CTH:    return IntervalDiv (IntervalPoint (1), IntervalTh (right));
+
+        case OP_UNKNOWN:
+            ERROR_LOG ("%s", "Uknown math operation in node");
+            return IntervalEmpty ();
+
+        default:
+            assert (0 && "Add another case for IntervalDoMath()");
+            return IntervalEmpty ();
+    }
+}
+
+interval_t IntervalEmpty ()
+{
+    interval_t x = {};
+    x.lo        = INFINITY;
+    x.hi        = -INFINITY;
+    x.undefined = true;
+
+    return x;
+}
+
+// NAN bound comes from inf - inf or 0 * inf, it means no bound on that side
+interval_t IntervalWiden (double lo, double hi, int ulps)
+{
+    if (isnan (lo)) lo = -INFINITY;
+    if (isnan (hi)) hi = INFINITY;
+
+    for (int i = 0; i < ulps; i++)
+    {
+        lo = nextafter (lo, -INFINITY);
+        hi = nextafter (hi,  INFINITY);
+    }
+
+    return IntervalMake (lo, hi);
+}
+
+interval_t IntervalJoin (interval_t a, interval_t b)
+{
+    interval_t x = {};
+
+    if (IntervalIsEmpty (a))
+        x = b;
+    else if (IntervalIsEmpty (b))
+        x = a;
+    else
+        x = IntervalMake (fmin (a.lo, b.lo), fmax (a.hi, b.hi));
+
+    x.undefined = a.undefined || b.undefined;
+
+    return x;
+}
+
+bool IntervalIsPoint (interval_t x)
+{
+    return !IntervalIsEmpty (x) && !(x.lo < x.hi);
+}
+
+// if x contains phase + k * period for some integer k.
+// Can answer "yes" for a point very close to x, never "no" for point inside
+bool IntervalHasPeriodPoint (interval_t x, double phase, double period)
+{
+    double kLo = (x.lo - phase) / period;
+    double kHi = (x.hi - phase) / period;
+
+    double eps = 1e-12 * fmax (1, fmax (fabs (kLo), fabs (kHi)));
+
+    return ceil (kLo - eps) <= floor (kHi + eps);
+}
+
+// exact comparisons, IsEqual() from float_math.h is approximate
+bool IsZero (double x)
+{
+    return x <= 0 && x >= 0;
+}
+
+bool IsInteger (double x)
+{
+    return floor (x) >= x;
+}
+
+// ============= ARITHMETIC =============
+
+interval_t IntervalAdd (interval_t a, interval_t b)
+{
+    if (IntervalIsEmpty (a) || IntervalIsEmpty (b))
+        return IntervalEmpty ();
+
+    interval_t x = IntervalWiden (a.lo + b.lo, a.hi + b.hi, kIntervalArithmeticUlps);
+    x.undefined  = a.undefined || b.undefined;
+
+    return x;
+}
+
+interval_t IntervalSub (interval_t a, interval_t b)
+{
+    if (IntervalIsEmpty (a) || IntervalIsEmpty (b))
+        return IntervalEmpty ();
+
+    interval_t x = IntervalWiden (a.lo - b.hi, a.hi - b.lo, kIntervalArithmeticUlps);
+    x.undefined  = a.undefined || b.undefined;
+
+    return x;
+}
+
+// 0 * inf is 0 here: bound is a limit, not a value
+double MulEndpoints (double a, double b)
+{
+    if (IsZero (a) || IsZero (b))
+        return 0;
+
+    return a * b;
+}
+
+interval_t IntervalMul (interval_t a, interval_t b)
+{
+    if (IntervalIsEmpty (a) || IntervalIsEmpty (b))
+        return IntervalEmpty ();
+
+    double p1 = MulEndpoints (a.lo, b.lo);
+    double p2 = MulEndpoints (a.lo, b.hi);
+    double p3 = MulEndpoints (a.hi, b.lo);
+    double p4 = MulEndpoints (a.hi, b.hi);
+
+    interval_t x = IntervalWiden (fmin (fmin (p1, p2), fmin (p3, p4)),
+                                  fmax (fmax (p1, p2), fmax (p3, p4)), kIntervalArithmeticUlps);
+    x.undefined  = a.undefined || b.undefined;
+
+    return x;
+}
+
+// divisor with 0 inside is a pole: result is unbounded on one or both sides
+interval_t IntervalDiv (interval_t a, interval_t b)
+{
+    if (IntervalIsEmpty (a) || IntervalIsEmpty (b))
+        return IntervalEmpty ();
+
+    interval_t x = {};
+
+    if (b.lo > 0 || b.hi < 0)
+    {
+        double q1 = a.lo / b.lo;
+        double q2 = a.lo / b.hi;
+        double q3 = a.hi / b.lo;
+        double q4 = a.hi / b.hi;
+
+        x = IntervalWiden (fmin (fmin (q1, q2), fmin (q3, q4)),
+                           fmax (fmax (q1, q2), fmax (q3, q4)), kIntervalArithmeticUlps);
+        x.undefined = a.undefined || b.undefined;
+
+        return x;
+    }
+
+    // here b.lo <= 0 <= b.hi
+
+    // b = [0, 0]: x / 0 is never finite
+    if (b.lo >= 0 && b.hi <= 0)
+        return IntervalEmpty ();
+
+    x.undefined = true;
+
+    // only x / (0, b.hi] or x / [b.lo, 0) are finite, sign of result is known if a doesn't cross 0
+    if (b.lo >= 0 && a.lo >= 0)
+        x = IntervalWiden (a.lo / b.hi, INFINITY, kIntervalArithmeticUlps);
+    else if (b.lo >= 0 && a.hi <= 0)
+        x = IntervalWiden (-INFINITY, a.hi / b.hi, kIntervalArithmeticUlps);
+    else if (b.hi <= 0 && a.lo >= 0)
+        x = IntervalWiden (-INFINITY, a.lo / b.lo, kIntervalArithmeticUlps);
+    else if (b.hi <= 0 && a.hi <= 0)
+        x = IntervalWiden (a.hi / b.lo, INFINITY, kIntervalArithmeticUlps);
+    else
+        x = IntervalMake (-INFINITY, INFINITY);
+
+    // 0 / b is 0 everywhere except the pole itself
+    if (IsZero (a.lo) && IsZero (a.hi))
+        x = IntervalMake (0, 0);
+
+    x.undefined = true;
+
+    return x;
+}
+
+// pow() of negative base is defined only for integer exponent
+interval_t IntervalPow (interval_t a, interval_t b)
+{
+    if (IntervalIsEmpty (a) || IntervalIsEmpty (b))
+        return IntervalEmpty ();
+
+    if (IntervalIsPoint (b) && IsInteger (b.lo) && fabs (b.lo) < 0x1p53)
+    {
+        interval_t x = IntervalPowInt (a, b.lo);
+        x.undefined |= a.undefined || b.undefined;
+
+        return x;
+    }
+
+    interval_t x = IntervalEmpty ();
+    x.undefined  = false;
+
+    if (a.hi >= 0)
+        x = IntervalJoin (x, IntervalPowPositive (IntervalMake (fmax (a.lo, 0), a.hi), b));
+
+    if (a.lo < 0)
+    {
+        // (-t)^y = +-t^y for integer y in b, NAN for all other y
+        if (ceil (b.lo) <= floor (b.hi))
+        {
+            interval_t abs = IntervalPowPositive (IntervalMake (fmax (0, -a.hi), -a.lo), b);
+
+            if (!IntervalIsEmpty (abs))
+                x = IntervalJoin (x, IntervalMake (-abs.hi, abs.hi));
+        }
+
+        x.undefined = true;
+    }
+
+    x.undefined |= a.undefined || b.undefined;
+
+    return x;
+}
+
+interval_t IntervalPowInt (interval_t a, double n)
+{
+    if (IsZero (n))
+        return IntervalPoint (1);
+
+    if (n < 0)
+        return IntervalDiv (IntervalPoint (1), IntervalPowInt (a, -n));
+
+    double powLo = pow (a.lo, n);
+    double powHi = pow (a.hi, n);
+
+    bool isOdd = fmod (n, 2) > 0;
+
+    if (isOdd || a.lo >= 0)
+        return IntervalWiden (powLo, powHi, kIntervalLibmUlps);
+
+    if (a.hi <= 0)
+        return IntervalWiden (powHi, powLo, kIntervalLibmUlps);
+
+    // even power of interval with 0 inside
+    interval_t x = IntervalWiden (0, fmax (powLo, powHi), kIntervalLibmUlps);
+    x.lo = 0;
+
+    return x;
+}
+
+// a >= 0: t^y is monotone in t and in y, so extremes are in corners
+interval_t IntervalPowPositive (interval_t a, interval_t b)
+{
+    assert (a.lo >= 0);
+
+    double p1 = pow (a.lo, b.lo);
+    double p2 = pow (a.lo, b.hi);
+    double p3 = pow (a.hi, b.lo);
+    double p4 = pow (a.hi, b.hi);
+
+    interval_t x = IntervalWiden (fmin (fmin (p1, p2), fmin (p3, p4)),
+                                  fmax (fmax (p1, p2), fmax (p3, p4)), kIntervalLibmUlps);
+
+    // 0 ^ negative is a pole
+    x.undefined = (a.lo <= 0 && b.lo < 0);
+
+    if (x.lo < 0)
+        x.lo = 0;
+
+    return x;
+}
+
+// ============= FUNCTIONS =============
+
+interval_t IntervalLn (interval_t x)
+{
+    if (IntervalIsEmpty (x) || x.hi <= 0)
+        return IntervalEmpty ();
+
+    bool undefined = x.undefined || x.lo <= 0;
+
+    interval_t y = IntervalWiden (log (x.lo), log (x.hi), kIntervalLibmUlps);
+
+    if (x.lo <= 0)
+        y.lo = -INFINITY;
+
+    y.undefined = undefined;
+
+    return y;
+}
+
+interval_t IntervalSin (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    interval_t y = IntervalMake (-1, 1);
+    y.undefined  = x.undefined;
+
+    if (fabs (x.lo) > kIntervalPeriodicMax || fabs (x.hi) > kIntervalPeriodicMax ||
+        x.hi - x.lo >= 2 * M_PI)
+        return y;
+
+    double sinLo = sin (x.lo);
+    double sinHi = sin (x.hi);
+
+    interval_t s = IntervalWiden (fmin (sinLo, sinHi), fmax (sinLo, sinHi), kIntervalLibmUlps);
+
+    if (!IntervalHasPeriodPoint (x,  M_PI / 2, 2 * M_PI)) y.hi = fmin (s.hi, 1);
+    if (!IntervalHasPeriodPoint (x, -M_PI / 2, 2 * M_PI)) y.lo = fmax (s.lo, -1);
+
+    return y;
+}
+
+interval_t IntervalCos (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    interval_t y = IntervalMake (-1, 1);
+    y.undefined  = x.undefined;
+
+    if (fabs (x.lo) > kIntervalPeriodicMax || fabs (x.hi) > kIntervalPeriodicMax ||
+        x.hi - x.lo >= 2 * M_PI)
+        return y;
+
+    double cosLo = cos (x.lo);
+    double cosHi = cos (x.hi);
+
+    interval_t c = IntervalWiden (fmin (cosLo, cosHi), fmax (cosLo, cosHi), kIntervalLibmUlps);
+
+    if (!IntervalHasPeriodPoint (x, 0,    2 * M_PI)) y.hi = fmin (c.hi, 1);
+    if (!IntervalHasPeriodPoint (x, M_PI, 2 * M_PI)) y.lo = fmax (c.lo, -1);
+
+    return y;
+}
+
+// poles in pi/2 + k pi, increasing between them
+interval_t IntervalTg (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    if (fabs (x.lo) > kIntervalPeriodicMax || fabs (x.hi) > kIntervalPeriodicMax ||
+        x.hi - x.lo >= M_PI || IntervalHasPeriodPoint (x, M_PI / 2, M_PI))
+    {
+        interval_t y = IntervalMake (-INFINITY, INFINITY);
+        y.undefined  = true;
+
+        return y;
+    }
+
+    interval_t y = IntervalWiden (tan (x.lo), tan (x.hi), kIntervalLibmUlps);
+    y.undefined  = x.undefined;
+
+    return y;
+}
+
+// 1 / tan: poles in k pi, decreasing between them (also through pi/2, where it is 0)
+interval_t IntervalCtg (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    if (fabs (x.lo) > kIntervalPeriodicMax || fabs (x.hi) > kIntervalPeriodicMax ||
+        x.hi - x.lo >= M_PI || IntervalHasPeriodPoint (x, 0, M_PI))
+    {
+        interval_t y = IntervalMake (-INFINITY, INFINITY);
+        y.undefined  = true;
+
+        return y;
+    }
+
+    interval_t y = IntervalWiden (1 / tan (x.hi), 1 / tan (x.lo), kIntervalLibmUlps);
+    y.undefined  = x.undefined;
+
+    return y;
+}
+
+interval_t IntervalArcsin (interval_t x)
+{
+    if (IntervalIsEmpty (x) || x.lo > 1 || x.hi < -1)
+        return IntervalEmpty ();
+
+    interval_t y = IntervalWiden (asin (fmax (x.lo, -1)), asin (fmin (x.hi, 1)), kIntervalLibmUlps);
+    y.undefined  = x.undefined || x.lo < -1 || x.hi > 1;
+
+    return y;
+}
+
+interval_t IntervalArccos (interval_t x)
+{
+    if (IntervalIsEmpty (x) || x.lo > 1 || x.hi < -1)
+        return IntervalEmpty ();
+
+    interval_t y = IntervalWiden (acos (fmin (x.hi, 1)), acos (fmax (x.lo, -1)), kIntervalLibmUlps);
+    y.undefined  = x.undefined || x.lo < -1 || x.hi > 1;
+
+    return y;
+}
+
+interval_t IntervalArctg (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    interval_t y = IntervalWiden (atan (x.lo), atan (x.hi), kIntervalLibmUlps);
+    y.undefined  = x.undefined;
+
+    return y;
+}
+
+interval_t IntervalSh (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    interval_t y = IntervalWiden (sinh (x.lo), sinh (x.hi), kIntervalLibmUlps);
+    y.undefined  = x.undefined;
+
+    return y;
+}
+
+// even, minimum 1 in 0
+interval_t IntervalCh (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    double coshLo = cosh (x.lo);
+    double coshHi = cosh (x.hi);
+
+    interval_t y = {};
+
+    if (x.lo <= 0 && x.hi >= 0)
+        y = IntervalWiden (1, fmax (coshLo, coshHi), kIntervalLibmUlps);
+    else
+        y = IntervalWiden (fmin (coshLo, coshHi), fmax (coshLo, coshHi), kIntervalLibmUlps);
+
+    y.lo        = fmax (y.lo, 1);
+    y.undefined = x.undefined;
+
+    return y;
+}
+
+interval_t IntervalTh (interval_t x)
+{
+    if (IntervalIsEmpty (x))
+        return IntervalEmpty ();
+
+    interval_t y = IntervalWiden (tanh (x.lo), tanh (x.hi), kIntervalLibmUlps);
+
+    y.lo        = fmax (y.lo, -1);
+    y.hi        = fmin (y.hi,  1);
+    y.undefined = x.undefined;
+
+    return y;
+}
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_latex_share.h"
+
+#include "tree.h"
+
+static size_t LatexShareCount   (const node_t *node);
+static size_t LatexShareIntern  (latexShare_t *share, node_t *node, size_t depth);
+static size_t LatexShareAdd     (latexShare_t *share, node_t *node,
+                                 size_t left, size_t right);
+static void LatexShareMapNode   (latexShare_t *share, const node_t *node, size_t entry);
+static void LatexShareCountUses (latexShare_t *share, size_t root);
+static uint64_t HashMix         (uint64_t x);
+static uint64_t NodeValueBits   (const node_t *node);
+
+int LatexShareCtor (latexShare_t *share, node_t *root)
+{
+    assert (share);
+    assert (root);
+
+    *share = {};
+
+    size_t nodesCnt = LatexShareCount (root);
+
+    // tables are at most half full, so probes are short
+    size_t capacity = 16;
+    while (capacity < 2 * nodesCnt)
+        capacity *= 2;
+
+    share->nodes        = (latexShareNode_t *)  calloc (capacity, sizeof (latexShareNode_t));
+    share->entries      = (latexShareEntry_t *) calloc (nodesCnt, sizeof (latexShareEntry_t));
+    share->entriesTable = (size_t *)            calloc (capacity, sizeof (size_t));
+    share->pending      = (size_t *)            calloc (nodesCnt, sizeof (size_t));
+
+    if (share->nodes == NULL || share->entries == NULL ||
+        share->entriesTable == NULL || share->pending == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for latex subexpressions - %s", strerror (errno));
+
+        LatexShareDtor (share);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    share->nodesCapacity   = capacity;
+    share->entriesCapacity = capacity;
+
+    size_t rootEntry = LatexShareIntern (share, root, 1);
+
+    LatexShareCountUses (share, rootEntry - 1);
+
+    return TREE_OK;
+}
+
+void LatexShareDtor (latexShare_t *share)
+{
+    assert (share);
+
+    free (share->nodes);
+    free (share->entries);
+    free (share->entriesTable);
+    free (share->pending);
+
+    *share = {};
+}
+
+const latexShareEntry_t *LatexShareFind (latexShare_t *share, const node_t *node)
+{
+    assert (share);
+    assert (node);
+
+    if (node == share->defining)
+        return NULL;
+
+    size_t mask = share->nodesCapacity - 1;
+    size_t slot = HashMix ((uintptr_t) node) & mask;
+
+    while (share->nodes[slot].node != NULL && share->nodes[slot].node != node)
+        slot = (slot + 1) & mask;
+
+    // node was created after LatexShareCtor()
+    if (share->nodes[slot].node == NULL)
+        return NULL;
+
+    latexShareEntry_t *entry = &share->entries[share->nodes[slot].entry];
+
+    if (!LatexShareIsNamed (entry))
+        return NULL;
+
+    if (entry->name == 0)
+    {
+        entry->name = ++share->namesCnt;
+
+        share->pending[share->pendingCnt++] = share->nodes[slot].entry;
+    }
+
+    return entry;
+}
+
+void LatexShareNameText (const latexShareEntry_t *entry, char *buffer, size_t bufferLen)
+{
+    assert (entry);
+    assert (buffer);
+    assert (entry->name > 0);
+
+    const size_t kLettersCnt = 26;
+
+    size_t letter = (entry->name - 1) % kLettersCnt;
+    size_t round  = (entry->name - 1) / kLettersCnt;
+
+    if (round == 0)
+        snprintf (buffer, bufferLen, "\\mathcal{%c}", (char) ('A' + letter));
+    else
+        snprintf (buffer, bufferLen, "\\mathcal{%c}_{%lu}", (char) ('A' + letter), round + 1);
+}
+
+bool LatexShareIsNamed (const latexShareEntry_t *entry)
+{
+    assert (entry);
+
+    return entry->count >= 2 && entry->size >= kLatexShareMinSize;
+}
+
+size_t LatexShareCount (const node_t *node)
+{
+    if (node == NULL)
+        return 0;
+
+    return 1 + LatexShareCount (node->left) + LatexShareCount (node->right);
+}
+
+// returns entry of node + 1
+size_t LatexShareIntern (latexShare_t *share, node_t *node, size_t depth)
+{
+    assert (share);
+
+    if (node == NULL)
+        return 0;
+
+    if (depth > share->depth)
+        share->depth = depth;
+
+    share->nodesCnt++;
+
+    switch (node->type)
+    {
+        case TYPE_CONST_NUM:        share->numbersCnt++;    break;
+        case TYPE_VARIABLE:         share->variablesCnt++;  break;
+        case TYPE_MATH_OPERATION:   share->operationsCnt++; break;
+        case TYPE_UKNOWN:
+        default:                                            break;
+    }
+
+    size_t left  = LatexShareIntern (share, node->left,  depth + 1);
+    size_t right = LatexShareIntern (share, node->right, depth + 1);
+
+    size_t entry = LatexShareAdd (share, node, left, right);
+
+    LatexShareMapNode (share, node, entry);
+
+    return entry + 1;
+}
+
+// children are already interned, so equal subtrees have equal children entries
+size_t LatexShareAdd (latexShare_t *share, node_t *node, size_t left, size_t right)
+{
+    assert (share);
+    assert (node);
+
+    uint64_t hash = HashMix ((uint64_t) node->type ^ NodeValueBits (node));
+    hash = HashMix (hash ^ (left  == 0 ? 0 : share->entries[left  - 1].hash));
+    hash = HashMix (hash ^ (right == 0 ? 0 : share->entries[right - 1].hash) * 31);
+
+    size_t mask = share->entriesCapacity - 1;
+    size_t slot = hash & mask;
+
+    while (share->entriesTable[slot] != 0)
+    {
+        latexShareEntry_t *entry = &share->entries[share->entriesTable[slot] - 1];
+
+        if (entry->hash == hash && entry->node->type == node->type &&
+            NodeValueBits (entry->node) == NodeValueBits (node) &&
+            entry->left == left && entry->right == right)
+            return share->entriesTable[slot] - 1;
+
+        slot = (slot + 1) & mask;
+    }
+
+    size_t idx = share->entriesCnt++;
+
+    latexShareEntry_t *entry = &share->entries[idx];
+
+    entry->node  = node;
+    entry->hash  = hash;
+    entry->left  = left;
+    entry->right = right;
+    entry->size  = 1 + (left  == 0 ? 0 : share->entries[left  - 1].size)
+                     + (right == 0 ? 0 : share->entries[right - 1].size);
+
+    share->entriesTable[slot] = idx + 1;
+
+    return idx;
+}
+
+void LatexShareMapNode (latexShare_t *share, const node_t *node, size_t entry)
+{
+    assert (share);
+    assert (node);
+
+    size_t mask = share->nodesCapacity - 1;
+    size_t slot = HashMix ((uintptr_t) node) & mask;
+
+    // the same node can be met twice, if trees share nodes
+    while (share->nodes[slot].node != NULL && share->nodes[slot].node != node)
+        slot = (slot + 1) & mask;
+
+    share->nodes[slot].node  = node;
+    share->nodes[slot].entry = entry;
+}
+
+// subexpression inside named one is printed only once, in the definition,
+// so occurrences are counted from the root down. Children are interned
+// before parents, so all parents of entry are after it.
+void LatexShareCountUses (latexShare_t *share, size_t root)
+{
+    assert (share);
+    assert (root < share->entriesCnt);
+
+    share->entries[root].count = 1;
+
+    for (size_t i = root + 1; i-- > 0; )
+    {
+        latexShareEntry_t *entry = &share->entries[i];
+
+        if (entry->count == 0)
+            continue;
+
+        size_t childUses = LatexShareIsNamed (entry) ? 1 : entry->count;
+
+        if (entry->left  != 0) share->entries[entry->left  - 1].count += childUses;
+        if (entry->right != 0) share->entries[entry->right - 1].count += childUses;
+    }
+}
+
+// splitmix64 finalizer
+uint64_t HashMix (uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    return x;
+}
+
+// numbers by their bits, so -0.0 and 0.0 are printed as they are
+uint64_t NodeValueBits (const node_t *node)
+{
+    assert (node);
+
+    if (node->type == TYPE_CONST_NUM)
+    {
+        uint64_t bits = 0;
+        memcpy (&bits, &node->value.number, sizeof (bits));
+
+        return bits;
+    }
+
+    return node->value.idx;
+}
@@ -10,6 +10,7 @@
 #include "tree.h"
 #include "tree_calc.h"
 #include "utils.h"
+#include "tree_profile.h"
 
 // if we believe https://en.wikipedia.org/wiki/Parsing_expression_grammar,
 // ? means optional
@@ -62,6 +63,8 @@ Variable    ::= ['a'-'z', 'A'-'Z', '_']['a'-'z', 'A'-'Z', '0'-'9', '_']*
             return TREE_ERROR_SYNTAX_IN_SAVE_FILE;                      \
         }
         
+static int TreeLoadInfixFromBuffer (differentiator_t *diff, tree_t *tree, char *buffer);
+
 static int GetGramma            (differentiator_t *diff, char **curPos, 
                                  tree_t *tree, node_t **node);
 static int GetExpression        (differentiator_t *diff, char **curPos, 
@@ -100,15 +103,55 @@ int TreeLoadInfixFromFile (differentiator_t *diff, tree_t *tree,
     }
     
     *buffer = ReadFile (fileName, bufferLen);
-    if (buffer == NULL)
+    if (*buffer == NULL)
         return TREE_ERROR_COMMON |
                COMMON_ERROR_READING_FILE;
 
-    char *curPos = *buffer;
-    
-    // int status = GetGramma (diff, &tree->root, *buffer, &curPos);
+    return TreeLoadInfixFromBuffer (diff, tree, *buffer);
+}
+
+// str is copied to *buffer, because variable names point into it
+int TreeLoadInfixFromString (differentiator_t *diff, tree_t *tree,
+                             const char *str, char **buffer)
+{
+    assert (diff);
+    assert (tree);
+    assert (str);
+    assert (buffer);
+
+    if (tree->root != NULL)
+    {
+        ERROR_LOG ("%s", "TREE_ERROR_LOAD_INTO_NOT_EMPTY");
+        
+        return TREE_ERROR_LOAD_INTO_NOT_EMPTY;
+    }
+
+    *buffer = strdup (str);
+    if (*buffer == NULL)
+    {
+        ERROR_LOG ("%s", "Error allocating memory for expression buffer");
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    return TreeLoadInfixFromBuffer (diff, tree, *buffer);
+}
+
+int TreeLoadInfixFromBuffer (differentiator_t *diff, tree_t *tree, char *buffer)
+{
+    assert (diff);
+    assert (tree);
+    assert (buffer);
+
+    char *curPos = buffer;
+
+    uint64_t start = PROFILE_START ();
+
     int status = GetGramma (diff, &curPos, tree, &tree->root);
 
+    PROFILE_STOP (PROFILE_STAGE_PARSE, start);
+
     if (status != TREE_OK)
     {
         ERROR_LOG ("%s", "Error in GetGramma()");
@@ -4,16 +4,21 @@
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <errno.h>
+#include <pthread.h>
 
 #include "tree_log.h"
 
 #include "tree.h"
 #include "tree_calc.h"
 #include "tree_plot.h"
+#include "tree_latex_share.h"
+#include "tree_profile.h"
+#include "tree_taylor.h"
+#include "tree_pade.h"
+#include "tree_extrema.h"
 #include "utils.h"
 
-static size_t imageCounter = 0;
-
 const char * const kBlack       = "#000000";
 const char * const kGray        = "#ebebe0";
 
@@ -29,21 +34,77 @@ const char * const kHeadColor   = kViolet;
 const char * const kFreeColor   = kDarkGreen;
 const char * const kEdgeNormal  = kBlack;
 
-static void TreePrefixPass     (differentiator_t *diff, node_t *node, FILE *graphFile);
+static void TreePrefixPass     (differentiator_t *diff, node_t *node, textBuffer_t *graph);
+static bool DumpIsSampled      (treeLog_t *log, bool isTree);
 static int TreeDumpImg         (differentiator_t *diff, node_t *node);
 static int DumpMakeConfig      (differentiator_t *diff, node_t *node);
-static int DumpMakeImg         (node_t *node, treeLog_t *log);
+static int DumpMakeImg         (treeLog_t *log);
+static int DumpWriteDots       (treeLog_t *log);
+static int DumpRenderDots      (treeLog_t *log);
 static int NodeMathOpDiverativeLatex (differentiator_t *diff, node_t *node, variable_t *argument);
+static int LogReadPlotDataFormat     (treeLog_t *log);
+static void LatexCompileFormats (void);
+static int DumpLatexStep        (differentiator_t *diff, node_t *expression, variable_t *argument);
+static int DumpLatexBounded     (differentiator_t *diff, node_t *node);
+static int DumpLatexDefinitions (differentiator_t *diff, latexShare_t *share);
+static void DumpLatexSummary    (differentiator_t *diff, latexShare_t *share);
+
+// latexFormat of keyword split once into text pieces and children,
+// so dumping a node doesn't scan format string with strchr()
+struct latexSegment_t
+{
+    const char *text    = NULL;
+    size_t len          = 0;
+    char child          = 0; // 'l', 'r' or 0 - after the last piece
+};
+
+const size_t kLatexSegmentsMax = 4;
+
+struct latexFormat_t
+{
+    latexSegment_t segments[kLatexSegmentsMax] = {};
+    size_t segmentsCnt = 0;
+};
+
+static latexFormat_t latexFormats[kNumberOfKeywords] = {};
+static pthread_once_t latexFormatsOnce = PTHREAD_ONCE_INIT;
 
 int LogCtor (treeLog_t *log)
 {
+    assert (log);
+
+    return LogCtorWithSuffix (log, "");
+}
+
+int LogCtorWithSuffix (treeLog_t *log, const char *suffix)
+{
+    assert (log);
+    assert (suffix);
+
     time_t t = time (NULL);
-    struct tm tm = *localtime (&t);
+    struct tm tm = {};
+    localtime_r (&t, &tm);
+
+    log->imageCounter       = 0;
+    log->dotSources         = {};
+    log->dotBegins          = NULL;
+    log->dotBeginsCapacity  = 0;
+    log->dumpCalls          = 0;
+    log->gnuplot        = {};
+    log->processes      = {};
+    log->randSeed       = (unsigned int) t;
+
+    int status = snprintf (log->logFolderPath, kLogFolderPathLen, "%s%d-%02d-%02d_%02d:%02d:%02d%s/",
+                           kParentDumpFolderName,
+                           tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                           tm.tm_hour,        tm.tm_min,     tm.tm_sec, suffix);
+    if (status < 0 || (size_t) status >= kLogFolderPathLen)
+    {
+        ERROR_LOG ("Log folder name with suffix \"%s\" is too long", suffix);
 
-    snprintf (log->logFolderPath, kFileNameLen, "%s%d-%02d-%02d_%02d:%02d:%02d/",
-              kParentDumpFolderName,
-              tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
-              tm.tm_hour,        tm.tm_min,     tm.tm_sec);
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_SNPRINTF;
+    }
 
     snprintf (log->latexFilePath,       kFileNameLen, "%s%s",
               log->logFolderPath,       kLatexFileName);
@@ -63,6 +124,8 @@ int LogCtor (treeLog_t *log)
     snprintf (log->plotFolderPath,      kFileNameLen, "%s%s",
               log->logFolderPath,       kPlotFolderName);
 
+    TREE_DO_AND_RETURN (LogReadPlotDataFormat (log));
+
     if (SafeMkdir (kParentDumpFolderName) != TREE_OK)
         return TREE_ERROR_COMMON | 
                COMMON_ERROR_CREATING_FILE;
@@ -93,39 +156,110 @@ int LogCtor (treeLog_t *log)
     }
     fprintf (log->htmlFile, "%s", "<pre>\n");
 
-    log->latexFile = fopen (log->latexFilePath, "w");
-    if (log->latexFile == NULL)
+    // the whole latex is written by one write() in LogDtor()
+    log->latex = (textBuffer_t *) calloc (1, sizeof (textBuffer_t));
+    if (log->latex == NULL || TextBufferCtor (log->latex, kTextBufferStartCapacity) != COMMON_ERROR_OK)
     {
-        ERROR_LOG ("Error opening file \"%s\"", log->latexFilePath);
-        
+        ERROR_LOG ("Error allocating memory for latex of \"%s\"", log->latexFilePath);
+
+        free (log->latex);
+        log->latex = NULL;
+
         return TREE_ERROR_COMMON |
-               COMMON_ERROR_OPENING_FILE;
+               COMMON_ERROR_ALLOCATING_MEMORY;
     }
-    fprintf (log->latexFile, "%s",  kLatexHeader);
+    TextBufferPuts (log->latex, kLatexHeader);
 
     return TREE_OK;
 }
 
 void LogDtor (treeLog_t *log)
 {
+    assert (log);
+
+    if (log->htmlFile == NULL || log->latex == NULL)
+        return;
+
     fprintf (log->htmlFile, "%s", "</pre>\n");
 
-    fprintf (log->latexFile, "%s", "\\end{document}\n");
+    TextBufferPuts (log->latex, "\\end{document}\n");
 
     fclose (log->htmlFile);
-    fclose (log->latexFile);
 
-    const size_t commandSize = kFileNameLen + 64;
+    uint64_t start = PROFILE_START ();
+
+    if (TextBufferWriteFile (log->latex, log->latexFilePath) != COMMON_ERROR_OK)
+        ERROR_PRINT ("Latex is not written to \"%s\"", log->latexFilePath);
+
+    PROFILE_STOP  (PROFILE_STAGE_LATEX_WRITE, start);
+    PROFILE_COUNT (PROFILE_BYTES_WRITTEN, log->latex->size);
+
+    TextBufferDtor (log->latex);
+    free (log->latex);
+
+    log->htmlFile  = NULL;
+    log->latex     = NULL;
+
+    start = PROFILE_START ();
+
+    DumpRenderDots (log);
+
+    PROFILE_STOP (PROFILE_STAGE_DOT, start);
+
+    TextBufferDtor (&log->dotSources);
+    free (log->dotBegins);
+
+    log->dotBegins          = NULL;
+    log->dotBeginsCapacity  = 0;
+
+    start = PROFILE_START ();
+
+    // pngs of plots must be ready before pdflatex
+    if (ProcessWait (&log->gnuplot) != COMMON_ERROR_OK)
+        ERROR_PRINT ("%s", "gnuplot finished with error");
 
-    char command[commandSize] = {};
+    PROFILE_STOP (PROFILE_STAGE_WAIT_GNUPLOT, start);
 
-    snprintf (command, commandSize, "pdflatex -interaction=batchmode "
-                                     ON_RELEASE ("> /dev/null ") 
-                                     "%s", log->latexFilePath);
+    start = PROFILE_START ();
 
-    DEBUG_VAR ("%s", command);
+    // solve.pdf, .aux and .log go into folder of the report, not into cwd shared by all reports
+    const size_t outputArgLen = kLogFolderPathLen + 32;
+    char outputArg[outputArgLen] = {};
+    snprintf (outputArg, outputArgLen, "-output-directory=%s", log->logFolderPath);
 
-    system (command);
+    const char * const pdflatexArgv[] = {"pdflatex", "-interaction=batchmode", outputArg,
+                                         log->latexFilePath, NULL};
+
+    ProcessManagerRun (&log->processes, pdflatexArgv, PROCESS_DEFAULT ON_RELEASE (| PROCESS_QUIET));
+
+    // dot and pdflatex run at the same time
+    if (ProcessManagerWaitAll (&log->processes) != COMMON_ERROR_OK)
+        ERROR_PRINT ("%s", "dot or pdflatex finished with error");
+
+    PROFILE_STOP (PROFILE_STAGE_PDFLATEX, start);
+
+    ProcessManagerDtor (&log->processes);
+}
+
+int LogReadPlotDataFormat (treeLog_t *log)
+{
+    assert (log);
+
+    const char *format = getenv (kPlotDataEnvName);
+    if (format == NULL)
+        return TREE_OK;
+
+    if      (strcmp (format, "text")   == 0) log->plotDataFormat = PLOT_DATA_TEXT;
+    else if (strcmp (format, "binary") == 0) log->plotDataFormat = PLOT_DATA_BINARY;
+    else if (strcmp (format, "pipe")   == 0) log->plotDataFormat = PLOT_DATA_PIPE;
+    else
+    {
+        ERROR_PRINT ("%s should be text, binary or pipe, not \"%s\"", kPlotDataEnvName, format);
+
+        return TREE_ERROR_WRONG_ARGUMENT;
+    }
+
+    return TREE_OK;
 }
 
 int NodeDump (differentiator_t *diff, node_t *node,
@@ -138,10 +272,13 @@ int NodeDump (differentiator_t *diff, node_t *node,
     assert (func);
     assert (format);
 
-    DEBUG_PRINT ("%s", "\n========== NODE DUMP START ==========\n");
-
     treeLog_t *log = &diff->log;
 
+    if (log->htmlFile == NULL || !DumpIsSampled (log, false))
+        return TREE_OK;
+
+    DEBUG_PRINT ("%s", "\n========== NODE DUMP START ==========\n");
+
     fprintf (log->htmlFile,
              "<h3>NODE DUMP called at %s:%d:%s(): <font style=\"color: green;\">",
              file, line, func);
@@ -176,9 +313,12 @@ int TreeDump (differentiator_t *diff, tree_t *tree,
     assert (file);
     assert (func);
 
-    DEBUG_PRINT ("%s", "\n========== START OF TREE DUMP TO HTML  ==========\n");
-
     treeLog_t *log = &diff->log;
+
+    if (log->htmlFile == NULL || !DumpIsSampled (log, true))
+        return TREE_OK;
+
+    DEBUG_PRINT ("%s", "\n========== START OF TREE DUMP TO HTML  ==========\n");
     
     fprintf (log->htmlFile,
              "<h3>TREE DUMP called at %s:%d:%s(): <font style=\"color: green;\">",
@@ -211,6 +351,19 @@ int TreeDump (differentiator_t *diff, tree_t *tree,
     return TREE_OK;
 }
 
+// only every dumpEvery-th of dumps is kept
+bool DumpIsSampled (treeLog_t *log, bool isTree)
+{
+    assert (log);
+
+    if (!isTree && log->dumpTreesOnly)
+        return false;
+
+    log->dumpCalls++;
+
+    return log->dumpEvery <= 1 || (log->dumpCalls - 1) % log->dumpEvery == 0;
+}
+
 int TreeDumpImg (differentiator_t *diff, node_t *node)
 {
     assert (diff);
@@ -218,21 +371,21 @@ int TreeDumpImg (differentiator_t *diff, node_t *node)
 
     TREE_DO_AND_RETURN (DumpMakeConfig (diff, node));
 
-    TREE_DO_AND_RETURN (DumpMakeImg (node, &diff->log));
+    TREE_DO_AND_RETURN (DumpMakeImg (&diff->log));
 
     return TREE_OK;
 }
 
 
-void TreePrefixPass (differentiator_t *diff, node_t *node, FILE *graphFile)
+void TreePrefixPass (differentiator_t *diff, node_t *node, textBuffer_t *graph)
 {
     assert (diff);
     assert (node);
-    assert (graphFile);
+    assert (graph);
 
-    fprintf (graphFile,
-             "\tnode%p [shape=Mrecord; style=\"filled\"; fillcolor=",
-             node);
+    TextBufferPrintf (graph,
+                      "\tnode%p [shape=Mrecord; style=\"filled\"; fillcolor=",
+                      node);
 
     DEBUG_VAR ("%lu", node->value.idx);
 
@@ -240,31 +393,31 @@ void TreePrefixPass (differentiator_t *diff, node_t *node, FILE *graphFile)
 
     switch (node->type)
     {
-        case TYPE_UKNOWN:           fprintf (graphFile, "\"%s\";", kGray);      break;
-        case TYPE_CONST_NUM:        fprintf (graphFile, "\"%s\";", kBlue);      break;
+        case TYPE_UKNOWN:           TextBufferPrintf (graph, "\"%s\";", kGray);      break;
+        case TYPE_CONST_NUM:        TextBufferPrintf (graph, "\"%s\";", kBlue);      break;
         case TYPE_MATH_OPERATION:   if (keyword->isFunction)
-                                        fprintf (graphFile, "\"%s\";", kYellow);
+                                        TextBufferPrintf (graph, "\"%s\";", kYellow);
                                     else
-                                        fprintf (graphFile, "\"%s\"", kGreen);  
+                                        TextBufferPrintf (graph, "\"%s\"", kGreen);  
                                     break;
-        case TYPE_VARIABLE:         fprintf (graphFile, "\"%s\";", kViolet);    break;
-        default:                    fprintf (graphFile, "\"%s\";", kRed);      break;
+        case TYPE_VARIABLE:         TextBufferPrintf (graph, "\"%s\";", kViolet);    break;
+        default:                    TextBufferPrintf (graph, "\"%s\";", kRed);       break;
     }
 
     variable_t *var = FindVariableByIdx (diff, (size_t) node->value.idx);
 
-    fprintf (graphFile, " label = \" {");
+    TextBufferPuts (graph, " label = \" {");
 
     switch (node->type)
     {
-        case TYPE_UKNOWN:           fprintf (graphFile, "%g", node->value.number);          break;
-        case TYPE_CONST_NUM:        fprintf (graphFile, "%g", node->value.number);          break;
-        case TYPE_MATH_OPERATION:   fprintf (graphFile, "%s", keyword->name);               break;
-        case TYPE_VARIABLE:         fprintf (graphFile, "%.*s", (int)var->len, var->name);  break;
-        default:                    fprintf (graphFile, "error");                           break;
+        case TYPE_UKNOWN:
+        case TYPE_CONST_NUM:        TextBufferDouble (graph, node->value.number, diff->log.numberFormat);   break;
+        case TYPE_MATH_OPERATION:   TextBufferPuts   (graph, keyword->name);                                break;
+        case TYPE_VARIABLE:         TextBufferAppend (graph, var->name, var->len);                          break;
+        default:                    TextBufferPuts   (graph, "error");                                      break;
     }
 
-    fprintf (graphFile, " }\"];\n");
+    TextBufferPuts (graph, " }\"];\n");
 
     DEBUG_PTR (node);
     // DEBUG_LOG ("\t node->left: %p", node->left);
@@ -274,90 +427,186 @@ void TreePrefixPass (differentiator_t *diff, node_t *node, FILE *graphFile)
     {
         DEBUG_LOG ("\t %p->%p\n", node, node->left);
 
-        fprintf (graphFile, "\tnode%p->node%p\n", node, node->left);
+        TextBufferPrintf (graph, "\tnode%p->node%p\n", node, node->left);
         
-        TreePrefixPass (diff, node->left, graphFile);
+        TreePrefixPass (diff, node->left, graph);
     }    
 
     if (node->right != NULL)
     {
         DEBUG_LOG ("\t %p->%p\n", node, node->left);
 
-        fprintf (graphFile, "\tnode%p->node%p\n", node, node->right);
+        TextBufferPrintf (graph, "\tnode%p->node%p\n", node, node->right);
         
-        TreePrefixPass (diff, node->right, graphFile);
+        TreePrefixPass (diff, node->right, graph);
     }
 }
 
+// graph goes to memory, files are written at the end by DumpWriteDots()
 int DumpMakeConfig (differentiator_t *diff, node_t *node)
 {
     assert (diff);
     assert (node);
 
-    imageCounter++;
+    treeLog_t *log = &diff->log;
+
+    if (log->imageCounter == log->dotBeginsCapacity)
+    {
+        size_t newCapacity = (log->dotBeginsCapacity == 0) ? 64 : log->dotBeginsCapacity * 2;
+
+        size_t *newBegins = (size_t *) realloc (log->dotBegins, newCapacity * sizeof (size_t));
+        if (newBegins == NULL)
+        {
+            ERROR_LOG ("Error reallocating memory for dumps - %s", strerror (errno));
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_REALLOCATING_MEMORY;
+        }
+
+        log->dotBegins         = newBegins;
+        log->dotBeginsCapacity = newCapacity;
+    }
+
+    log->dotBegins[log->imageCounter] = log->dotSources.size;
+    log->imageCounter++;
+
+    TextBufferPuts (&log->dotSources,   "digraph G {\n"
+                                        // "\tsplines=ortho;\n"
+                                        // "\tnodesep=0.5;\n"
+                                        "\tnode [shape=octagon; style=\"filled\"; fillcolor=\"#ff8080\"];\n");
+
+    TreePrefixPass (diff, node, &log->dotSources);
 
-    char graphFilePath[kFileNameLen + 22] = {};
-    snprintf (graphFilePath, kFileNameLen + 22, "%s%lu.dot", diff->log.dotFolderPath, imageCounter);
+    TextBufferPuts (&log->dotSources, "}");
 
-    DEBUG_VAR ("%s", graphFilePath);
+    return TREE_OK;
+}
 
-    FILE *graphFile  = fopen (graphFilePath, "w");
-    if (graphFile == NULL)
+// png is rendered in LogDtor() with all other dumps
+int DumpMakeImg (treeLog_t *log)
+{
+    assert (log);
+
+    fprintf (log->htmlFile,
+             "<img src=\"%s%lu.dot.png\" hieght=\"500px\">\n",
+             kDotFolderName, log->imageCounter);
+
+    return TREE_OK;
+}
+
+int DumpWriteDots (treeLog_t *log)
+{
+    assert (log);
+
+    if (log->dotSources.failed)
     {
-        ERROR_LOG ("Error opening file \"%s\"", graphFilePath);
+        ERROR_LOG ("%s", "Dumps are incomplete, there was an allocation error");
 
         return TREE_ERROR_COMMON |
-               COMMON_ERROR_OPENING_FILE;
+               COMMON_ERROR_ALLOCATING_MEMORY;
     }
 
-    fprintf (graphFile  ,   "digraph G {\n"
-                            // "\tsplines=ortho;\n"
-                            // "\tnodesep=0.5;\n"
-                            "\tnode [shape=octagon; style=\"filled\"; fillcolor=\"#ff8080\"];\n");
+    const size_t kPathLen = kFileNameLen + 22;
+
+    for (size_t i = 0; i < log->imageCounter; i++)
+    {
+        size_t begin = log->dotBegins[i];
+        size_t end   = (i + 1 < log->imageCounter) ? log->dotBegins[i + 1] : log->dotSources.size;
+
+        char path[kPathLen] = {};
+
+        int len = snprintf (path, kPathLen, "%s%lu.dot", log->dotFolderPath, i + 1);
+        if (len < 0 || (size_t) len >= kPathLen)
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_SNPRINTF;
+
+        FILE *graphFile = fopen (path, "w");
+        if (graphFile == NULL)
+        {
+            ERROR_LOG ("Error opening file \"%s\"", path);
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_OPENING_FILE;
+        }
 
-    TreePrefixPass (diff, node, graphFile);
+        fwrite (log->dotSources.data + begin, sizeof (char), end - begin, graphFile);
+        fclose (graphFile);
+    }
 
-    fprintf (graphFile, "%s", "}");
-    fclose  (graphFile);
+    PROFILE_COUNT (PROFILE_BYTES_WRITTEN, log->dotSources.size);
 
     return TREE_OK;
 }
-int DumpMakeImg (node_t *node, treeLog_t *log)
+
+// "dot -Tpng -O a.dot b.dot ..." writes a.dot.png, b.dot.png ...,
+// all dumps are split between kProcessesMaxRunning dot processes
+int DumpRenderDots (treeLog_t *log)
 {
-    assert (node);
     assert (log);
 
-    char imgFileName[kFileNameLen] = {};
-    snprintf (imgFileName, kFileNameLen, "%lu.png", imageCounter);
+    size_t dumpsCnt = log->imageCounter;
+    if (dumpsCnt == 0)
+        return TREE_OK;
 
-    const size_t kMaxCommandLen = 256;
-    char command[kMaxCommandLen] = {};
+    TREE_DO_AND_RETURN (DumpWriteDots (log));
 
-    snprintf (command, kMaxCommandLen, "dot %s%lu.dot -T png -o %s%s", 
-              log->dotFolderPath, imageCounter,
-              log->imgFolderPath, imgFileName);
+    const size_t kPathLen   = kFileNameLen + 22;
+    const size_t kFirstPath = 3;
 
-    int status = system (command);
-    DEBUG_VAR ("%d", status);
-    if (status != 0)
+    size_t batchSize = (dumpsCnt + kProcessesMaxRunning - 1) / kProcessesMaxRunning;
+
+    const char **argv = (const char **) calloc (kFirstPath + batchSize + 1, sizeof (char *));
+    char *paths       = (char *)        calloc (batchSize, kPathLen);
+
+    if (argv == NULL || paths == NULL)
     {
-        ERROR_LOG ("ERROR executing command \"%s\"", command);
-        
+        ERROR_LOG ("Error allocating memory for dot command - %s", strerror (errno));
+
+        free (argv);
+        free (paths);
+
         return TREE_ERROR_COMMON |
-               COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
+               COMMON_ERROR_ALLOCATING_MEMORY;
     }
 
-    fprintf (log->htmlFile,
-             "<img src=\"img/%s\" hieght=\"500px\">\n",
-             imgFileName);
+    argv[0] = "dot";
+    argv[1] = "-Tpng";
+    argv[2] = "-O";
+
+    int status = COMMON_ERROR_OK;
+
+    for (size_t first = 0; first < dumpsCnt; first += batchSize)
+    {
+        size_t cnt = (dumpsCnt - first < batchSize) ? dumpsCnt - first : batchSize;
+
+        for (size_t i = 0; i < cnt; i++)
+        {
+            char *path = paths + i * kPathLen;
+            snprintf (path, kPathLen, "%s%lu.dot", log->dotFolderPath, first + i + 1);
+
+            argv[kFirstPath + i] = path;
+        }
 
-    DEBUG_VAR ("%s", command);
+        argv[kFirstPath + cnt] = NULL;
+
+        // argv is copied by posix_spawnp(), so paths can be reused
+        status |= ProcessManagerRun (&log->processes, argv, PROCESS_DEFAULT);
+    }
+
+    free (argv);
+    free (paths);
+
+    if (status != COMMON_ERROR_OK)
+        return TREE_ERROR_COMMON |
+               status;
 
     return TREE_OK;
 }
 
 // =============== LATEX ===============
 
+// step is dropped if it's too big or there were too many steps already,
+// NodeDiff() calls it for every node, so otherwise latex grows as square of tree
 int DumpLatexDifferentation (differentiator_t *diff, node_t *expression, 
                              variable_t *argument)
 {
@@ -365,7 +614,46 @@ int DumpLatexDifferentation (differentiator_t *diff, node_t *expression,
     assert (expression);
     assert (argument);
 
-    FILE *latexFile = diff->log.latexFile;
+    treeLog_t *log = &diff->log;
+    if (log->latex == NULL)
+        return TREE_OK;
+
+    log->latexStepsCnt++;
+
+    if (log->latexStepsCnt > kLatexStepsLimit)
+    {
+        log->latexStepsSkipped++;
+
+        return TREE_OK;
+    }
+
+    size_t mark = log->latex->size;
+
+    log->latexNodesLeft = (log->latexNodeLimit == 0) ? SIZE_MAX : log->latexNodeLimit;
+    log->latexNodesOver = false;
+
+    int status = DumpLatexStep (diff, expression, argument);
+
+    if (log->latexNodesOver)
+    {
+        TextBufferTruncate (log->latex, mark);
+
+        log->latexStepsSkipped++;
+    }
+
+    log->latexNodesLeft = SIZE_MAX;
+    log->latexNodesOver = false;
+
+    return status;
+}
+
+int DumpLatexStep (differentiator_t *diff, node_t *expression, variable_t *argument)
+{
+    assert (diff);
+    assert (expression);
+    assert (argument);
+
+    textBuffer_t *latex = diff->log.latex;
 
     // https://ctan.math.utah.edu/ctan/tex-archive/macros/latex/contrib/autobreak/autobreak.pdf
     // awesome package
@@ -383,12 +671,12 @@ int DumpLatexDifferentation (differentiator_t *diff, node_t *expression,
         "Чтобы сыграть психически больного и глубоко депрессивного человека в фильме Джокер, Хоакин Феникс решил это:",
     };
 
-    fprintf (latexFile, "%s\\\\\n"
+    TextBufferPrintf (latex, "%s\\\\\n"
                         "\\begin{align*}\n"
                         "\\begin{autobreak}\n"
                         "\\MoveEqLeft\n"
                         "\t\\frac{d}{d%.*s}(",
-                        funny[rand() % 9],
+                        funny[rand_r (&diff->log.randSeed) % 9],
                         (int) argument->len,
                         argument->name);
 
@@ -397,7 +685,7 @@ int DumpLatexDifferentation (differentiator_t *diff, node_t *expression,
         return status;
 
 
-    fprintf (latexFile, ") = \n"
+    TextBufferPuts   (latex, ") = \n"
                         "\t");
 
     // status = DumpLatexNode (diff, resultNode, NULL);
@@ -412,14 +700,14 @@ int DumpLatexDifferentation (differentiator_t *diff, node_t *expression,
             return TREE_ERROR_INVALID_NODE;
 
         case TYPE_CONST_NUM:
-            fprintf (latexFile, "0");
+            TextBufferPuts (latex, "0");
             break;
         
         case TYPE_VARIABLE:
             if (expression->value.idx == argument->idx)
-                fprintf (latexFile, "1");
+                TextBufferPuts (latex, "1");
             else
-                fprintf (latexFile, "0");
+                TextBufferPuts (latex, "0");
             break;
 
         case TYPE_MATH_OPERATION:
@@ -435,7 +723,7 @@ int DumpLatexDifferentation (differentiator_t *diff, node_t *expression,
 
     // status |= DumpLatexNode (diff, result, NULL);
 
-    fprintf (latexFile, "\n"
+    TextBufferPuts   (latex, "\n"
                         "\\end{autobreak}\n"
                         "\\end{align*}\n");
 
@@ -446,14 +734,18 @@ int DumpLatexDifferentation (differentiator_t *diff, node_t *expression,
 // overall this looks like copy paste
 
 #define dL                                                                              \
-        fprintf (latexFile, "\\frac{d}{d%.*s}(", (int) argument->len, argument->name);  \
+        TextBufferPuts   (latex, "\\frac{d}{d");                                          \
+        TextBufferAppend (latex, argument->name, argument->len);                        \
+        TextBufferPuts   (latex, "}(");                                                 \
         DumpLatexNode (diff, node->left, node);                                         \
-        fprintf (latexFile, ")")
+        TextBufferPutc   (latex, ')')
 
 #define dR                                                                              \
-        fprintf (latexFile, "\\frac{d}{d%.*s}(", (int) argument->len, argument->name);  \
+        TextBufferPuts   (latex, "\\frac{d}{d");                                          \
+        TextBufferAppend (latex, argument->name, argument->len);                        \
+        TextBufferPuts   (latex, "}(");                                                 \
         DumpLatexNode (diff, node->right, node);                                        \
-        fprintf (latexFile, ")")
+        TextBufferPutc   (latex, ')')
 
 #define cL                                      \
         DumpLatexNode (diff, node->left, node)
@@ -465,10 +757,10 @@ int DumpLatexDifferentation (differentiator_t *diff, node_t *expression,
         DumpLatexNode (diff, node, node)
 
 #define FILE_PRINT(str)                 \
-        fprintf (latexFile, "%s", str)
+        TextBufferPuts (latex, str)
 
 #define NUM_(num)                       \
-        fprintf (latexFile, "%g", num)
+        TextBufferDouble (latex, num, diff->log.numberFormat)
 
 #define ADD_(left, right)               \
         left;                           \
@@ -542,7 +834,7 @@ int NodeMathOpDiverativeLatex (differentiator_t *diff, node_t *node, variable_t
 
     DEBUG_PTR (node);
 
-    FILE *latexFile = diff->log.latexFile;
+    textBuffer_t *latex = diff->log.latex;
 
     switch (node->value.idx)
     {
@@ -606,6 +898,7 @@ int NodeMathOpDiverativeLatex (differentiator_t *diff, node_t *node, variable_t
             }
             
             assert (0 && "Uknown case of OP_POW");
+            break;
         }
 
         case OP_LOG:
@@ -729,26 +1022,28 @@ int DumpLatexFunction (differentiator_t *diff, node_t *node)
     assert (diff);
     assert (node);
 
-    FILE *latexFile = diff->log.latexFile;
+    textBuffer_t *latex = diff->log.latex;
+    if (latex == NULL)
+        return TREE_OK;
 
-    fprintf (latexFile, "%s", "\\section*{Давайте пересчитаем кости этой каверзной функции}\n");
+    TextBufferPuts (latex, "\\section*{Давайте пересчитаем кости этой каверзной функции}\n");
 
-    fprintf (latexFile, "\\[\n"
+    TextBufferPrintf (latex, "\\[\n"
                         "\t f(%.*s",
                         (int) diff->variables[0].len,
                         diff->variables[0].name);
     
     for (size_t i = 1; i < diff->variablesSize; i++)
     {
-        fprintf (latexFile, ", %.*s",
+        TextBufferPrintf (latex, ", %.*s",
                            (int) diff->variables[i].len,
                            diff->variables[i].name);
     }
-    fprintf (latexFile, "%s", ") = ");
+    TextBufferPuts (latex, ") = ");
 
     int status = DumpLatexNode (diff, node, NULL);
 
-    fprintf (latexFile, "\n\\]\n\n");
+    TextBufferPuts (latex, "\n\\]\n\n");
 
     return status;
 }
@@ -760,10 +1055,40 @@ int DumpLatexAnswer (differentiator_t *diff, node_t *node, size_t devirativeCoun
     assert (node);
 
     treeLog_t *log = &diff->log;
+    if (log->latex == NULL)
+        return TREE_OK;
+
+    if (log->latexStepsSkipped > 0)
+        TextBufferPrintf (log->latex, "Остальные шаги (%lu) настолько очевидны, что мы их опустим.\n\n",
+                          log->latexStepsSkipped);
+
+    log->latexStepsCnt     = 0;
+    log->latexStepsSkipped = 0;
 
-    fprintf (log->latexFile, "\\subsection*{Ответ для %lu производной:}\n", devirativeCount);
+    TextBufferPrintf (log->latex, "\\subsection*{Ответ для %lu производной:}\n", devirativeCount);
 
-    fprintf (log->latexFile,// "\\[\n"
+    return DumpLatexBounded (diff, node);
+}
+
+// repeated subexpressions are printed once as names, tree which is still
+// too big is replaced by its summary, so size of latex doesn't depend on tree
+int DumpLatexBounded (differentiator_t *diff, node_t *node)
+{
+    assert (diff);
+    assert (node);
+
+    treeLog_t *log = &diff->log;
+    size_t mark = log->latex->size;
+
+    // without names it's still needed for summary
+    latexShare_t share = {};
+    bool hasShare = (LatexShareCtor (&share, node) == TREE_OK);
+
+    log->latexNames     = (hasShare && log->latexShare) ? &share : NULL;
+    log->latexNodesLeft = (log->latexNodeLimit == 0) ? SIZE_MAX : log->latexNodeLimit;
+    log->latexNodesOver = false;
+
+    TextBufferPuts   (log->latex,// "\\[\n"
                             //  "\t\\boxed {\n"
                              "\\begin{align*}\n"
                              "\\begin{autobreak}\n"
@@ -771,100 +1096,215 @@ int DumpLatexAnswer (differentiator_t *diff, node_t *node, size_t devirativeCoun
 
     int status = DumpLatexNode (diff, node, NULL);
 
-    fprintf (log->latexFile, "\n"
+    TextBufferPuts   (log->latex, "\n"
                              "\\end{autobreak}\n"
                              "\\end{align*}\n");
 
+    if (status == TREE_OK && log->latexNames != NULL)
+        status = DumpLatexDefinitions (diff, &share);
+
+    if (log->latexNodesOver)
+    {
+        TextBufferTruncate (log->latex, mark);
+
+        DumpLatexSummary (diff, hasShare ? &share : NULL);
+    }
+
+    log->latexNames     = NULL;
+    log->latexNodesLeft = SIZE_MAX;
+    log->latexNodesOver = false;
+
+    if (hasShare)
+        LatexShareDtor (&share);
+
+    return status;
+}
+
+// definitions can name other subexpressions, they are added to the end of pending
+int DumpLatexDefinitions (differentiator_t *diff, latexShare_t *share)
+{
+    assert (diff);
+    assert (share);
+
+    textBuffer_t *latex = diff->log.latex;
+
+    if (share->pendingCnt > 0)
+        TextBufferPuts (latex, "где\n");
+
+    int status = TREE_OK;
+
+    for (size_t i = 0; i < share->pendingCnt && !diff->log.latexNodesOver; i++)
+    {
+        const latexShareEntry_t *entry = &share->entries[share->pending[i]];
+
+        char name[kFileNameLen] = {};
+        LatexShareNameText (entry, name, kFileNameLen);
+
+        TextBufferPrintf (latex, "\\begin{align*}\n"
+                                 "\\begin{autobreak}\n"
+                                 "\t%s = ", name);
+
+        share->defining = entry->node;
+        status |= DumpLatexNode (diff, entry->node, NULL);
+        share->defining = NULL;
+
+        TextBufferPuts   (latex, "\n"
+                                 "\\end{autobreak}\n"
+                                 "\\end{align*}\n");
+    }
+
     return status;
 }
 
+void DumpLatexSummary (differentiator_t *diff, latexShare_t *share)
+{
+    assert (diff);
+
+    textBuffer_t *latex = diff->log.latex;
+
+    TextBufferPrintf (latex, "Выражение не поместится ни на одну страницу "
+                             "(ограничение %lu узлов), поэтому приведём только его описание:\n",
+                      diff->log.latexNodeLimit);
+
+    if (share == NULL)
+        return;
+
+    TextBufferPrintf (latex, "\\begin{itemize}\n"
+                             "\t\\item узлов: %lu, различных подвыражений: %lu\n"
+                             "\t\\item глубина: %lu\n"
+                             "\t\\item операций: %lu, переменных: %lu, чисел: %lu\n"
+                             "\\end{itemize}\n",
+                      share->nodesCnt, share->entriesCnt,
+                      share->depth,
+                      share->operationsCnt, share->variablesCnt, share->numbersCnt);
+}
 
-#define NUM_(num)                                                                       \
-        NodeCtorAndFill (&diff->taylor, TYPE_CONST_NUM, {.number = num}, NULL, NULL)
-#define ADD_(left, right)                                                               \
-        NodeCtorAndFill (&diff->taylor, TYPE_MATH_OPERATION, {.idx = OP_ADD}, left, right)
-#define SUB_(left, right)                                                               \
-        NodeCtorAndFill (&diff->taylor, TYPE_MATH_OPERATION, {.idx = OP_SUB}, left, right)
-#define MUL_(left, right)                                                               \
-        NodeCtorAndFill (&diff->taylor, TYPE_MATH_OPERATION, {.idx = OP_MUL}, left, right)
-#define DIV_(left, right)                                                               \
-        NodeCtorAndFill (&diff->taylor, TYPE_MATH_OPERATION, {.idx = OP_DIV}, left, right)
-#define POW_(left, right)                                                               \
-        NodeCtorAndFill (&diff->taylor, TYPE_MATH_OPERATION, {.idx = OP_POW}, left, right)
-#define VAR_(idxVar)                                                                    \
-        NodeCtorAndFill (&diff->taylor, TYPE_VARIABLE, {.idx = idxVar}, NULL, NULL)
 
 int DumpLatexTaylor (differentiator_t *diff)
 {
     assert (diff);
 
-    // tree_t *tree = &diff->taylor; // FIXME: use tree in all macros
-    TREE_CTOR (&diff->taylor, &diff->log);
+    // tree is built even without log, only LaTeX output is skipped
+    TREE_DO_AND_RETURN (TaylorBuild (diff));
+
+    textBuffer_t *latex = diff->log.latex;
+    if (latex == NULL)
+        return TREE_OK;
 
-    FILE *latexFile = diff->log.latexFile;
+    const double *coefs = diff->taylorCoefs;
 
-    fprintf (latexFile, "\\section*{Разложение по Тейлору} \\\n");
+    TextBufferPuts (latex, "\\section*{Разложение по Тейлору} \\\n");
 
-    fprintf (latexFile, "\\begin{align*}\n"
+    TextBufferPuts   (latex, "\\begin{align*}\n"
                         "\\begin{autobreak}\n"
                         "\t");
 
-    double value = NodeCalculate (diff, diff->expression.root);
-
-    fprintf (latexFile, "f (%.*s) = %g \n\t", 
+    TextBufferPrintf (latex, "f (%.*s) = ", 
                         (int) diff->varToDiff->len,
-                        diff->varToDiff->name,
-                        value);
+                        diff->varToDiff->name);
+    TextBufferDouble (latex, coefs[0], diff->log.numberFormat);
+    TextBufferPuts   (latex, " \n\t");
 
-    diff->taylor.root = NUM_ (value);
-    
-    size_t factorial = 1;
+    double factorial = 1;
 
-    for (size_t i = 0; i < diff->diffTreesCnt; i++)
+    for (size_t i = 1; i < diff->taylorCoefsCnt; i++)
     {
-        value = NodeCalculate (diff, diff->diffTrees[i].root);
-        factorial *= (i + 1);
-
-        fprintf (latexFile, 
-                 "+ \\frac{%g}{%lu!} \\cdot (%.*s - %g) ^ %lu\n\t",
-                 value,
-                 i + 1, 
-                 (int)diff->varToDiff->len, diff->varToDiff->name,
-                 diff->varToDiff->value,
-                 i + 1);
-
-        diff->taylor.root = ADD_ (diff->taylor.root, 
-                                  MUL_ (DIV_ (NUM_(value), 
-                                              NUM_ ((double)factorial)
-                                             ),
-                                        POW_ (SUB_ (VAR_(diff->varToDiff->idx),
-                                                   NUM_(diff->varToDiff->value)
-                                                   ),
-                                              NUM_ ((double)i + 1)
-                                              )
-                                       )
-                                 );
+        factorial *= (double) i;
+
+        TextBufferPuts   (latex, "+ \\frac{");
+        TextBufferDouble (latex, coefs[i] * factorial, diff->log.numberFormat);
+        TextBufferPrintf (latex, "}{%lu!} \\cdot (%.*s - ",
+                                 i, 
+                                 (int)diff->varToDiff->len, diff->varToDiff->name);
+        TextBufferDouble (latex, diff->taylorCenter, diff->log.numberFormat);
+        TextBufferPrintf (latex, ") ^ %lu\n\t", i);
     }
 
-    fprintf (latexFile, "+ o(%.*s - %g) ^ %lu", 
-                        (int) diff->varToDiff->len, diff->varToDiff->name,
-                        diff->varToDiff->value,
-                        diff->diffTreesCnt);
+    TextBufferPrintf (latex, "+ o(%.*s - ", 
+                        (int) diff->varToDiff->len, diff->varToDiff->name);
+    TextBufferDouble (latex, diff->taylorCenter, diff->log.numberFormat);
+    TextBufferPrintf (latex, ") ^ %lu", diff->diffTreesCnt);
     
-    fprintf (latexFile, "\n"
+    TextBufferPuts   (latex, "\n"
                         "\\end{autobreak}\n"
                         "\\end{align*}\n");
 
     return TREE_OK;
 }
 
-#undef NUM_
-#undef POW_
-#undef ADD_
-#undef SUB_
-#undef MUL_
-#undef DIV_
-#undef VAR_
+int DumpLatexPade (differentiator_t *diff, const pade_t *pade)
+{
+    assert (diff);
+    assert (pade);
+    assert (diff->varToDiff);
+
+    textBuffer_t *latex = diff->log.latex;
+    if (latex == NULL)
+        return TREE_OK;
+
+    tree_t tree = {};
+    TREE_DO_AND_RETURN (TREE_CTOR (&tree, &diff->log));
+    tree.arena = diff->arena;
+
+    tree.root = PadeBuildTree (pade, &tree, diff->varToDiff->idx);
+    if (tree.root == NULL)
+    {
+        TreeDtor (&tree);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    TextBufferPrintf (latex, "\\section*{Аппроксимация Паде [%lu/%lu]}\n",
+                      pade->numCnt - 1, pade->denCnt - 1);
+
+    int status = DumpLatexBounded (diff, tree.root);
+
+    TreeDtor (&tree);
+
+    return status;
+}
+
+int DumpLatexExtrema (differentiator_t *diff, const extrema_t *extrema)
+{
+    assert (diff);
+    assert (extrema);
+    assert (diff->varToDiff);
+
+    textBuffer_t *latex = diff->log.latex;
+    if (latex == NULL)
+        return TREE_OK;
+
+    TextBufferPuts (latex, "\\section*{Экстремумы и точки перегиба}\n");
+
+    if (extrema->pointsCnt == 0)
+    {
+        TextBufferPrintf (latex, "На отрезке $[%d, %d]$ их нет.\n", kLeftRange, kRightRange);
+
+        return TREE_OK;
+    }
+
+    TextBufferPuts (latex, "\\begin{itemize}\n");
+
+    for (size_t i = 0; i < extrema->pointsCnt; i++)
+    {
+        const extremum_t *point = &extrema->points[i];
+
+        const char *name = (point->type == EXTREMUM_MIN) ? "минимум" :
+                           (point->type == EXTREMUM_MAX) ? "максимум" : "перегиб";
+
+        TextBufferPrintf (latex, "\t\\item %s: $%.*s = ", name,
+                          (int) diff->varToDiff->len, diff->varToDiff->name);
+        TextBufferDouble (latex, point->x, diff->log.numberFormat);
+        TextBufferPuts   (latex, ", f = ");
+        TextBufferDouble (latex, point->y, diff->log.numberFormat);
+        TextBufferPuts   (latex, "$\n");
+    }
+
+    TextBufferPuts (latex, "\\end{itemize}\n");
+
+    return TREE_OK;
+}
 
 int DumpLatexNode (differentiator_t *diff, node_t *node, node_t *parent) 
 {
@@ -873,7 +1313,32 @@ int DumpLatexNode (differentiator_t *diff, node_t *node, node_t *parent)
 
     treeLog_t *log = &diff->log;
 
-    fputc (' ', log->latexFile);
+    // checked before decrement, so tree of exactly latexNodeLimit nodes is printed in full
+    if (log->latexNodesLeft == 0)
+    {
+        log->latexNodesOver = true;
+
+        return TREE_OK;
+    }
+
+    log->latexNodesLeft--;
+
+    if (log->latexNames != NULL)
+    {
+        const latexShareEntry_t *entry = LatexShareFind (log->latexNames, node);
+
+        if (entry != NULL)
+        {
+            char name[kFileNameLen] = {};
+            LatexShareNameText (entry, name, kFileNameLen);
+
+            TextBufferPrintf (log->latex, " %s ", name);
+
+            return TREE_OK;
+        }
+    }
+
+    TextBufferPutc (log->latex, ' ');
 
     switch (node->type)
     {
@@ -884,14 +1349,20 @@ int DumpLatexNode (differentiator_t *diff, node_t *node, node_t *parent)
 
         case TYPE_CONST_NUM:
             if (node->value.number < 0)
-                fprintf (log->latexFile, "(%g)", node->value.number);
+            {
+                TextBufferPutc   (log->latex, '(');
+                TextBufferDouble (log->latex, node->value.number, log->numberFormat);
+                TextBufferPutc   (log->latex, ')');
+            }
             else
-                fprintf (log->latexFile, "%g", node->value.number);
+            {
+                TextBufferDouble (log->latex, node->value.number, log->numberFormat);
+            }
             break;
         
         case TYPE_VARIABLE:
-            fprintf (log->latexFile, "%.*s", (int) diff->variables[node->value.idx].len,
-                                             diff->variables[node->value.idx].name);
+            TextBufferAppend (log->latex, diff->variables[node->value.idx].name,
+                                          diff->variables[node->value.idx].len);
             break;
 
         case TYPE_MATH_OPERATION:
@@ -902,7 +1373,7 @@ int DumpLatexNode (differentiator_t *diff, node_t *node, node_t *parent)
             break;
     }
 
-    fputc (' ', log->latexFile);
+    TextBufferPutc (log->latex, ' ');
 
     return TREE_OK;
 }
@@ -913,70 +1384,116 @@ int DumpLatexNodeMathOperation (differentiator_t *diff, node_t *node, node_t *pa
     assert (diff);
     assert (node);
 
-    FILE *latexFile = diff->log.latexFile;
+    textBuffer_t *latex = diff->log.latex;
 
-    const keyword_t *keyword = FindKeywordByIdx (node->value.idx);
-    if (keyword == NULL)
+    if (node->value.idx >= kNumberOfKeywords)
     {
         ERROR_LOG ("%s", "Uknown operation");
 
         return TREE_ERROR_INVALID_NODE;
     }
-    const char *latexFormat = keyword->latexFormat;
 
+    pthread_once (&latexFormatsOnce, LatexCompileFormats);
+
+    const latexFormat_t *format = &latexFormats[node->value.idx];
 
     bool requireBracket = false;
 
     if (parent == NULL) 
         requireBracket = false;
     else
-        requireBracket = ((keyword->idx == OP_ADD || keyword->idx == OP_SUB) && 
+        requireBracket = ((node->value.idx == OP_ADD || node->value.idx == OP_SUB) && 
                           (parent->value.idx == OP_MUL || parent->value.idx == OP_DIV)) ||
                          (parent->right == node && parent->value.idx == OP_SUB);
     
-    if (requireBracket) fprintf (latexFile, "(");
+    if (requireBracket) TextBufferPutc (latex, '(');
     
-    while (true)
+    for (size_t i = 0; i < format->segmentsCnt; i++)
     {
-        const char *specificator = strchr (latexFormat, '%');
-        const char *argument = specificator + 1;
-
-        DEBUG_STR (specificator);
-        DEBUG_STR (argument);
+        const latexSegment_t *segment = &format->segments[i];
 
-        fprintf (latexFile, "%.*s", int(specificator - latexFormat), latexFormat);
+        TextBufferAppend (latex, segment->text, segment->len);
 
-        if (*argument == 'l') DumpLatexNode (diff, node->left, node);
-        if (*argument == 'r') DumpLatexNode (diff, node->right, node);
-        if (*argument == 'e') break;
-
-        latexFormat = argument + 1;
+        if (segment->child == 'l') DumpLatexNode (diff, node->left,  node);
+        if (segment->child == 'r') DumpLatexNode (diff, node->right, node);
     }
 
-    if (requireBracket) fprintf (latexFile, ")");
+    if (requireBracket) TextBufferPutc (latex, ')');
 
     return TREE_OK;
 }
 
+// keywords are indexed by their idx, format is "text%ltext%rtext%e"
+void LatexCompileFormats (void)
+{
+    for (size_t i = 0; i < kNumberOfKeywords; i++)
+    {
+        latexFormat_t *format = &latexFormats[keywords[i].idx];
+        const char *text = keywords[i].latexFormat;
+
+        format->segmentsCnt = 0;
+
+        while (format->segmentsCnt < kLatexSegmentsMax)
+        {
+            const char *specificator = strchr (text, '%');
+            assert (specificator);
+
+            latexSegment_t *segment = &format->segments[format->segmentsCnt++];
+
+            segment->text  = text;
+            segment->len   = (size_t) (specificator - text);
+            segment->child = (specificator[1] == 'e') ? 0 : specificator[1];
+
+            if (segment->child == 0)
+                break;
+
+            text = specificator + 2;
+        }
+    }
+}
+
 int DumpLatexAddImages (differentiator_t *diff)
 {
     assert (diff);
 
-    FILE *latexFile = diff->log.latexFile;
+    if (diff->log.latex == NULL)
+        return TREE_OK;
+
+    plotSet_t plots = {};
 
-    fprintf (latexFile, "%s", "\\section*{Посмотрим теперь на интересные(или не очень) картиночки:} \\\\\n");
+    int status = TreeGeneratePlots (diff, &plots);
+
+    if (status == TREE_OK)
+        status = DumpLatexAddPlots (diff, &plots);
+
+    PlotSetDtor (&plots);
+
+    return status;
+}
+
+// renders already generated plots and includes them into latex
+int DumpLatexAddPlots (differentiator_t *diff, plotSet_t *plots)
+{
+    assert (diff);
+    assert (plots);
+
+    textBuffer_t *latex = diff->log.latex;
+    if (latex == NULL)
+        return TREE_OK;
 
     const char kImageLatex[] = "\\begin{center}\n"
                                "\t\\includegraphics[width=13cm]{%s%s.png}\n"
                                "\\end{center}\n\n";
 
-    TREE_DO_AND_RETURN (TreeCreatePlotImage (diff, &diff->expression, kExpressionFileName));
-    fprintf (latexFile, "%s", "\\subsection*{Исходная функция:} \n");
-    fprintf (latexFile, kImageLatex, diff->log.plotFolderPath, kExpressionFileName);
+    TREE_DO_AND_RETURN (TreeRenderPlots (diff, plots));
+
+    TextBufferPuts (latex, "\\section*{Посмотрим теперь на интересные(или не очень) картиночки:} \\\\\n");
 
-    TREE_DO_AND_RETURN (TreePlotFunctionAndTaylor (diff, kTaylorFileName));
-    fprintf (latexFile, "%s", "\\subsection*{Исходная функция вместе с графиком Тейлора:} \n");
-    fprintf (latexFile, kImageLatex, diff->log.plotFolderPath, kTaylorFileName);
+    TextBufferPuts (latex, "\\subsection*{Исходная функция:} \n");
+    TextBufferPrintf (latex, kImageLatex, diff->log.plotFolderPath, kExpressionFileName);
+
+    TextBufferPuts (latex, "\\subsection*{Исходная функция вместе с графиком Тейлора:} \n");
+    TextBufferPrintf (latex, kImageLatex, diff->log.plotFolderPath, kTaylorFileName);
 
     const size_t numMaxLen = 20;
     char number[numMaxLen] = {};
@@ -992,11 +1509,9 @@ int DumpLatexAddImages (differentiator_t *diff)
                    COMMON_ERROR_SNPRINTF;
         }
 
-        TreeCreatePlotImage (diff, &diff->diffTrees[i], number);
-        
-        fprintf (latexFile, "\\subsection*{График %s производной:} \n", number);
+        TextBufferPrintf (latex, "\\subsection*{График %s производной:} \n", number);
         
-        fprintf (latexFile, kImageLatex, diff->log.plotFolderPath, number);
+        TextBufferPrintf (latex, kImageLatex, diff->log.plotFolderPath, number);
     }
 
     return TREE_OK;
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_pade.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_taylor.h"
+
+// pivot smaller than this part of the biggest element of the system is zero
+const double kPadeSingularEps = 1e-13;
+
+static int  PadeSolveDenominator    (pade_t *pade, const double *coefs,
+                                     size_t numDegree, size_t denDegree);
+static double PadeCoef              (const double *coefs, size_t numDegree, size_t i, size_t j);
+
+int PadeCtor (pade_t *pade, const double *coefs, size_t coefsCnt, double center,
+              size_t numDegree, size_t denDegree)
+{
+    assert (pade);
+    assert (coefs);
+
+    *pade = {};
+
+    if (coefsCnt < numDegree + denDegree + 1)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    pade->numCnt = numDegree + 1;
+    pade->denCnt = denDegree + 1;
+    pade->center = center;
+
+    pade->num = (double *) calloc (pade->numCnt, sizeof (double));
+    pade->den = (double *) calloc (pade->denCnt, sizeof (double));
+
+    if (pade->num == NULL || pade->den == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for pade - %s", strerror (errno));
+
+        PadeDtor (pade);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    int status = PadeSolveDenominator (pade, coefs, numDegree, denDegree);
+    if (status != TREE_OK)
+    {
+        PadeDtor (pade);
+
+        return status;
+    }
+
+    // P = Q * c up to t^L
+    for (size_t k = 0; k <= numDegree; k++)
+    {
+        double sum = 0;
+
+        for (size_t j = 0; j <= k && j <= denDegree; j++)
+        {
+            sum = fma (pade->den[j], coefs[k - j], sum);
+        }
+
+        pade->num[k] = sum;
+    }
+
+    return TREE_OK;
+}
+
+void PadeDtor (pade_t *pade)
+{
+    assert (pade);
+
+    free (pade->num);
+    free (pade->den);
+
+    *pade = {};
+}
+
+// c[L + i - j] of Toeplitz system, rows and columns from 1, c[k < 0] = 0
+double PadeCoef (const double *coefs, size_t numDegree, size_t i, size_t j)
+{
+    assert (coefs);
+
+    if (numDegree + i < j)
+        return 0;
+
+    return coefs[numDegree + i - j];
+}
+
+// M is small (it's at most order of derivative), so Toeplitz system is solved
+// by Gauss with partial pivoting: Levinson recursion fails when leading minors
+// are singular, and they are for every even or odd function
+int PadeSolveDenominator (pade_t *pade, const double *coefs, size_t numDegree, size_t denDegree)
+{
+    assert (pade);
+    assert (coefs);
+
+    pade->den[0] = 1;
+
+    size_t m = denDegree;
+    if (m == 0)
+        return TREE_OK;
+
+    // m rows of m coefficients and right part
+    size_t width = m + 1;
+
+    double *system = (double *) calloc (m * width, sizeof (double));
+    if (system == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for pade system - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    double scale = 0;
+
+    for (size_t i = 0; i < m; i++)
+    {
+        for (size_t j = 0; j < m; j++)
+        {
+            system[i * width + j] = PadeCoef (coefs, numDegree, i + 1, j + 1);
+            scale = fmax (scale, fabs (system[i * width + j]));
+        }
+
+        system[i * width + m] = -coefs[numDegree + i + 1];
+    }
+
+    int status = TREE_OK;
+
+    for (size_t col = 0; col < m && status == TREE_OK; col++)
+    {
+        size_t pivot = col;
+
+        for (size_t i = col + 1; i < m; i++)
+        {
+            if (fabs (system[i * width + col]) > fabs (system[pivot * width + col]))
+                pivot = i;
+        }
+
+        // also catches NAN coefficients
+        if (!(fabs (system[pivot * width + col]) > kPadeSingularEps * scale))
+        {
+            status = TREE_ERROR_SINGULAR;
+
+            break;
+        }
+
+        if (pivot != col)
+        {
+            for (size_t j = col; j <= m; j++)
+            {
+                double tmp                  = system[col   * width + j];
+                system[col   * width + j]   = system[pivot * width + j];
+                system[pivot * width + j]   = tmp;
+            }
+        }
+
+        for (size_t i = col + 1; i < m; i++)
+        {
+            double factor = system[i * width + col] / system[col * width + col];
+
+            for (size_t j = col; j <= m; j++)
+            {
+                system[i * width + j] = fma (-factor, system[col * width + j], system[i * width + j]);
+            }
+        }
+    }
+
+    for (size_t i = m; i > 0 && status == TREE_OK; i--)
+    {
+        size_t row = i - 1;
+        double sum = system[row * width + m];
+
+        for (size_t j = row + 1; j < m; j++)
+        {
+            sum = fma (-system[row * width + j], pade->den[j + 1], sum);
+        }
+
+        pade->den[row + 1] = sum / system[row * width + row];
+    }
+
+    free (system);
+
+    return status;
+}
+
+double PadeEvaluate (const pade_t *pade, double x)
+{
+    assert (pade);
+
+    return TaylorEvaluate (pade->num, pade->numCnt, pade->center, x) /
+           TaylorEvaluate (pade->den, pade->denCnt, pade->center, x);
+}
+
+node_t *PadeBuildTree (const pade_t *pade, tree_t *tree, size_t varIdx)
+{
+    assert (pade);
+    assert (tree);
+
+    node_t *num = TaylorBuildTree (tree, pade->num, pade->numCnt, varIdx, pade->center);
+
+    if (pade->denCnt <= 1 || num == NULL)
+        return num;
+
+    node_t *den = TaylorBuildTree (tree, pade->den, pade->denCnt, varIdx, pade->center);
+    if (den == NULL)
+        return NULL;
+
+    return NodeCtorAndFill (tree, TYPE_MATH_OPERATION, {.idx = OP_DIV}, num, den);
+}
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_partial.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "thread_pool.h"
+#include "tree_profile.h"
+
+struct partialTask_t
+{
+    differentiator_t *view  = NULL;
+    node_t *source          = NULL;
+    tree_t *dest            = NULL;
+    variable_t *argument    = NULL;
+
+    int status              = TREE_OK;
+};
+
+static int  PartialsCtor        (partials_t *partials, treeLog_t *log,
+                                 size_t variablesCnt, bool withHessian);
+static int  PartialsRunTasks    (threadPool_t *pool, size_t workerIdx,
+                                 partialTask_t *tasks, size_t tasksCnt);
+static void PartialDiffTask     (void *arg, size_t workerIdx);
+
+int TreesPartialDiff (differentiator_t *diff, tree_t *expression,
+                      threadPool_t *pool, size_t workerIdx,
+                      bool withHessian, partials_t *partials)
+{
+    assert (diff);
+    assert (expression);
+    assert (expression->root);
+    assert (pool);
+    assert (partials);
+
+    size_t varsCnt = diff->variablesSize;
+
+    TREE_DO_AND_RETURN (PartialsCtor (partials, &diff->log, varsCnt, withHessian));
+
+    // upper triangle of hessian, gradient tasks go first
+    size_t tasksCnt = varsCnt + (withHessian ? varsCnt * (varsCnt + 1) / 2 : 0);
+
+    partialTask_t *tasks = (partialTask_t *) calloc (tasksCnt + 1, sizeof (partialTask_t));
+    if (tasks == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for partial derivatives tasks - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    differentiator_t view = {};
+    DifferentiatorCtorView (&view, diff);
+
+    for (size_t i = 0; i < varsCnt; i++)
+    {
+        tasks[i].view     = &view;
+        tasks[i].source   = expression->root;
+        tasks[i].dest     = &partials->gradient[i];
+        tasks[i].argument = &diff->variables[i];
+    }
+
+    int status = PartialsRunTasks (pool, workerIdx, tasks, varsCnt);
+
+    if (status == TREE_OK && withHessian)
+    {
+        partialTask_t *hessianTasks = tasks + varsCnt;
+        size_t taskIdx = 0;
+
+        for (size_t i = 0; i < varsCnt; i++)
+        {
+            for (size_t j = i; j < varsCnt; j++)
+            {
+                hessianTasks[taskIdx].view     = &view;
+                hessianTasks[taskIdx].source   = partials->gradient[i].root;
+                hessianTasks[taskIdx].dest     = PartialsHessian (partials, i, j);
+                hessianTasks[taskIdx].argument = &diff->variables[j];
+
+                taskIdx++;
+            }
+        }
+
+        status = PartialsRunTasks (pool, workerIdx, hessianTasks, taskIdx);
+    }
+
+    free (tasks);
+
+    return status;
+}
+
+int PartialsRunTasks (threadPool_t *pool, size_t workerIdx,
+                      partialTask_t *tasks, size_t tasksCnt)
+{
+    assert (pool);
+    assert (tasks);
+
+    taskGroup_t group = {};
+    int status = TREE_OK;
+
+    for (size_t i = 0; i < tasksCnt; i++)
+    {
+        int submitStatus = ThreadPoolSubmit (pool, workerIdx, &group, PartialDiffTask, &tasks[i]);
+
+        // submit fails only without memory for the task, then it is done by this thread
+        if (submitStatus != COMMON_ERROR_OK)
+            PartialDiffTask (&tasks[i], workerIdx);
+    }
+
+    ThreadPoolWait (pool, workerIdx, &group);
+
+    for (size_t i = 0; i < tasksCnt; i++)
+    {
+        status |= tasks[i].status;
+    }
+
+    return status;
+}
+
+void PartialDiffTask (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    (void) workerIdx;
+
+    partialTask_t *task = (partialTask_t *) arg;
+
+    uint64_t start = PROFILE_START ();
+
+    task->dest->root = NodeDiff (task->view, task->source, task->dest, task->argument);
+
+    PROFILE_STOP (PROFILE_STAGE_DIFF, start);
+    if (task->dest->root == NULL)
+    {
+        task->status = TREE_ERROR_NULL_ROOT;
+
+        return;
+    }
+
+    TreeSimplify (task->view, task->dest);
+}
+
+int PartialsCtor (partials_t *partials, treeLog_t *log,
+                  size_t variablesCnt, bool withHessian)
+{
+    assert (partials);
+    assert (log);
+
+    partials->variablesCnt = variablesCnt;
+    partials->hessian      = NULL;
+
+    partials->gradient = (tree_t *) calloc (variablesCnt + 1, sizeof (tree_t));
+    if (partials->gradient == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for gradient - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    for (size_t i = 0; i < variablesCnt; i++)
+    {
+        TREE_DO_AND_RETURN (TREE_CTOR (&partials->gradient[i], log));
+    }
+
+    if (!withHessian)
+        return TREE_OK;
+
+    partials->hessian = (tree_t *) calloc (variablesCnt * variablesCnt + 1, sizeof (tree_t));
+    if (partials->hessian == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for hessian - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    for (size_t i = 0; i < variablesCnt * variablesCnt; i++)
+    {
+        TREE_DO_AND_RETURN (TREE_CTOR (&partials->hessian[i], log));
+    }
+
+    return TREE_OK;
+}
+
+void PartialsDtor (partials_t *partials)
+{
+    assert (partials);
+
+    if (partials->gradient != NULL)
+    {
+        for (size_t i = 0; i < partials->variablesCnt; i++)
+        {
+            TreeDtor (&partials->gradient[i]);
+        }
+    }
+
+    if (partials->hessian != NULL)
+    {
+        for (size_t i = 0; i < partials->variablesCnt * partials->variablesCnt; i++)
+        {
+            TreeDtor (&partials->hessian[i]);
+        }
+    }
+
+    free (partials->gradient);
+    free (partials->hessian);
+
+    partials->gradient     = NULL;
+    partials->hessian      = NULL;
+    partials->variablesCnt = 0;
+}
+
+// hessian is symmetric, so only upper triangle is stored
+tree_t *PartialsHessian (partials_t *partials, size_t i, size_t j)
+{
+    assert (partials);
+    assert (partials->hessian);
+    assert (i < partials->variablesCnt);
+    assert (j < partials->variablesCnt);
+
+    if (i > j)
+    {
+        size_t tmp = i;
+        i = j;
+        j = tmp;
+    }
+
+    return &partials->hessian[i * partials->variablesCnt + j];
+}
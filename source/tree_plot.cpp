@@ -1,74 +1,288 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
 
 #include "tree_plot.h"
 
 #include "tree.h"
 #include "tree_calc.h"
+#include "thread_pool.h"
+#include "process_manager.h"
+#include "double_format.h"
+#include "tree_profile.h"
+#include "tree_taylor.h"
+#include "tree_chebyshev.h"
+#include "tree_codegen.h"
 
-static int PlotGenerateData             (differentiator_t *diff, tree_t *tree, 
-                                         const char *plotFilePath);
-static int RunGnuPlot                   (differentiator_t *diff, const char *plotFilePath, 
-                                         const char * fileNumber);
-static int RunGnuPlot2Functions         (differentiator_t *diff, const char *pngFileName, 
-                                         const char *firstData, const char *secondData);
+const size_t kPlotPathLen = kFileNameLen + 32;
 
-// NOTE: maybe snprintf macro
-// or move all of this to tree_log
-// int TreeCreatePlotImages (differentiator_t *diff)
-// {
-//     assert (diff);
+struct plotCurve_t
+{
+    tree_t *tree                    = NULL;
+    const char *name                = NULL;
+    // taylor is evaluated by its coefficients, not by tree
+    const double *coefs             = NULL;
+    size_t coefsCnt                 = 0;
+    double center                   = 0;
+    // with diff->log.plotChebyshevTolerance, empty if tree can't be approximated
+    chebyshev_t chebyshev           = {};
+    // with diff->log.plotCompiled, NULL if compilation failed
+    codegenFunc_t compiled          = NULL;
+    const double *variables         = NULL; // of compiled
+    plotDataFormat_t format         = PLOT_DATA_TEXT;
+    doubleFormat_t numberFormat     = {};   // only for PLOT_DATA_TEXT
+    char dataPath[kPlotPathLen]     = {};   // not used with PLOT_DATA_PIPE
+
+    // kPlotColumnPointsMax slots for every column, compacted before writing
+    double *x                       = NULL;
+    double *y                       = NULL;
+    size_t *columnSizes             = NULL;
+    size_t pointsCnt                = 0;
+    size_t evaluationsCnt           = 0;    // calls of PlotCalculate()
+
+    int status                      = TREE_OK;
+};
+
+struct plotChunk_t
+{
+    differentiator_t *diff  = NULL;
+    plotCurve_t *curve      = NULL;
+    size_t begin            = 0;    // columns
+    size_t end              = 0;
+    size_t evaluationsCnt   = 0;
+};
+
+// all samples of one pixel column in order of x, y = NAN is a break of line
+struct plotColumn_t
+{
+    differentiator_t *diff          = NULL;
+    node_t *root                    = NULL;
+    size_t varIdx                   = 0;
+    const double *coefs             = NULL; // not NULL - polynomial instead of root
+    size_t coefsCnt                 = 0;
+    double center                   = 0;
+    const chebyshev_t *chebyshev    = NULL; // not NULL - approximation instead of root
+    codegenFunc_t compiled          = NULL; // not NULL - native code instead of root
+    const double *variables         = NULL;
+
+    double x[kPlotPointsPerPixel]   = {};
+    double y[kPlotPointsPerPixel]   = {};
+    size_t size                     = 0;
+    size_t evaluationsCnt           = 0;
+};
+
+static int  PlotCurveCtor               (differentiator_t *diff, plotCurve_t *curve,
+                                         tree_t *tree, const char *name);
+static void PlotCurveDtor               (plotCurve_t *curve);
+static int  PlotGenerateCurves          (differentiator_t *diff,
+                                         plotCurve_t *curves, size_t curvesCnt);
+static int  PlotRunTasks                (differentiator_t *diff, plotCurve_t *curves, size_t curvesCnt,
+                                         threadPool_t *pool);
+static void PlotApproximateTask         (void *arg, size_t workerIdx);
+static void PlotChunkTask               (void *arg, size_t workerIdx);
+static void PlotSampleColumn            (plotColumn_t *column, double left, double right,
+                                         bool withLeft);
+static void PlotRefine                  (plotColumn_t *column, double xa, double ya,
+                                         double xb, double yb, size_t depth);
+static double PlotCalculate             (plotColumn_t *column, double x);
+static bool PlotNeedRefine              (double ya, double ym, double yb);
+static void PlotColumnAppend            (plotColumn_t *column, double x, double y);
+static size_t PlotColumnReduce          (plotColumn_t *column, double *x, double *y);
+static void PlotCompact                 (plotCurve_t *curve);
+static void PlotWriteTask               (void *arg, size_t workerIdx);
+static int  PlotWriteData               (plotCurve_t *curve);
+static void PlotWriteText               (FILE *file, plotCurve_t *curve);
+static void PlotWriteBinary             (FILE *file, plotCurve_t *curve);
+static void PlotWriteScript             (FILE *file, const char *pngFilePath,
+                                         plotCurve_t *curves, size_t curvesCnt);
+static int  RunGnuPlot                  (differentiator_t *diff, const char *pngFileName,
+                                         plotCurve_t *curves, size_t curvesCnt);
+static int  RunGnuPlotSession           (treeLog_t *log, const char *pngFilePath,
+                                         plotCurve_t *curves, size_t curvesCnt);
+
+int TreeCreatePlotImages (differentiator_t *diff)
+{
+    assert (diff);
 
-//     TREE_DO_AND_RETURN (TreePlotFunctionAndTaylor (diff));
+    plotSet_t plots = {};
 
-//     for (size_t i = 0; i < diff->diffTreesCnt; i++)
-//     {
-//         TREE_DO_AND_RETURN (TreeCreatePlotImage (diff, &diff->diffTrees[i], i));
-//     }
+    int status = TreeGeneratePlots (diff, &plots);
 
-//     return TREE_OK;
-// }
+    if (status == TREE_OK)
+        status = TreeRenderPlots (diff, &plots);
 
-int TreeCreatePlotImage (differentiator_t *diff, tree_t *tree, const char *fileName)
+    PlotSetDtor (&plots);
+
+    return status;
+}
+
+int TreeGeneratePlots (differentiator_t *diff, plotSet_t *plots)
 {
     assert (diff);
-    assert (tree);
+    assert (plots);
 
-    const size_t kPathMaxLen = kFileNameLen + 32;
+    const size_t numMaxLen = 24;
 
-    char plotPath[kPathMaxLen]   = {};
-    
-    int status = snprintf (plotPath, kPathMaxLen, "%s%s.txt", 
-                           diff->log.plotFolderPath, fileName);
-    if (status < 0)
+    uint64_t start = PROFILE_START ();
+
+    plots->curvesCnt = 2 + diff->diffTreesCnt;
+    plots->curves    = (plotCurve_t *) calloc (plots->curvesCnt, sizeof (plotCurve_t));
+    plots->numbers   = (char *)        calloc (diff->diffTreesCnt + 1, numMaxLen);
+
+    if (plots->curves == NULL || plots->numbers == NULL)
     {
-        ERROR_LOG ("Error in snprintf(), return code = %d", status);
+        ERROR_LOG ("Error allocating memory for plots - %s", strerror (errno));
 
         return TREE_ERROR_COMMON |
-               COMMON_ERROR_SNPRINTF;
+               COMMON_ERROR_ALLOCATING_MEMORY;
     }
 
-    TREE_DO_AND_RETURN (PlotGenerateData (diff, tree, plotPath));
+    plotCurve_t *curves = plots->curves;
+
+    int status = PlotCurveCtor (diff, &curves[0], &diff->expression, kExpressionFileName);
+    status    |= PlotCurveCtor (diff, &curves[1], &diff->taylor,     kTaylorFileName);
+
+    for (size_t i = 0; i < diff->diffTreesCnt && status == TREE_OK; i++)
+    {
+        char *number = plots->numbers + i * numMaxLen;
+        snprintf (number, numMaxLen, "%lu", i + 1);
+
+        status = PlotCurveCtor (diff, &curves[2 + i], &diff->diffTrees[i], number);
+    }
 
-    TREE_DO_AND_RETURN (RunGnuPlot (diff, plotPath, fileName));
+    if (status == TREE_OK)
+        status = PlotGenerateCurves (diff, curves, plots->curvesCnt);
+
+    for (size_t i = 0; i < plots->curvesCnt; i++)
+    {
+        plots->pointsCnt      += curves[i].pointsCnt;
+        plots->evaluationsCnt += curves[i].evaluationsCnt;
+    }
+
+    PROFILE_STOP  (PROFILE_STAGE_PLOT_DATA, start);
+    PROFILE_COUNT (PROFILE_EVALUATIONS, plots->evaluationsCnt);
+
+    return status;
+}
+
+// expression, expression with taylor, every derivative
+int TreeRenderPlots (differentiator_t *diff, plotSet_t *plots)
+{
+    assert (diff);
+    assert (plots);
+    assert (plots->curves);
+
+    plotCurve_t *curves = plots->curves;
+
+    TREE_DO_AND_RETURN (RunGnuPlot (diff, kExpressionFileName, &curves[0], 1));
+    TREE_DO_AND_RETURN (RunGnuPlot (diff, kTaylorFileName,     &curves[0], 2));
+
+    for (size_t i = 2; i < plots->curvesCnt; i++)
+    {
+        TREE_DO_AND_RETURN (RunGnuPlot (diff, curves[i].name, &curves[i], 1));
+    }
 
     return TREE_OK;
 }
 
+void PlotSetDtor (plotSet_t *plots)
+{
+    assert (plots);
+
+    if (plots->curves != NULL)
+    {
+        for (size_t i = 0; i < plots->curvesCnt; i++)
+        {
+            PlotCurveDtor (&plots->curves[i]);
+        }
+    }
+
+    free (plots->curves);
+    free (plots->numbers);
+
+    plots->curves         = NULL;
+    plots->numbers        = NULL;
+    plots->curvesCnt      = 0;
+    plots->pointsCnt      = 0;
+    plots->evaluationsCnt = 0;
+}
+
+int TreeCreatePlotImage (differentiator_t *diff, tree_t *tree, const char *fileName)
+{
+    assert (diff);
+    assert (tree);
+    assert (fileName);
+
+    plotCurve_t curve = {};
+
+    int status = PlotCurveCtor (diff, &curve, tree, fileName);
+
+    if (status == TREE_OK)
+        status = PlotGenerateCurves (diff, &curve, 1);
+
+    if (status == TREE_OK)
+        status = RunGnuPlot (diff, fileName, &curve, 1);
+
+    PlotCurveDtor (&curve);
+
+    return status;
+}
+
 
 int TreePlotFunctionAndTaylor (differentiator_t *diff, const char *fileName)
 {
     assert (diff);
     assert (fileName);
 
-    const size_t kPathMaxLen = kFileNameLen + 32;
+    plotCurve_t curves[2] = {};
+
+    int status = PlotCurveCtor (diff, &curves[0], &diff->expression, kExpressionFileName);
+    status    |= PlotCurveCtor (diff, &curves[1], &diff->taylor,     kTaylorFileName);
+
+    if (status == TREE_OK)
+        status = PlotGenerateCurves (diff, curves, 2);
+
+    if (status == TREE_OK)
+        status = RunGnuPlot (diff, fileName, curves, 2);
 
-    char funcPlotPath[kPathMaxLen]   = {};
-    char taylorPlotPath[kPathMaxLen] = {};
-    
-    int status = snprintf (funcPlotPath, kPathMaxLen, "%s%s.txt", 
-                           diff->log.plotFolderPath, kExpressionFileName);
+    PlotCurveDtor (&curves[0]);
+    PlotCurveDtor (&curves[1]);
+
+    return status;
+}
+
+int PlotCurveCtor (differentiator_t *diff, plotCurve_t *curve, tree_t *tree, const char *name)
+{
+    assert (diff);
+    assert (curve);
+    assert (tree);
+    assert (name);
+
+    curve->tree             = tree;
+    curve->name             = name;
+    curve->coefs            = NULL;
+    curve->coefsCnt         = 0;
+    curve->center           = 0;
+
+    // n fma per point instead of walking the tree
+    if (tree == &diff->taylor && diff->taylorCoefs != NULL)
+    {
+        curve->coefs    = diff->taylorCoefs;
+        curve->coefsCnt = diff->taylorCoefsCnt;
+        curve->center   = diff->taylorCenter;
+    }
+
+    curve->pointsCnt        = 0;
+    curve->evaluationsCnt   = 0;
+    curve->status           = TREE_OK;
+    curve->format           = diff->log.plotDataFormat;
+    curve->numberFormat     = diff->log.numberFormat;
+
+    int status = snprintf (curve->dataPath, kPlotPathLen, "%s%s%s", diff->log.plotFolderPath, name,
+                           (curve->format == PLOT_DATA_TEXT) ? ".txt" : ".bin");
     if (status < 0)
     {
         ERROR_LOG ("Error in snprintf(), return code = %d", status);
@@ -76,139 +290,553 @@ int TreePlotFunctionAndTaylor (differentiator_t *diff, const char *fileName)
         return TREE_ERROR_COMMON |
                COMMON_ERROR_SNPRINTF;
     }
-    
-    status = snprintf (taylorPlotPath, kPathMaxLen, "%s%s.txt", 
-                       diff->log.plotFolderPath, kTaylorFileName);
-    if (status < 0)
+
+    curve->x           = (double *) calloc (kPlotWidth * kPlotColumnPointsMax, sizeof (double));
+    curve->y           = (double *) calloc (kPlotWidth * kPlotColumnPointsMax, sizeof (double));
+    curve->columnSizes = (size_t *) calloc (kPlotWidth, sizeof (size_t));
+
+    if (curve->x == NULL || curve->y == NULL || curve->columnSizes == NULL)
     {
-        ERROR_LOG ("Error in snprintf(), return code = %d", status);
+        ERROR_LOG ("Error allocating memory for plot \"%s\" - %s", name, strerror (errno));
 
         return TREE_ERROR_COMMON |
-               COMMON_ERROR_SNPRINTF;
+               COMMON_ERROR_ALLOCATING_MEMORY;
     }
 
-    TREE_DO_AND_RETURN (PlotGenerateData (diff, &diff->expression, funcPlotPath));
-    TREE_DO_AND_RETURN (PlotGenerateData (diff, &diff->taylor, taylorPlotPath));
+    return TREE_OK;
+}
+
+void PlotCurveDtor (plotCurve_t *curve)
+{
+    assert (curve);
 
-    TREE_DO_AND_RETURN (RunGnuPlot2Functions (diff, fileName, funcPlotPath, taylorPlotPath));
+    free (curve->x);
+    free (curve->y);
+    free (curve->columnSizes);
 
-    return TREE_OK;
+    ChebyshevDtor (&curve->chebyshev);
+
+    curve->x           = NULL;
+    curve->y           = NULL;
+    curve->columnSizes = NULL;
+    curve->pointsCnt   = 0;
 }
 
-int PlotGenerateData (differentiator_t *diff, tree_t *tree, const char *plotFilePath)
+int PlotGenerateCurves (differentiator_t *diff, plotCurve_t *curves, size_t curvesCnt)
 {
     assert (diff);
-    assert (tree);
-    assert (plotFilePath);
-    
-    FILE *plotFile = fopen (plotFilePath, "w");
-    if (plotFile == NULL)
+    assert (curves);
+    assert (diff->varToDiff);
+
+    codegen_t codegen = {};
+
+    // compiled code only makes plots faster, without it trees are evaluated
+    if (diff->log.plotCompiled && CodegenCtor (&codegen, diff, diff->varToDiff->idx) == TREE_OK)
     {
-        ERROR_LOG ("Error opening file \"%s\"", plotFilePath);
-        
-        return TREE_ERROR_COMMON |
-               COMMON_ERROR_OPENING_FILE;
+        for (size_t i = 0; i < curvesCnt; i++)
+        {
+            curves[i].compiled  = CodegenFind (&codegen, diff, curves[i].tree);
+            curves[i].variables = codegen.variables;
+        }
     }
 
-    fprintf (plotFile, "%s", "# x \t y\n");
+    int status = TREE_OK;
 
-    double saveValue = diff->varToDiff->value;
-    for (double x = kLeftRange; x <= kRightRange; x += kStep)
+    if (diff->pool != NULL)
+    {
+        status = PlotRunTasks (diff, curves, curvesCnt, diff->pool);
+    }
+    else
     {
-        diff->varToDiff->value = x;
+        threadPool_t pool = {};
+
+        status = ThreadPoolCtor (&pool, 0);
+        if (status == COMMON_ERROR_OK)
+        {
+            status = PlotRunTasks (diff, curves, curvesCnt, &pool);
+
+            ThreadPoolDtor (&pool);
+        }
+        else
+        {
+            status = TREE_ERROR_COMMON |
+                     status;
+        }
+    }
 
-        fprintf (plotFile, "%g \t %g\n", x, NodeCalculate (diff, tree->root));
+    for (size_t i = 0; i < curvesCnt; i++)
+    {
+        curves[i].compiled  = NULL;
+        curves[i].variables = NULL;
     }
-    diff->varToDiff->value = saveValue;
 
-    fclose (plotFile);
+    CodegenDtor (&codegen);
 
-    return TREE_OK;
+    return status;
 }
 
-int RunGnuPlot (differentiator_t *diff, const char *plotFilePath, const char *fileName)
+// first all chunks of all curves, then writing of all files
+int PlotRunTasks (differentiator_t *diff, plotCurve_t *curves, size_t curvesCnt,
+                  threadPool_t *pool)
 {
     assert (diff);
-    assert (plotFilePath);
-    assert (fileName);
+    assert (curves);
+    assert (pool);
 
-    const size_t kPathMaxLen = kFileNameLen + 32;
+    size_t chunksPerCurve = ThreadPoolSlotsCnt (pool) * kPlotChunksPerWorker;
+    size_t chunkSize      = (kPlotWidth + chunksPerCurve - 1) / chunksPerCurve;
 
-    char pngFilePath[kPathMaxLen] = {};
-    int status = snprintf (pngFilePath, kPathMaxLen, "%s%s.png", diff->log.plotFolderPath, fileName);
-    if (status < 0)
+    if (chunkSize < kPlotMinChunkSize)
+        chunkSize = kPlotMinChunkSize;
+
+    chunksPerCurve = (kPlotWidth + chunkSize - 1) / chunkSize;
+
+    plotChunk_t *chunks = (plotChunk_t *) calloc (curvesCnt * chunksPerCurve, sizeof (plotChunk_t));
+    if (chunks == NULL)
     {
-        ERROR_LOG ("Error in snprintf(), return code = %d", status);
-        
+        ERROR_LOG ("Error allocating memory for plot chunks - %s", strerror (errno));
+
         return TREE_ERROR_COMMON |
-               COMMON_ERROR_SNPRINTF;
+               COMMON_ERROR_ALLOCATING_MEMORY;
     }
 
-    FILE *scriptFile = fopen (diff->log.plotScriptFilePath, "w");
-    if (scriptFile == NULL)
+    size_t workerIdx = (pool == diff->pool) ? diff->workerIdx
+                                            : ThreadPoolExternalIdx (pool);
+    taskGroup_t group = {};
+
+    // approximations are built before sampling, every chunk of curve uses it
+    if (diff->log.plotChebyshevTolerance > 0)
     {
-        ERROR_LOG ("Error opening file \"%s\"", diff->log.plotScriptFilePath);
-        
-        return TREE_ERROR_COMMON |
-               COMMON_ERROR_OPENING_FILE;
+        for (size_t curveIdx = 0; curveIdx < curvesCnt; curveIdx++)
+        {
+            plotChunk_t *chunk = &chunks[curveIdx * chunksPerCurve];
+
+            chunk->diff  = diff;
+            chunk->curve = &curves[curveIdx];
+
+            if (ThreadPoolSubmit (pool, workerIdx, &group, PlotApproximateTask, chunk) != COMMON_ERROR_OK)
+                PlotApproximateTask (chunk, workerIdx);
+        }
+
+        ThreadPoolWait (pool, workerIdx, &group);
     }
 
-    fprintf (scriptFile, kPlotOneFuncScript, kLeftRange, kRightRange, pngFilePath, plotFilePath);
-    fclose (scriptFile);
+    for (size_t curveIdx = 0; curveIdx < curvesCnt; curveIdx++)
+    {
+        for (size_t chunkIdx = 0; chunkIdx < chunksPerCurve; chunkIdx++)
+        {
+            plotChunk_t *chunk = &chunks[curveIdx * chunksPerCurve + chunkIdx];
 
-    const size_t kCommandLen = kFileNameLen + 32;
-    char command[kCommandLen] = {};
-    
-    status = snprintf (command, kCommandLen, "gnuplot -c %s", diff->log.plotScriptFilePath);
-    if (status < 0)
+            chunk->diff  = diff;
+            chunk->curve = &curves[curveIdx];
+            chunk->begin = chunkIdx * chunkSize;
+            chunk->end   = chunk->begin + chunkSize;
+
+            if (chunk->end > kPlotWidth)
+                chunk->end = kPlotWidth;
+
+            if (ThreadPoolSubmit (pool, workerIdx, &group, PlotChunkTask, chunk) != COMMON_ERROR_OK)
+                PlotChunkTask (chunk, workerIdx);
+        }
+    }
+
+    ThreadPoolWait (pool, workerIdx, &group);
+
+    for (size_t i = 0; i < curvesCnt * chunksPerCurve; i++)
     {
-        ERROR_LOG ("Error in snprintf(), return code = %d", status);
-        
-        return TREE_ERROR_COMMON |
-               COMMON_ERROR_SNPRINTF;
+        chunks[i].curve->evaluationsCnt += chunks[i].evaluationsCnt;
     }
 
-    DEBUG_STR (command);
+    free (chunks);
 
-    status = system (command);
-    if (status != 0)
+    for (size_t i = 0; i < curvesCnt; i++)
     {
-        ERROR_LOG ("ERROR executing command \"%s\"", command);
-        
-        return TREE_ERROR_COMMON |
-               COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
+        if (ThreadPoolSubmit (pool, workerIdx, &group, PlotWriteTask, &curves[i]) != COMMON_ERROR_OK)
+            PlotWriteTask (&curves[i], workerIdx);
     }
 
-    return TREE_OK;
+    ThreadPoolWait (pool, workerIdx, &group);
+
+    int status = TREE_OK;
+    for (size_t i = 0; i < curvesCnt; i++)
+    {
+        status |= curves[i].status;
+    }
+
+    return status;
 }
 
-int RunGnuPlot2Functions (differentiator_t *diff, const char *pngFileName, 
-                          const char *firstData, const char *secondData)
+// tree which can't be approximated is sampled as is
+void PlotApproximateTask (void *arg, size_t workerIdx)
 {
-    assert (diff);
-    assert (pngFileName);
+    assert (arg);
+
+    (void) workerIdx;
+
+    plotChunk_t *chunk = (plotChunk_t *) arg;
+    plotCurve_t *curve = chunk->curve;
+
+    if (curve->coefs != NULL)
+        return;
+
+    ChebyshevCtor (&curve->chebyshev, chunk->diff, curve->tree->root, chunk->diff->varToDiff->idx,
+                   kLeftRange, kRightRange, chunk->diff->log.plotChebyshevTolerance);
+
+    curve->evaluationsCnt += curve->chebyshev.evaluationsCnt;
+}
+
+void PlotChunkTask (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    (void) workerIdx;
+
+    plotChunk_t *chunk = (plotChunk_t *) arg;
+    plotCurve_t *curve = chunk->curve;
 
-    const size_t kPathMaxLen = kFileNameLen + 32;
+    uint64_t start = PROFILE_START ();
 
-    char pngFilePath[kPathMaxLen] = {};
-    int status = snprintf (pngFilePath, kPathMaxLen, "%s%s.png", diff->log.plotFolderPath, pngFileName);
+    plotColumn_t column = {};
+    column.diff   = chunk->diff;
+    column.root     = curve->tree->root;
+    column.varIdx   = chunk->diff->varToDiff->idx;
+    column.coefs    = curve->coefs;
+    column.coefsCnt = curve->coefsCnt;
+    column.center   = curve->center;
 
-    FILE *scriptFile = fopen (diff->log.plotScriptFilePath, "w");
-    if (scriptFile == NULL)
+    if (curve->chebyshev.piecesCnt > 0)
+        column.chebyshev = &curve->chebyshev;
+
+    column.compiled  = curve->compiled;
+    column.variables = curve->variables;
+
+    double columnWidth = (double) (kRightRange - kLeftRange) / (double) kPlotWidth;
+
+    for (size_t i = chunk->begin; i < chunk->end; i++)
     {
-        ERROR_LOG ("Error opening file \"%s\"", diff->log.plotScriptFilePath);
+        double left  = kLeftRange + (double) i       * columnWidth;
+        double right = kLeftRange + (double) (i + 1) * columnWidth;
+
+        // left end is the right end of previous column
+        PlotSampleColumn (&column, left, right, i == 0);
+
+        curve->columnSizes[i] = PlotColumnReduce (&column,
+                                                  curve->x + i * kPlotColumnPointsMax,
+                                                  curve->y + i * kPlotColumnPointsMax);
+    }
+
+    chunk->evaluationsCnt = column.evaluationsCnt;
+
+    PROFILE_STOP (PROFILE_STAGE_PLOT_CHUNK, start);
+}
+
+void PlotSampleColumn (plotColumn_t *column, double left, double right, bool withLeft)
+{
+    assert (column);
+
+    column->size = 0;
+
+    double xa = left;
+    double ya = PlotCalculate (column, xa);
+
+    if (withLeft)
+        PlotColumnAppend (column, xa, ya);
+
+    for (size_t i = 1; i <= kPlotColumnSamples; i++)
+    {
+        double xb = left + (right - left) * (double) i / (double) kPlotColumnSamples;
+        double yb = PlotCalculate (column, xb);
+
+        PlotRefine (column, xa, ya, xb, yb, 0);
+
+        xa = xb;
+        ya = yb;
+    }
+}
+
+// appends points of (xa, xb]
+void PlotRefine (plotColumn_t *column, double xa, double ya, double xb, double yb, size_t depth)
+{
+    assert (column);
+
+    // room for midpoint and b
+    if (column->size + 2 > kPlotPointsPerPixel)
+    {
+        PlotColumnAppend (column, xb, yb);
+
+        return;
+    }
+
+    double xm = (xa + xb) / 2;
+    double ym = PlotCalculate (column, xm);
+
+    bool needRefine = PlotNeedRefine (ya, ym, yb);
+
+    if (needRefine && depth < kPlotMaxDepth)
+    {
+        PlotRefine (column, xa, ya, xm, ym, depth + 1);
+        PlotRefine (column, xm, ym, xb, yb, depth + 1);
+
+        return;
+    }
+
+    // still steep on the smallest interval and sign changes - pole, don't connect
+    if (needRefine && isfinite (ya) && isfinite (yb) && ya * yb < 0)
+        ym = NAN;
+
+    PlotColumnAppend (column, xm, ym);
+    PlotColumnAppend (column, xb, yb);
+}
+
+double PlotCalculate (plotColumn_t *column, double x)
+{
+    assert (column);
+
+    column->evaluationsCnt++;
+
+    if (column->coefs != NULL)
+        return TaylorEvaluate (column->coefs, column->coefsCnt, column->center, x);
+
+    if (column->chebyshev != NULL)
+        return ChebyshevEvaluate (column->chebyshev, x);
+
+    if (column->compiled != NULL)
+        return column->compiled (column->variables, x);
+
+    return NodeCalculateAt (column->diff, column->root, column->varIdx, x);
+}
+
+bool PlotNeedRefine (double ya, double ym, double yb)
+{
+    bool finiteA = isfinite (ya);
+    bool finiteM = isfinite (ym);
+    bool finiteB = isfinite (yb);
+
+    // end of domain is somewhere inside
+    if (!finiteA || !finiteM || !finiteB)
+        return !(finiteA == finiteM && finiteM == finiteB);
+
+    double scale = fmax (1, fmax (fabs (ya), fabs (yb)));
+
+    return fabs (ym - (ya + yb) / 2) > kPlotTolerance * scale;
+}
+
+// when column is full, the last point is replaced, so the right end is always kept
+void PlotColumnAppend (plotColumn_t *column, double x, double y)
+{
+    assert (column);
+
+    if (column->size == kPlotPointsPerPixel)
+        column->size--;
+
+    column->x[column->size] = x;
+    column->y[column->size] = y;
+    column->size++;
+}
+
+// keeps first, min, max, last finite points and first break in order of x
+size_t PlotColumnReduce (plotColumn_t *column, double *x, double *y)
+{
+    assert (column);
+    assert (x);
+    assert (y);
+
+    const size_t kNone = column->size;
+
+    size_t first    = kNone;
+    size_t last     = kNone;
+    size_t minIdx   = kNone;
+    size_t maxIdx   = kNone;
+    size_t breakIdx = kNone;
+
+    for (size_t i = 0; i < column->size; i++)
+    {
+        double value = column->y[i];
+
+        if (!isfinite (value))
+        {
+            if (breakIdx == kNone)
+                breakIdx = i;
+
+            continue;
+        }
+
+        if (first == kNone)
+            first = i;
+
+        last = i;
+
+        if (minIdx == kNone || value < column->y[minIdx]) minIdx = i;
+        if (maxIdx == kNone || value > column->y[maxIdx]) maxIdx = i;
+    }
+
+    size_t keep[kPlotColumnPointsMax] = {first, minIdx, maxIdx, last, breakIdx};
+
+    for (size_t i = 1; i < kPlotColumnPointsMax; i++)
+    {
+        for (size_t j = i; j > 0 && keep[j - 1] > keep[j]; j--)
+        {
+            size_t tmp  = keep[j];
+            keep[j]     = keep[j - 1];
+            keep[j - 1] = tmp;
+        }
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < kPlotColumnPointsMax; i++)
+    {
+        if (keep[i] == kNone || (i > 0 && keep[i] == keep[i - 1]))
+            continue;
+
+        x[size] = column->x[keep[i]];
+        y[size] = column->y[keep[i]];
+        size++;
+    }
+
+    return size;
+}
+
+void PlotCompact (plotCurve_t *curve)
+{
+    assert (curve);
+
+    size_t size = 0;
+
+    for (size_t column = 0; column < kPlotWidth; column++)
+    {
+        for (size_t i = 0; i < curve->columnSizes[column]; i++)
+        {
+            curve->x[size] = curve->x[column * kPlotColumnPointsMax + i];
+            curve->y[size] = curve->y[column * kPlotColumnPointsMax + i];
+            size++;
+        }
+    }
+
+    curve->pointsCnt = size;
+}
+
+void PlotWriteTask (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    (void) workerIdx;
+
+    plotCurve_t *curve = (plotCurve_t *) arg;
+
+    PlotCompact (curve);
+
+    curve->status = PlotWriteData (curve);
+}
+
+int PlotWriteData (plotCurve_t *curve)
+{
+    assert (curve);
+
+    // data goes straight to gnuplot's stdin
+    if (curve->format == PLOT_DATA_PIPE)
+        return TREE_OK;
+
+    FILE *plotFile = fopen (curve->dataPath, (curve->format == PLOT_DATA_BINARY) ? "wb" : "w");
+    if (plotFile == NULL)
+    {
+        ERROR_LOG ("Error opening file \"%s\"", curve->dataPath);
         
         return TREE_ERROR_COMMON |
                COMMON_ERROR_OPENING_FILE;
     }
 
-    fprintf (scriptFile, kPlotTwoFuncScript, kLeftRange, kRightRange, pngFilePath, firstData, secondData);
-    fclose (scriptFile);
+    if (curve->format == PLOT_DATA_BINARY)
+    {
+        PlotWriteBinary (plotFile, curve);
+    }
+    else
+    {
+        fprintf (plotFile, "%s", "# x \t y\n");
+
+        PlotWriteText (plotFile, curve);
+    }
+
+    fclose (plotFile);
+
+    return TREE_OK;
+}
+
+// "x \t y" lines, whole line is formatted in place and written by one fwrite()
+void PlotWriteText (FILE *file, plotCurve_t *curve)
+{
+    assert (file);
+    assert (curve);
+
+    char line[2 * kDoubleFormatMaxLen + 4] = {};
+    size_t written = 0;
+
+    for (size_t i = 0; i < curve->pointsCnt; i++)
+    {
+        size_t len = FormatDouble (line, curve->x[i], curve->numberFormat);
+
+        memcpy (line + len, " \t ", 3);
+        len += 3;
+
+        len += FormatDouble (line + len, curve->y[i], curve->numberFormat);
+        line[len++] = '\n';
+
+        fwrite (line, sizeof (char), len, file);
+        written += len;
+    }
+
+    PROFILE_COUNT (PROFILE_BYTES_WRITTEN, written);
+}
+
+// (x, y) pairs of float64, as in binary format="%float64%float64"
+void PlotWriteBinary (FILE *file, plotCurve_t *curve)
+{
+    assert (file);
+    assert (curve);
+
+    for (size_t i = 0; i < curve->pointsCnt; i++)
+    {
+        double point[2] = {curve->x[i], curve->y[i]};
+
+        fwrite (point, sizeof (double), 2, file);
+    }
+
+    PROFILE_COUNT (PROFILE_BYTES_WRITTEN, curve->pointsCnt * 2 * sizeof (double));
+}
+
+void PlotWriteScript (FILE *file, const char *pngFilePath, plotCurve_t *curves, size_t curvesCnt)
+{
+    assert (file);
+    assert (pngFilePath);
+    assert (curves);
+
+    fprintf (file, kPlotScriptHeader, kLeftRange, kRightRange, pngFilePath);
+
+    for (size_t i = 0; i < curvesCnt; i++)
+    {
+        if (i != 0)
+            fprintf (file, "%s", ", ");
+
+        switch (curves[i].format)
+        {
+            case PLOT_DATA_TEXT:    fprintf (file, kPlotTextCurve,   curves[i].dataPath);  break;
+            case PLOT_DATA_BINARY:  fprintf (file, kPlotBinaryCurve, curves[i].dataPath);  break;
+            case PLOT_DATA_PIPE:    fprintf (file, kPlotPipeCurve,   curves[i].pointsCnt); break;
+
+            default: assert (0 && "Unknown plot data format");
+        }
+    }
+
+    fprintf (file, "%s", "\n");
+}
 
-    const size_t kCommandLen = kFileNameLen + 32;
-    char command[kCommandLen] = {};
-    
-    status = snprintf (command, kCommandLen, "gnuplot -c %s", diff->log.plotScriptFilePath);
+int RunGnuPlot (differentiator_t *diff, const char *pngFileName, plotCurve_t *curves, size_t curvesCnt)
+{
+    assert (diff);
+    assert (pngFileName);
+    assert (curves);
+
+    char pngFilePath[kPlotPathLen] = {};
+    int status = snprintf (pngFilePath, kPlotPathLen, "%s%s.png", diff->log.plotFolderPath, pngFileName);
     if (status < 0)
     {
         ERROR_LOG ("Error in snprintf(), return code = %d", status);
@@ -217,13 +845,77 @@ int RunGnuPlot2Functions (differentiator_t *diff, const char *pngFileName,
                COMMON_ERROR_SNPRINTF;
     }
 
-    DEBUG_STR (command);
+    // with data files the script is kept next to them
+    if (diff->log.plotDataFormat != PLOT_DATA_PIPE)
+    {
+        FILE *scriptFile = fopen (diff->log.plotScriptFilePath, "w");
+        if (scriptFile == NULL)
+        {
+            ERROR_LOG ("Error opening file \"%s\"", diff->log.plotScriptFilePath);
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_OPENING_FILE;
+        }
+
+        PlotWriteScript (scriptFile, pngFilePath, curves, curvesCnt);
+        fclose (scriptFile);
+    }
+
+    uint64_t start = PROFILE_START ();
+
+    status = RunGnuPlotSession (&diff->log, pngFilePath, curves, curvesCnt);
+
+    PROFILE_STOP (PROFILE_STAGE_GNUPLOT, start);
+
+    return status;
+}
+
+// One gnuplot process renders all plots of the log: it is started on the first plot
+// and gets script (and binary data of "-" curves) through stdin.
+// "unset output" finishes png before the next one. Gnuplot exits on error,
+// then the session is restarted by the next plot
+int RunGnuPlotSession (treeLog_t *log, const char *pngFilePath, plotCurve_t *curves, size_t curvesCnt)
+{
+    assert (log);
+    assert (pngFilePath);
+    assert (curves);
+
+    process_t *gnuplot = &log->gnuplot;
+
+    if (gnuplot->pid == -1)
+    {
+        const char * const argv[] = {"gnuplot", NULL};
+
+        int status = ProcessStart (gnuplot, argv, PROCESS_WITH_INPUT);
+        if (status != COMMON_ERROR_OK)
+            return TREE_ERROR_COMMON |
+                   status;
+    }
+
+    sigset_t oldSet = {};
+    ProcessSigpipeBlock (&oldSet);
+
+    PlotWriteScript (gnuplot->input, pngFilePath, curves, curvesCnt);
 
-    status = system (command);
-    if (status != 0)
+    for (size_t i = 0; i < curvesCnt; i++)
     {
-        ERROR_LOG ("ERROR executing command \"%s\"", command);
-        
+        if (curves[i].format == PLOT_DATA_PIPE)
+            PlotWriteBinary (gnuplot->input, &curves[i]);
+    }
+
+    fprintf (gnuplot->input, "%s", "unset output\n");
+    fflush (gnuplot->input);
+
+    bool writeFailed = ferror (gnuplot->input);
+
+    ProcessSigpipeRestore (&oldSet);
+
+    if (writeFailed)
+    {
+        ERROR_LOG ("ERROR sending plot \"%s\" to gnuplot", pngFilePath);
+
+        ProcessWait (gnuplot);
+
         return TREE_ERROR_COMMON |
                COMMON_ERROR_RUNNING_SYSTEM_COMMAND;
     }
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "tree_profile.h"
+
+#include "debug.h"
+
+struct profileSpan_t
+{
+    uint64_t start      = 0;
+    uint64_t end        = 0;
+    size_t number       = 0;
+    profileStage_t stage = PROFILE_STAGE_PARSE;
+};
+
+// one for every thread, never freed: thread can finish before summary.
+// Only owner thread writes into slot, so nothing here is locked
+struct profileSlot_t
+{
+    uint64_t stageNs    [PROFILE_STAGES_CNT]    = {};
+    uint64_t stageCalls [PROFILE_STAGES_CNT]    = {};
+    uint64_t counters   [PROFILE_COUNTERS_CNT]  = {};
+
+    profileSpan_t *spans    = NULL;
+    size_t spansCnt         = 0;
+    size_t spansCapacity    = 0;
+    bool spansLost          = false; // allocation error, trace of thread is incomplete
+
+    size_t tid              = 0;
+    profileSlot_t *next     = NULL;
+};
+
+struct profile_t
+{
+    const char *summaryFileName = NULL;
+    const char *traceFileName   = NULL;
+    uint64_t start              = 0;
+
+    profileSlot_t *slots        = NULL;
+    size_t slotsCnt             = 0;
+    pthread_mutex_t lock        = PTHREAD_MUTEX_INITIALIZER;
+};
+
+const char * const kProfileStageNames[PROFILE_STAGES_CNT] =
+{
+    "parse",
+    "diff",
+    "simplify",
+    "taylor",
+    "codegen",
+    "roots",
+    "integral",
+    "plot_data",
+    "plot_chunk",
+    "gnuplot",
+    "latex_write",
+    "dot",
+    "wait_gnuplot",
+    "pdflatex",
+    "batch_job",
+    "report_queue_wait",
+    "report_render",
+};
+
+const char * const kProfileCounterNames[PROFILE_COUNTERS_CNT] =
+{
+    "nodes_created",
+    "nodes_freed",
+    "simplify_rounds",
+    "evaluations",
+    "bytes_written",
+};
+
+bool profileEnabled = false;
+
+static profile_t profile = {};
+static thread_local profileSlot_t *threadSlot = NULL;
+
+static profileSlot_t *ProfileSlot   ();
+static void ProfileAddSpan          (profileSlot_t *slot, profileStage_t stage,
+                                     uint64_t start, uint64_t end, size_t number);
+static void ProfileAtExit           ();
+static void ProfileWriteSummary     (FILE *file);
+static void ProfileWriteTrace       (FILE *file);
+static FILE *ProfileOpen            (const char *fileName);
+static void ProfileClose            (FILE *file);
+
+void ProfileInit ()
+{
+    const char *summaryFileName = getenv (kProfileEnvName);
+    const char *traceFileName   = getenv (kTraceEnvName);
+
+    if (summaryFileName != NULL && *summaryFileName == '\0') summaryFileName = NULL;
+    if (traceFileName   != NULL && *traceFileName   == '\0') traceFileName   = NULL;
+
+    if (summaryFileName == NULL && traceFileName == NULL)
+        return;
+
+    profile.summaryFileName = summaryFileName;
+    profile.traceFileName   = traceFileName;
+    profile.start           = ProfileNow ();
+
+    if (atexit (ProfileAtExit) != 0)
+    {
+        ERROR_LOG ("%s", "Error registering profile summary, profiling is disabled");
+
+        return;
+    }
+
+    profileEnabled = true;
+}
+
+uint64_t ProfileNow ()
+{
+    timespec time = {};
+    clock_gettime (CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000 * 1000 * 1000 + (uint64_t) time.tv_nsec;
+}
+
+void ProfileAddTime (profileStage_t stage, uint64_t start, size_t number)
+{
+    assert (stage < PROFILE_STAGES_CNT);
+
+    uint64_t now = ProfileNow ();
+
+    profileSlot_t *slot = ProfileSlot ();
+    if (slot == NULL)
+        return;
+
+    slot->stageNs[stage]    += now - start;
+    slot->stageCalls[stage] += 1;
+
+    if (profile.traceFileName != NULL)
+        ProfileAddSpan (slot, stage, start, now, number);
+}
+
+void ProfileAddCount (profileCounter_t counter, uint64_t value)
+{
+    assert (counter < PROFILE_COUNTERS_CNT);
+
+    profileSlot_t *slot = ProfileSlot ();
+    if (slot == NULL)
+        return;
+
+    slot->counters[counter] += value;
+}
+
+profileSlot_t *ProfileSlot ()
+{
+    if (threadSlot != NULL)
+        return threadSlot;
+
+    profileSlot_t *slot = (profileSlot_t *) calloc (1, sizeof (profileSlot_t));
+    if (slot == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for profile - %s", strerror (errno));
+
+        return NULL;
+    }
+
+    pthread_mutex_lock (&profile.lock);
+
+    slot->tid     = ++profile.slotsCnt;
+    slot->next    = profile.slots;
+    profile.slots = slot;
+
+    pthread_mutex_unlock (&profile.lock);
+
+    threadSlot = slot;
+
+    return slot;
+}
+
+void ProfileAddSpan (profileSlot_t *slot, profileStage_t stage,
+                     uint64_t start, uint64_t end, size_t number)
+{
+    assert (slot);
+
+    if (slot->spansLost)
+        return;
+
+    if (slot->spansCnt == slot->spansCapacity)
+    {
+        size_t newCapacity = (slot->spansCapacity == 0) ? kTraceStartCapacity
+                                                        : slot->spansCapacity * 2;
+
+        profileSpan_t *newSpans = (profileSpan_t *) realloc (slot->spans,
+                                                             newCapacity * sizeof (profileSpan_t));
+        if (newSpans == NULL)
+        {
+            ERROR_LOG ("Error reallocating memory for trace - %s", strerror (errno));
+
+            slot->spansLost = true;
+
+            return;
+        }
+
+        slot->spans         = newSpans;
+        slot->spansCapacity = newCapacity;
+    }
+
+    profileSpan_t *span = &slot->spans[slot->spansCnt++];
+
+    span->start  = start;
+    span->end    = end;
+    span->number = number;
+    span->stage  = stage;
+}
+
+// all threads are joined before exit, so slots are read without lock
+void ProfileAtExit ()
+{
+    if (profile.summaryFileName != NULL)
+    {
+        FILE *file = ProfileOpen (profile.summaryFileName);
+        if (file != NULL)
+        {
+            ProfileWriteSummary (file);
+            ProfileClose (file);
+        }
+    }
+
+    if (profile.traceFileName != NULL)
+    {
+        FILE *file = ProfileOpen (profile.traceFileName);
+        if (file != NULL)
+        {
+            ProfileWriteTrace (file);
+            ProfileClose (file);
+        }
+    }
+
+    profileSlot_t *slot = profile.slots;
+    while (slot != NULL)
+    {
+        profileSlot_t *next = slot->next;
+
+        free (slot->spans);
+        free (slot);
+
+        slot = next;
+    }
+
+    profile.slots    = NULL;
+    profile.slotsCnt = 0;
+    profileEnabled   = false;
+}
+
+void ProfileWriteSummary (FILE *file)
+{
+    assert (file);
+
+    uint64_t wallNs = ProfileNow () - profile.start;
+
+    profileSlot_t total = {};
+
+    for (profileSlot_t *slot = profile.slots; slot != NULL; slot = slot->next)
+    {
+        for (size_t i = 0; i < PROFILE_STAGES_CNT; i++)
+        {
+            total.stageNs[i]    += slot->stageNs[i];
+            total.stageCalls[i] += slot->stageCalls[i];
+        }
+
+        for (size_t i = 0; i < PROFILE_COUNTERS_CNT; i++)
+        {
+            total.counters[i] += slot->counters[i];
+        }
+    }
+
+    fprintf (file, "{\"wall_ns\": %lu, \"threads\": %lu, \"stages\": {", wallNs, profile.slotsCnt);
+
+    for (size_t i = 0; i < PROFILE_STAGES_CNT; i++)
+    {
+        fprintf (file, "%s\"%s\": {\"calls\": %lu, \"ns\": %lu}", (i == 0) ? "" : ", ",
+                 kProfileStageNames[i], total.stageCalls[i], total.stageNs[i]);
+    }
+
+    fprintf (file, "%s", "}, \"counters\": {");
+
+    for (size_t i = 0; i < PROFILE_COUNTERS_CNT; i++)
+    {
+        fprintf (file, "%s\"%s\": %lu", (i == 0) ? "" : ", ",
+                 kProfileCounterNames[i], total.counters[i]);
+    }
+
+    fprintf (file, "%s", "}}\n");
+}
+
+// complete events ("ph": "X") with times in microseconds from ProfileInit(),
+// one event per line, so the file is also easy to grep
+void ProfileWriteTrace (FILE *file)
+{
+    assert (file);
+
+    fprintf (file, "%s", "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+
+    bool first = true;
+
+    for (profileSlot_t *slot = profile.slots; slot != NULL; slot = slot->next)
+    {
+        fprintf (file, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %lu, "
+                       "\"args\": {\"name\": \"thread %lu%s\"}}",
+                 first ? "" : ",\n", slot->tid, slot->tid,
+                 slot->spansLost ? " (incomplete)" : "");
+        first = false;
+
+        for (size_t i = 0; i < slot->spansCnt; i++)
+        {
+            profileSpan_t *span = &slot->spans[i];
+
+            fprintf (file, ",\n{\"ph\": \"X\", \"name\": \"%s\", \"pid\": 1, \"tid\": %lu, "
+                           "\"ts\": %.3f, \"dur\": %.3f",
+                     kProfileStageNames[span->stage], slot->tid,
+                     (double) (span->start - profile.start) / 1000,
+                     (double) (span->end - span->start) / 1000);
+
+            if (span->number != 0)
+                fprintf (file, ", \"args\": {\"n\": %lu}", span->number);
+
+            fprintf (file, "%s", "}");
+        }
+    }
+
+    fprintf (file, "%s", "\n]}\n");
+}
+
+FILE *ProfileOpen (const char *fileName)
+{
+    assert (fileName);
+
+    if (strcmp (fileName, "-") == 0)
+        return stderr;
+
+    FILE *file = fopen (fileName, "w");
+    if (file == NULL)
+        ERROR_LOG ("Error opening file \"%s\" - %s", fileName, strerror (errno));
+
+    return file;
+}
+
+void ProfileClose (FILE *file)
+{
+    assert (file);
+
+    if (file != stderr)
+        fclose (file);
+}
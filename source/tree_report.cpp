@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "tree_report.h"
+
+#include "tree.h"
+#include "tree_log.h"
+#include "tree_profile.h"
+
+static void *RendererLoop   (void *arg);
+static int  ReportRender    (report_t *report);
+static report_t *ReportQueuePop (reportQueue_t *queue);
+
+int ReportCreate (report_t **report, size_t seq, size_t variablesCapacity)
+{
+    assert (report);
+
+    *report = (report_t *) calloc (1, sizeof (report_t));
+    if (*report == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for report - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    // default values of fields, calloc() gives only zeros
+    **report = {};
+
+    differentiator_t *diff = &(*report)->diff;
+
+    NodeArenaCtor (&(*report)->arena);
+    diff->arena = &(*report)->arena;
+
+    const size_t suffixLen = 24;
+    char suffix[suffixLen] = {};
+    snprintf (suffix, suffixLen, "_%lu", seq);
+
+    TREE_DO_AND_RETURN (LogCtorWithSuffix (&diff->log, suffix));
+    TREE_DO_AND_RETURN (DifferentiatorCtorEmpty (diff, variablesCapacity));
+
+    return TREE_OK;
+}
+
+void ReportDestroy (report_t *report)
+{
+    if (report == NULL)
+        return;
+
+    PlotSetDtor (&report->plots);
+    DifferentiatorDtor (&report->diff);
+    NodeArenaDtor (&report->arena);
+
+    free (report);
+}
+
+int ReportQueueCtor (reportQueue_t *queue, size_t capacity, size_t renderersCnt)
+{
+    assert (queue);
+    assert (capacity > 0);
+    assert (renderersCnt > 0);
+
+    queue->capacity = capacity;
+    queue->head     = 0;
+    queue->size     = 0;
+    queue->closed   = false;
+    queue->status   = TREE_OK;
+
+    pthread_mutex_init (&queue->lock,     NULL);
+    pthread_cond_init  (&queue->notEmpty, NULL);
+    pthread_cond_init  (&queue->notFull,  NULL);
+
+    queue->reports   = (report_t **) calloc (capacity,     sizeof (report_t *));
+    queue->renderers = (pthread_t *) calloc (renderersCnt, sizeof (pthread_t));
+
+    if (queue->reports == NULL || queue->renderers == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for report queue - %s", strerror (errno));
+
+        free (queue->reports);
+        free (queue->renderers);
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    for (size_t i = 0; i < renderersCnt; i++)
+    {
+        int status = pthread_create (&queue->renderers[i], NULL, RendererLoop, queue);
+        if (status != 0)
+        {
+            ERROR_LOG ("Error creating renderer thread - %s", strerror (status));
+
+            // join already started renderers
+            queue->renderersCnt = i;
+            ReportQueueDtor (queue);
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_CREATING_THREAD;
+        }
+    }
+
+    queue->renderersCnt = renderersCnt;
+
+    return TREE_OK;
+}
+
+void ReportQueuePush (reportQueue_t *queue, report_t *report)
+{
+    assert (queue);
+    assert (report);
+
+    pthread_mutex_lock (&queue->lock);
+
+    assert (!queue->closed);
+
+    uint64_t start = PROFILE_START ();
+
+    while (queue->size == queue->capacity)
+        pthread_cond_wait (&queue->notFull, &queue->lock);
+
+    PROFILE_STOP (PROFILE_STAGE_REPORT_QUEUE_WAIT, start);
+
+    queue->reports[(queue->head + queue->size) % queue->capacity] = report;
+    queue->size++;
+
+    pthread_cond_signal (&queue->notEmpty);
+    pthread_mutex_unlock (&queue->lock);
+}
+
+int ReportQueueDtor (reportQueue_t *queue)
+{
+    assert (queue);
+
+    pthread_mutex_lock (&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast (&queue->notEmpty);
+    pthread_mutex_unlock (&queue->lock);
+
+    for (size_t i = 0; i < queue->renderersCnt; i++)
+    {
+        pthread_join (queue->renderers[i], NULL);
+    }
+
+    // nothing is left after renderers, unless they were not started
+    for (size_t i = 0; i < queue->size; i++)
+    {
+        ReportDestroy (queue->reports[(queue->head + i) % queue->capacity]);
+    }
+
+    pthread_mutex_destroy (&queue->lock);
+    pthread_cond_destroy  (&queue->notEmpty);
+    pthread_cond_destroy  (&queue->notFull);
+
+    free (queue->reports);
+    free (queue->renderers);
+
+    queue->reports      = NULL;
+    queue->renderers    = NULL;
+    queue->renderersCnt = 0;
+    queue->size         = 0;
+
+    return queue->status;
+}
+
+// renderers finish all pushed reports before exit
+void *RendererLoop (void *arg)
+{
+    assert (arg);
+
+    reportQueue_t *queue = (reportQueue_t *) arg;
+
+    report_t *report = NULL;
+
+    while ((report = ReportQueuePop (queue)) != NULL)
+    {
+        int status = ReportRender (report);
+
+        if (status != TREE_OK)
+        {
+            pthread_mutex_lock (&queue->lock);
+            queue->status |= status;
+            pthread_mutex_unlock (&queue->lock);
+        }
+    }
+
+    return NULL;
+}
+
+report_t *ReportQueuePop (reportQueue_t *queue)
+{
+    assert (queue);
+
+    pthread_mutex_lock (&queue->lock);
+
+    while (queue->size == 0 && !queue->closed)
+        pthread_cond_wait (&queue->notEmpty, &queue->lock);
+
+    report_t *report = NULL;
+
+    if (queue->size > 0)
+    {
+        report = queue->reports[queue->head];
+
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->size--;
+
+        pthread_cond_signal (&queue->notFull);
+    }
+
+    pthread_mutex_unlock (&queue->lock);
+
+    return report;
+}
+
+// gnuplot, end of latex, then LogDtor() in ReportDestroy() waits for dot and pdflatex
+int ReportRender (report_t *report)
+{
+    assert (report);
+
+    uint64_t start = PROFILE_START ();
+
+    int status = TREE_OK;
+
+    if (report->plots.curves != NULL)
+        status = DumpLatexAddPlots (&report->diff, &report->plots);
+
+    ReportDestroy (report);
+
+    PROFILE_STOP (PROFILE_STAGE_REPORT_RENDER, start);
+
+    return status;
+}
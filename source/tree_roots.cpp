@@ -0,0 +1,413 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_roots.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_codegen.h"
+#include "tree_profile.h"
+#include "thread_pool.h"
+
+const size_t kRootsStartCapacity = 16;
+const double kRootsTolerance     = 4 * DBL_EPSILON;
+
+struct rootsBracket_t
+{
+    double left         = 0;
+    double right        = 0;
+    double leftValue    = 0;
+    double rightValue   = 0;
+
+    root_t root         = {};
+    bool found          = false;
+};
+
+// shared by all tasks, every task writes only its own part of arrays
+struct rootsSearch_t
+{
+    evaluator_t function        = {};
+    evaluator_t derivatives[2]  = {};
+    size_t derivativesCnt       = 0;
+
+    double gridX[kRootsGridSize + 1]    = {};
+    double gridY[kRootsGridSize + 1]    = {};
+
+    rootsBracket_t *brackets    = NULL;
+    size_t bracketsCnt          = 0;
+};
+
+struct rootsChunk_t
+{
+    rootsSearch_t *search   = NULL;
+    size_t begin            = 0;
+    size_t end              = 0;
+};
+
+static int  RootsRunTasks       (rootsSearch_t *search, size_t cnt, void (*task) (void *, size_t),
+                                 threadPool_t *pool, size_t workerIdx);
+static void RootsGridTask       (void *arg, size_t workerIdx);
+static void RootsPolishTask     (void *arg, size_t workerIdx);
+static int  RootsBracket        (rootsSearch_t *search);
+static void RootsPolish         (const rootsSearch_t *search, rootsBracket_t *bracket);
+static double RootsStep         (const rootsSearch_t *search, double x, double value);
+static int  RootsAdd            (roots_t *roots, const root_t *root);
+
+int RootsFind (roots_t *roots, differentiator_t *diff, const codegen_t *codegen,
+               size_t order, double left, double right)
+{
+    assert (roots);
+    assert (diff);
+    assert (diff->varToDiff);
+
+    *roots = {};
+
+    if (!(left < right) || order > diff->diffTreesCnt)
+        return TREE_ERROR_WRONG_ARGUMENT;
+
+    tree_t *tree = (order == 0) ? &diff->expression : &diff->diffTrees[order - 1];
+    if (tree->root == NULL)
+        return TREE_ERROR_NULL_ROOT;
+
+    uint64_t start = PROFILE_START ();
+
+    rootsSearch_t *search = (rootsSearch_t *) calloc (1, sizeof (rootsSearch_t));
+    if (search == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for roots search - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    size_t varIdx = diff->varToDiff->idx;
+
+    EvaluatorCtor (&search->function, diff, codegen, tree, varIdx);
+
+    for (size_t i = order; i < order + 2 && i < diff->diffTreesCnt && diff->diffTrees[i].root != NULL; i++)
+    {
+        EvaluatorCtor (&search->derivatives[i - order], diff, codegen, &diff->diffTrees[i], varIdx);
+        search->derivativesCnt++;
+    }
+
+    for (size_t i = 0; i <= kRootsGridSize; i++)
+    {
+        search->gridX[i] = left + (right - left) * (double) i / (double) kRootsGridSize;
+    }
+
+    search->gridX[kRootsGridSize] = right;
+
+    threadPool_t localPool = {};
+    threadPool_t *pool     = diff->pool;
+    size_t workerIdx       = diff->workerIdx;
+
+    int status = TREE_OK;
+
+    if (pool == NULL)
+    {
+        status = ThreadPoolCtor (&localPool, 0);
+        if (status != COMMON_ERROR_OK)
+        {
+            free (search);
+
+            return TREE_ERROR_COMMON |
+                   status;
+        }
+
+        pool      = &localPool;
+        workerIdx = ThreadPoolExternalIdx (pool);
+    }
+
+    status = RootsRunTasks (search, kRootsGridSize + 1, RootsGridTask, pool, workerIdx);
+
+    if (status == TREE_OK)
+        status = RootsBracket (search);
+
+    if (status == TREE_OK)
+        status = RootsRunTasks (search, search->bracketsCnt, RootsPolishTask, pool, workerIdx);
+
+    if (pool == &localPool)
+        ThreadPoolDtor (&localPool);
+
+    size_t evaluationsCnt = kRootsGridSize + 1;
+
+    for (size_t i = 0; i < search->bracketsCnt && status == TREE_OK; i++)
+    {
+        rootsBracket_t *bracket = &search->brackets[i];
+
+        evaluationsCnt += bracket->root.iterations * (1 + search->derivativesCnt);
+
+        if (bracket->found)
+            status = RootsAdd (roots, &bracket->root);
+    }
+
+    free (search->brackets);
+    free (search);
+
+    if (status != TREE_OK)
+        RootsDtor (roots);
+
+    PROFILE_STOP  (PROFILE_STAGE_ROOTS, start);
+    PROFILE_COUNT (PROFILE_EVALUATIONS, evaluationsCnt);
+
+    return status;
+}
+
+void RootsDtor (roots_t *roots)
+{
+    assert (roots);
+
+    free (roots->roots);
+
+    *roots = {};
+}
+
+int RootsRunTasks (rootsSearch_t *search, size_t cnt, void (*task) (void *, size_t),
+                   threadPool_t *pool, size_t workerIdx)
+{
+    assert (search);
+    assert (task);
+    assert (pool);
+
+    if (cnt == 0)
+        return TREE_OK;
+
+    size_t chunksCnt = ThreadPoolSlotsCnt (pool) * kRootsChunksPerWorker;
+    size_t chunkSize = (cnt + chunksCnt - 1) / chunksCnt;
+
+    if (chunkSize < kRootsMinChunkSize)
+        chunkSize = kRootsMinChunkSize;
+
+    chunksCnt = (cnt + chunkSize - 1) / chunkSize;
+
+    rootsChunk_t *chunks = (rootsChunk_t *) calloc (chunksCnt, sizeof (rootsChunk_t));
+    if (chunks == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for roots chunks - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    taskGroup_t group = {};
+
+    for (size_t i = 0; i < chunksCnt; i++)
+    {
+        chunks[i].search = search;
+        chunks[i].begin  = i * chunkSize;
+        chunks[i].end    = chunks[i].begin + chunkSize;
+
+        if (chunks[i].end > cnt)
+            chunks[i].end = cnt;
+
+        if (ThreadPoolSubmit (pool, workerIdx, &group, task, &chunks[i]) != COMMON_ERROR_OK)
+            task (&chunks[i], workerIdx);
+    }
+
+    ThreadPoolWait (pool, workerIdx, &group);
+
+    free (chunks);
+
+    return TREE_OK;
+}
+
+void RootsGridTask (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    (void) workerIdx;
+
+    rootsChunk_t *chunk   = (rootsChunk_t *) arg;
+    rootsSearch_t *search = chunk->search;
+
+    EvaluatorCalculateMany (&search->function, search->gridX + chunk->begin,
+                            search->gridY + chunk->begin, chunk->end - chunk->begin);
+}
+
+void RootsPolishTask (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    (void) workerIdx;
+
+    rootsChunk_t *chunk = (rootsChunk_t *) arg;
+
+    for (size_t i = chunk->begin; i < chunk->end; i++)
+    {
+        RootsPolish (chunk->search, &chunk->search->brackets[i]);
+    }
+}
+
+// exact zero in grid point is a bracket of zero width, NAN ends are never brackets
+int RootsBracket (rootsSearch_t *search)
+{
+    assert (search);
+
+    const double *y = search->gridY;
+
+    search->brackets = (rootsBracket_t *) calloc (kRootsGridSize + 1, sizeof (rootsBracket_t));
+    if (search->brackets == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for roots brackets - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    for (size_t i = 0; i <= kRootsGridSize; i++)
+    {
+        bool isZero = !(y[i] < 0) && !(y[i] > 0) && !isnan (y[i]);
+        bool isSignChange = i < kRootsGridSize && ((y[i] < 0 && y[i + 1] > 0) ||
+                                                   (y[i] > 0 && y[i + 1] < 0));
+
+        if (!isZero && !isSignChange)
+            continue;
+
+        rootsBracket_t *bracket = &search->brackets[search->bracketsCnt++];
+
+        if (isSignChange)
+            bracket->root.direction = (y[i] < 0) ? 1 : -1;
+        else if (i > 0 && i < kRootsGridSize && y[i - 1] < 0 && y[i + 1] > 0)
+            bracket->root.direction = 1;
+        else if (i > 0 && i < kRootsGridSize && y[i - 1] > 0 && y[i + 1] < 0)
+            bracket->root.direction = -1;
+
+        bracket->left       = search->gridX[i];
+        bracket->leftValue  = y[i];
+        bracket->right      = isZero ? search->gridX[i] : search->gridX[i + 1];
+        bracket->rightValue = isZero ? y[i]             : y[i + 1];
+    }
+
+    return TREE_OK;
+}
+
+void RootsPolish (const rootsSearch_t *search, rootsBracket_t *bracket)
+{
+    assert (search);
+    assert (bracket);
+
+    double left       = bracket->left;
+    double right      = bracket->right;
+    double leftValue  = bracket->leftValue;
+    double rightValue = bracket->rightValue;
+
+    root_t *root = &bracket->root;
+
+    if (!(left < right))
+    {
+        root->x      = left;
+        root->value  = leftValue;
+        bracket->found = true;
+
+        return;
+    }
+
+    // near a pole |f| only grows
+    double bound = fmin (fabs (leftValue), fabs (rightValue));
+
+    // secant as first guess, it's in bracket because signs are different
+    double x     = left - leftValue * (right - left) / (rightValue - leftValue);
+    double value = NAN;
+
+    if (!(left < x && x < right))
+        x = (left + right) / 2;
+
+    while (root->iterations < kRootsMaxIterations)
+    {
+        value = EvaluatorCalculate (&search->function, x);
+        root->iterations++;
+
+        if (!isfinite (value) || (!(value < 0) && !(value > 0)))
+            break;
+
+        if ((value < 0) == (leftValue < 0))
+        {
+            left      = x;
+            leftValue = value;
+        }
+        else
+        {
+            right      = x;
+            rightValue = value;
+        }
+
+        double next = x - RootsStep (search, x, value);
+
+        // NAN step is also out of bracket, root can be its end after rounding
+        if (!(left <= next && next <= right))
+            next = (left + right) / 2;
+
+        double tolerance = kRootsTolerance * fmax (1, fabs (x));
+        bool converged   = fabs (next - x) <= tolerance || right - left <= tolerance;
+
+        if (converged)
+        {
+            x     = next;
+            value = EvaluatorCalculate (&search->function, x);
+            root->iterations++;
+
+            break;
+        }
+
+        // after the last iteration value must still be f (x)
+        if (root->iterations < kRootsMaxIterations)
+            x = next;
+    }
+
+    root->x        = x;
+    root->value    = value;
+    bracket->found = isfinite (value) && fabs (value) <= bound;
+}
+
+// Halley: x - 2 f f' / (2 f'^2 - f f''), cubic convergence
+double RootsStep (const rootsSearch_t *search, double x, double value)
+{
+    assert (search);
+
+    if (search->derivativesCnt == 0)
+        return NAN;
+
+    double first = EvaluatorCalculate (&search->derivatives[0], x);
+
+    // zero denominator - no step, bisection instead
+    if (search->derivativesCnt == 1)
+        return (fabs (first) > 0) ? value / first : NAN;
+
+    double second      = EvaluatorCalculate (&search->derivatives[1], x);
+    double denominator = 2 * first * first - value * second;
+
+    return (fabs (denominator) > 0) ? 2 * value * first / denominator : NAN;
+}
+
+int RootsAdd (roots_t *roots, const root_t *root)
+{
+    assert (roots);
+    assert (root);
+
+    if (roots->rootsCnt == roots->capacity)
+    {
+        size_t newCapacity = (roots->capacity == 0) ? kRootsStartCapacity
+                                                    : roots->capacity * 2;
+
+        root_t *newRoots = (root_t *) realloc (roots->roots, newCapacity * sizeof (root_t));
+        if (newRoots == NULL)
+        {
+            ERROR_LOG ("Error reallocating memory for roots - %s", strerror (errno));
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_ALLOCATING_MEMORY;
+        }
+
+        roots->roots    = newRoots;
+        roots->capacity = newCapacity;
+    }
+
+    roots->roots[roots->rootsCnt++] = *root;
+
+    return TREE_OK;
+}
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "tree_taylor.h"
+
+#include "tree.h"
+#include "tree_calc.h"
+#include "tree_profile.h"
+#include "thread_pool.h"
+
+struct taylorChunk_t
+{
+    differentiator_t *diff  = NULL;
+    size_t varIdx           = 0;
+    const double *centers   = NULL;
+    double *coefs           = NULL;
+    size_t coefsCnt         = 0;
+    size_t begin            = 0;    // centers
+    size_t end              = 0;
+};
+
+static int  TaylorRunTasks          (taylorChunk_t *all, threadPool_t *pool, size_t workerIdx);
+static void TaylorChunkTask         (void *arg, size_t workerIdx);
+static void TaylorCalculateDerivatives (differentiator_t *diff, size_t varIdx, double center,
+                                        double *values, size_t valuesCnt);
+static void TaylorDivideFactorials  (double *coefs, size_t coefsCnt);
+
+void TaylorCalculateCoefs (differentiator_t *diff, size_t varIdx, double center,
+                           double *coefs, size_t coefsCnt)
+{
+    assert (diff);
+    assert (coefs);
+
+    TaylorCalculateDerivatives (diff, varIdx, center, coefs, coefsCnt);
+    TaylorDivideFactorials     (coefs, coefsCnt);
+}
+
+// values[k] = f^(k) (center)
+void TaylorCalculateDerivatives (differentiator_t *diff, size_t varIdx, double center,
+                                 double *values, size_t valuesCnt)
+{
+    assert (diff);
+    assert (values);
+    assert (valuesCnt <= diff->diffTreesCnt + 1);
+
+    if (valuesCnt == 0)
+        return;
+
+    values[0] = NodeCalculateAt (diff, diff->expression.root, varIdx, center);
+
+    for (size_t i = 1; i < valuesCnt; i++)
+    {
+        values[i] = NodeCalculateAt (diff, diff->diffTrees[i - 1].root, varIdx, center);
+    }
+}
+
+void TaylorDivideFactorials (double *coefs, size_t coefsCnt)
+{
+    assert (coefs);
+
+    // double: size_t factorial overflows after 20!
+    double factorial = 1;
+
+    for (size_t i = 1; i < coefsCnt; i++)
+    {
+        factorial *= (double) i;
+
+        coefs[i] /= factorial;
+    }
+}
+
+int TaylorCalculateCenters (differentiator_t *diff, size_t varIdx,
+                            const double *centers, size_t centersCnt,
+                            double *coefs, size_t coefsCnt)
+{
+    assert (diff);
+    assert (centers);
+    assert (coefs);
+    assert (coefsCnt <= diff->diffTreesCnt + 1);
+
+    uint64_t start = PROFILE_START ();
+
+    taylorChunk_t all = {};
+    all.diff     = diff;
+    all.varIdx   = varIdx;
+    all.centers  = centers;
+    all.coefs    = coefs;
+    all.coefsCnt = coefsCnt;
+    all.begin    = 0;
+    all.end      = centersCnt;
+
+    int status = TREE_OK;
+
+    if (centersCnt <= kTaylorMinChunkSize)
+    {
+        TaylorChunkTask (&all, 0);
+    }
+    else if (diff->pool != NULL)
+    {
+        status = TaylorRunTasks (&all, diff->pool, diff->workerIdx);
+    }
+    else
+    {
+        threadPool_t pool = {};
+
+        status = ThreadPoolCtor (&pool, 0);
+        if (status != COMMON_ERROR_OK)
+            return TREE_ERROR_COMMON |
+                   status;
+
+        status = TaylorRunTasks (&all, &pool, ThreadPoolExternalIdx (&pool));
+
+        ThreadPoolDtor (&pool);
+    }
+
+    PROFILE_STOP_N (PROFILE_STAGE_TAYLOR, start, centersCnt);
+    PROFILE_COUNT  (PROFILE_EVALUATIONS, centersCnt * coefsCnt);
+
+    return status;
+}
+
+int TaylorRunTasks (taylorChunk_t *all, threadPool_t *pool, size_t workerIdx)
+{
+    assert (all);
+    assert (pool);
+
+    size_t centersCnt = all->end;
+
+    size_t chunksCnt = ThreadPoolSlotsCnt (pool) * kTaylorChunksPerWorker;
+    size_t chunkSize = (centersCnt + chunksCnt - 1) / chunksCnt;
+
+    if (chunkSize < kTaylorMinChunkSize)
+        chunkSize = kTaylorMinChunkSize;
+
+    chunksCnt = (centersCnt + chunkSize - 1) / chunkSize;
+
+    taylorChunk_t *chunks = (taylorChunk_t *) calloc (chunksCnt, sizeof (taylorChunk_t));
+    if (chunks == NULL)
+    {
+        ERROR_LOG ("Error allocating memory for taylor chunks - %s", strerror (errno));
+
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+    }
+
+    taskGroup_t group = {};
+
+    for (size_t i = 0; i < chunksCnt; i++)
+    {
+        chunks[i]       = *all;
+        chunks[i].begin = i * chunkSize;
+        chunks[i].end   = chunks[i].begin + chunkSize;
+
+        if (chunks[i].end > centersCnt)
+            chunks[i].end = centersCnt;
+
+        if (ThreadPoolSubmit (pool, workerIdx, &group, TaylorChunkTask, &chunks[i]) != COMMON_ERROR_OK)
+            TaylorChunkTask (&chunks[i], workerIdx);
+    }
+
+    ThreadPoolWait (pool, workerIdx, &group);
+
+    free (chunks);
+
+    return TREE_OK;
+}
+
+void TaylorChunkTask (void *arg, size_t workerIdx)
+{
+    assert (arg);
+
+    (void) workerIdx;
+
+    taylorChunk_t *chunk = (taylorChunk_t *) arg;
+
+    for (size_t i = chunk->begin; i < chunk->end; i++)
+    {
+        TaylorCalculateCoefs (chunk->diff, chunk->varIdx, chunk->centers[i],
+                              chunk->coefs + i * chunk->coefsCnt, chunk->coefsCnt);
+    }
+}
+
+double TaylorEvaluate (const double *coefs, size_t coefsCnt, double center, double x)
+{
+    assert (coefs);
+
+    if (coefsCnt == 0)
+        return 0;
+
+    double t = x - center;
+    double y = coefs[coefsCnt - 1];
+
+    for (size_t i = coefsCnt - 1; i > 0; i--)
+    {
+        y = fma (y, t, coefs[i - 1]);
+    }
+
+    return y;
+}
+
+int TaylorBuild (differentiator_t *diff)
+{
+    assert (diff);
+    assert (diff->varToDiff);
+
+    uint64_t start = PROFILE_START ();
+
+    size_t coefsCnt = diff->diffTreesCnt + 1;
+
+    if (diff->taylorCoefsCnt != coefsCnt)
+    {
+        // derivatives are kept right after coefficients
+        double *coefs = (double *) realloc (diff->taylorCoefs, 2 * coefsCnt * sizeof (double));
+        if (coefs == NULL)
+        {
+            ERROR_LOG ("Error reallocating memory for taylor coefficients - %s", strerror (errno));
+
+            return TREE_ERROR_COMMON |
+                   COMMON_ERROR_ALLOCATING_MEMORY;
+        }
+
+        diff->taylorCoefs       = coefs;
+        diff->taylorDerivatives = coefs + coefsCnt;
+        diff->taylorCoefsCnt    = coefsCnt;
+    }
+
+    diff->taylorCenter = diff->varToDiff->value;
+
+    TaylorCalculateDerivatives (diff, diff->varToDiff->idx, diff->taylorCenter,
+                                diff->taylorDerivatives, coefsCnt);
+
+    memcpy (diff->taylorCoefs, diff->taylorDerivatives, coefsCnt * sizeof (double));
+    TaylorDivideFactorials (diff->taylorCoefs, coefsCnt);
+
+    TreeDtor (&diff->taylor);
+    TREE_DO_AND_RETURN (TREE_CTOR (&diff->taylor, &diff->log));
+    diff->taylor.arena = diff->arena;
+
+    diff->taylor.root = TaylorBuildTree (&diff->taylor, diff->taylorCoefs, diff->taylorCoefsCnt,
+                                         diff->varToDiff->idx, diff->taylorCenter);
+
+    PROFILE_STOP  (PROFILE_STAGE_TAYLOR, start);
+    PROFILE_COUNT (PROFILE_EVALUATIONS, coefsCnt);
+
+    if (diff->taylor.root == NULL)
+        return TREE_ERROR_COMMON |
+               COMMON_ERROR_ALLOCATING_MEMORY;
+
+    return TREE_OK;
+}
+
+#define NUM_(num)                                                                       \
+        NodeCtorAndFill (tree, TYPE_CONST_NUM, {.number = num}, NULL, NULL)
+#define ADD_(left, right)                                                               \
+        NodeCtorAndFill (tree, TYPE_MATH_OPERATION, {.idx = OP_ADD}, left, right)
+#define SUB_(left, right)                                                               \
+        NodeCtorAndFill (tree, TYPE_MATH_OPERATION, {.idx = OP_SUB}, left, right)
+#define MUL_(left, right)                                                               \
+        NodeCtorAndFill (tree, TYPE_MATH_OPERATION, {.idx = OP_MUL}, left, right)
+#define VAR_(idxVar)                                                                    \
+        NodeCtorAndFill (tree, TYPE_VARIABLE, {.idx = idxVar}, NULL, NULL)
+
+// c0 + (x - a) * (c1 + (x - a) * (... + (x - a) * cn)), no pow() and no factorials
+node_t *TaylorBuildTree (tree_t *tree, const double *coefs, size_t coefsCnt,
+                         size_t varIdx, double center)
+{
+    assert (tree);
+    assert (coefs);
+    assert (coefsCnt > 0);
+
+    node_t *root = NUM_ (coefs[coefsCnt - 1]);
+
+    for (size_t i = coefsCnt - 1; i > 0 && root != NULL; i--)
+    {
+        node_t *shift = SUB_ (VAR_ (varIdx), NUM_ (center));
+
+        root = ADD_ (NUM_ (coefs[i - 1]), MUL_ (shift, root));
+    }
+
+    return root;
+}
+
+#undef NUM_
+#undef ADD_
+#undef SUB_
+#undef MUL_
+#undef VAR_